@@ -0,0 +1,51 @@
+#include "allocation_counter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/*
+ * The replaced operators are in their own translation unit, so the compiler
+ * doesn't inline them into the tests and see free() called on memory from
+ * operator new.
+ */
+static std::atomic<size_t> nr_allocations(0);
+
+size_t get_nr_allocations()
+{
+    return nr_allocations;
+}
+
+void * operator new(size_t size)
+{
+    ++nr_allocations;
+    void * p = std::malloc(size ? size : 1);
+    if (! p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void * operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void * p, size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void * p, size_t) noexcept
+{
+    std::free(p);
+}
@@ -0,0 +1,13 @@
+#ifndef _PELE_TEST_ALLOCATION_COUNTER_H_
+#define _PELE_TEST_ALLOCATION_COUNTER_H_
+
+#include <cstdlib>
+
+/**
+ * the number of heap allocations through operator new since the start of
+ * the program.  allocation_counter.cpp replaces the global operator new and
+ * operator delete to count them.
+ */
+size_t get_nr_allocations();
+
+#endif
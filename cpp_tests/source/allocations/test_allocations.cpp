@@ -0,0 +1,46 @@
+#include "pele/array.h"
+#include "pele/lbfgs.h"
+#include "pele/harmonic.h"
+#include "pele/lj.h"
+#include "allocation_counter.h"
+#include <gtest/gtest.h>
+#include <memory>
+
+using pele::Array;
+
+TEST(LbfgsHarmonic, OneIteration_DoesNotAllocate){
+    Array<double> origin(30, 0);
+    auto pot = std::make_shared<pele::Harmonic>(origin, 1., 3);
+    Array<double> x0(30);
+    for (size_t i = 0; i < x0.size(); ++i){
+        x0[i] = 1. + 0.1 * i;
+    }
+    pele::LBFGS lbfgs(pot, x0, 1e-10);
+    // fill the memory first
+    lbfgs.run(10);
+    const size_t nr_allocations_before = get_nr_allocations();
+    lbfgs.one_iteration();
+    lbfgs.one_iteration();
+    const size_t nr_allocations_after = get_nr_allocations();
+    ASSERT_EQ(nr_allocations_before, nr_allocations_after);
+}
+
+TEST(LbfgsLJ, OneIteration_DoesNotAllocate){
+    // 13 atoms on a slightly distorted cubic grid
+    Array<double> x0(39);
+    for (size_t i = 0; i < 13; ++i){
+        x0[3 * i] = 1.1 * (i % 3) + 0.01 * i;
+        x0[3 * i + 1] = 1.1 * ((i / 3) % 3);
+        x0[3 * i + 2] = 1.1 * (i / 9) - 0.01 * i;
+    }
+    auto pot = std::make_shared<pele::LJ>(4., 4.);
+    pele::LBFGS lbfgs(pot, x0, 1e-10);
+    lbfgs.run(10);
+    Array<double> x = lbfgs.get_x();
+    const size_t nr_allocations_before = get_nr_allocations();
+    lbfgs.one_iteration();
+    lbfgs.one_iteration();
+    pot->get_energy(x);
+    const size_t nr_allocations_after = get_nr_allocations();
+    ASSERT_EQ(nr_allocations_before, nr_allocations_after);
+}
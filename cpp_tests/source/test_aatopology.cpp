@@ -3,6 +3,7 @@
 
 #include <memory>
 #include "pele/aatopology.h"
+#include "pele/lbfgs.h"
 #include "pele/lj.h"
 #include "pele/vecn.h"
 #include "pele/matrix.h"
@@ -253,6 +254,27 @@ TEST_F(AATopologyTest, RBPotential_Works)
     }
 }
 
+TEST_F(AATopologyTest, RigidBodyPreconditioner_Works)
+{
+    auto precond = std::make_shared<pele::RigidBodyPreconditioner>(rbtopology);
+    Array<double> inv = precond->get_inverse_diagonal();
+    ASSERT_EQ(inv.size(), 6 * nrigid);
+    Array<double> xotp = make_otp_x();
+    const double r2 = pele::dot(xotp, xotp);
+    for (size_t i = 0; i < 3 * nrigid; ++i) {
+        EXPECT_DOUBLE_EQ(inv[i], 1. / 3);
+        EXPECT_DOUBLE_EQ(inv[3 * nrigid + i], 1. / (2. / 3 * r2));
+    }
+
+    auto rbpot = std::make_shared<pele::RBPotentialWrapper>(std::make_shared<pele::LJ>(4,4),
+            rbtopology);
+    pele::LBFGS lbfgs(rbpot, x0, 1e-5);
+    lbfgs.set_preconditioner(precond);
+    lbfgs.run();
+    ASSERT_TRUE(lbfgs.success());
+    EXPECT_LT(lbfgs.get_f(), rbpot->get_energy(x0));
+}
+
 TEST_F(AATopologyTest, TransformRotate_Works)
 {
     auto x = x0.copy();
@@ -102,6 +102,43 @@ TEST_F(BasePotentialTest, EOnlyGetHess_Works){
     }
 }
 
+TEST_F(BasePotentialTest, EOnlyHessianVectorProduct_Works){
+    HarmonicE pot;
+    Array<double> v(2);
+    v[0] = 0.3;
+    v[1] = -2.;
+    Array<double> hv(2);
+    pot.get_hessian_vector_product(x, v, hv);
+    // the hessian is the identity
+    for (size_t k=0; k<v.size(); ++k){
+        EXPECT_NEAR(hv[k], v[k], 1e-3);
+    }
+    Array<double> zero(2, 0.);
+    pot.get_hessian_vector_product(x, zero, hv);
+    EXPECT_EQ(hv[0], 0.);
+    EXPECT_EQ(hv[1], 0.);
+}
+
+TEST_F(BasePotentialTest, EOnlyBatch_Works){
+    HarmonicE pot;
+    EXPECT_FALSE(pot.can_run_concurrently());
+    Array<double> xs(6);
+    for (size_t k=0; k<xs.size(); ++k){
+        xs[k] = 0.5 * k;
+    }
+    Array<double> energies(3);
+    Array<double> grads(6);
+    pot.get_energy_gradient_batch(xs, energies, grads, 4);
+    for (size_t c=0; c<3; ++c){
+        EXPECT_NEAR(energies[c], (xs[2*c] * xs[2*c] + xs[2*c+1] * xs[2*c+1]) / 2., 1e-10);
+        EXPECT_NEAR(grads[2*c], xs[2*c], 1e-6);
+        EXPECT_NEAR(grads[2*c+1], xs[2*c+1], 1e-6);
+    }
+    Array<double> wrong_nconf(4);
+    EXPECT_THROW(pot.get_energy_batch(xs, wrong_nconf), std::invalid_argument);
+    EXPECT_THROW(pot.get_energy_batch(xs, energies, 0), std::invalid_argument);
+}
+
 TEST_F(BasePotentialTest, Throws){
     BasePotential pot;
     EXPECT_THROW(pot.get_energy(x), std::runtime_error);
@@ -109,5 +146,6 @@ TEST_F(BasePotentialTest, Throws){
     EXPECT_THROW(pot.add_energy_gradient_hessian(x, g, hess), std::runtime_error);
     EXPECT_THROW(pot.numerical_gradient(x, hess), std::invalid_argument);
     EXPECT_THROW(pot.numerical_hessian(hess, hess), std::invalid_argument);
+    EXPECT_THROW(pot.numerical_hessian_vector_product(x, hess, g), std::invalid_argument);
 }
 
@@ -0,0 +1,107 @@
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "pele/batch_optimizer.h"
+#include "pele/lbfgs.h"
+#include "pele/lj.h"
+#include "pele/modified_fire.h"
+
+using pele::Array;
+
+class BatchOptimizerTest : public ::testing::Test {
+public:
+    std::shared_ptr<pele::LJ> lj;
+    size_t nconf;
+    size_t ndof;
+    Array<double> x;
+    virtual void SetUp()
+    {
+        lj = std::make_shared<pele::LJ>(1., 1.);
+        nconf = 7;
+        ndof = 3 * 8;
+        x = Array<double>(nconf * ndof);
+        for (size_t i = 0; i < x.size(); ++i) {
+            x[i] = 1.4 * std::sin(3.7 * i + 0.2);
+        }
+    }
+
+    Array<double> configuration(size_t iconf)
+    {
+        return Array<double>(x.data() + ndof * iconf, ndof).copy();
+    }
+
+    /**
+     * the batch must give exactly the same result as separate optimizers
+     */
+    void check_same(pele::BatchOptimizer & batch, pele::GradientOptimizer & opt, size_t iconf)
+    {
+        auto const batch_opt = batch.get_optimizer(iconf);
+        EXPECT_EQ(batch_opt->get_niter(), opt.get_niter());
+        EXPECT_EQ(batch_opt->get_nfev(), opt.get_nfev());
+        EXPECT_DOUBLE_EQ(batch.get_f()[iconf], opt.get_f());
+        EXPECT_DOUBLE_EQ(batch.get_rms()[iconf], opt.get_rms());
+        Array<double> xbatch = batch.get_x();
+        Array<double> xopt = opt.get_x();
+        for (size_t k = 0; k < ndof; ++k) {
+            EXPECT_DOUBLE_EQ(xbatch[ndof * iconf + k], xopt[k]);
+        }
+    }
+};
+
+TEST_F(BatchOptimizerTest, LBFGS_AgreesWithSingle)
+{
+    for (size_t nr_threads : {1, 3}) {
+        pele::BatchLBFGS batch(lj, x, nconf, 1e-6, 4, nr_threads);
+        batch.run();
+        EXPECT_TRUE(batch.success());
+        EXPECT_EQ(batch.get_nr_active(), 0u);
+        for (size_t iconf = 0; iconf < nconf; ++iconf) {
+            pele::LBFGS lbfgs(lj, configuration(iconf), 1e-6, 4);
+            lbfgs.run();
+            check_same(batch, lbfgs, iconf);
+        }
+    }
+}
+
+TEST_F(BatchOptimizerTest, FIRE_AgreesWithSingle)
+{
+    pele::BatchFIRE batch(lj, x, nconf, 0.1, 1., 0.5, 5, 1.1, 0.5, 0.99, 0.1, 1e-5,
+            true, 4);
+    batch.run();
+    EXPECT_TRUE(batch.success());
+    for (size_t iconf = 0; iconf < nconf; ++iconf) {
+        Array<double> xi = configuration(iconf);
+        pele::MODIFIED_FIRE fire(lj, xi, 0.1, 1., 0.5, 5, 1.1, 0.5, 0.99, 0.1, 1e-5, true);
+        fire.run();
+        check_same(batch, fire, iconf);
+    }
+}
+
+TEST_F(BatchOptimizerTest, FinishedConfigurations_AreDropped)
+{
+    pele::BatchLBFGS batch(lj, x, nconf, 1e-6, 4, 2);
+    EXPECT_EQ(batch.get_nr_active(), nconf);
+    batch.set_max_iter(3);
+    batch.run();
+    EXPECT_EQ(batch.get_nr_active(), 0u);
+    EXPECT_FALSE(batch.success());
+    for (size_t iconf = 0; iconf < nconf; ++iconf) {
+        EXPECT_EQ(batch.get_optimizer(iconf)->get_niter(), 3);
+    }
+    // continue the minimization
+    batch.set_max_iter(10000);
+    EXPECT_EQ(batch.get_nr_active(), nconf);
+    batch.run();
+    EXPECT_TRUE(batch.success());
+}
+
+TEST_F(BatchOptimizerTest, IllegalInput_Throws)
+{
+    EXPECT_THROW(pele::BatchLBFGS(lj, x, 0), std::invalid_argument);
+    EXPECT_THROW(pele::BatchLBFGS(lj, Array<double>(ndof * nconf + 1), nconf),
+            std::invalid_argument);
+    EXPECT_THROW(pele::BatchLBFGS(lj, x, nconf, 1e-4, 4, 0), std::invalid_argument);
+}
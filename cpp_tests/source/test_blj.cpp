@@ -82,3 +82,12 @@ TEST_F(BLJCutTest, EnergyGradientHessian_AgreesWithNumerical){
     test_energy_gradient_hessian();
 }
 
+TEST_F(BLJCutTest, HessianVectorProduct_AgreesWithHessian){
+    test_hessian_vector_product();
+}
+
+TEST_F(BLJCutTest, Batch_AgreesWithSingle){
+    EXPECT_TRUE(pot->can_run_concurrently());
+    test_batch(2);
+}
+
@@ -11,6 +11,7 @@
 #include <gtest/gtest.h>
 #include <random>
 #include <ctime>
+#include <set>
 
 using pele::Array;
 using pele::InversePowerPeriodic;
@@ -1282,3 +1283,451 @@ TEST(LatticeNeighborsTest, RectangleWorks)
     get_boxvec_x_all<2>(rcut, N, boxvec, x);
     test_rectangular_cell_lists<2>(rcut, boxvec, x);
 }
+
+TEST(VerletListsTest, SmallDisplacements_AgreesWithCellLists)
+{
+    const double rcut = 2.5;
+    const size_t N = 60;
+    Array<double> boxvec;
+    Array<double> x;
+    get_boxvec_x0L<3>(rcut, N, boxvec, x);
+    pele::LJCutPeriodicCellLists<3> pot_c(4., 4., rcut, boxvec, 1);
+    pele::LJCutPeriodicCellLists<3> pot_v(4., 4., rcut, boxvec, 1, 0.5);
+    Array<double> g_c(x.size());
+    Array<double> g_v(x.size());
+    Array<double> h_c(x.size() * x.size());
+    Array<double> h_v(x.size() * x.size());
+    std::mt19937_64 gen(48);
+    std::uniform_real_distribution<double> displacement(-0.02, 0.02);
+    for (size_t step = 0; step < 20; ++step) {
+        for (size_t i = 0; i < x.size(); ++i) {
+            x[i] += displacement(gen);
+        }
+        EXPECT_NEAR_RELATIVE(pot_c.get_energy(x), pot_v.get_energy(x), 1e-10);
+        const double e_c = pot_c.get_energy_gradient(x, g_c);
+        const double e_v = pot_v.get_energy_gradient(x, g_v);
+        EXPECT_NEAR_RELATIVE(e_c, e_v, 1e-10);
+        for (size_t i = 0; i < x.size(); ++i) {
+            EXPECT_NEAR_RELATIVE(g_c[i], g_v[i], 1e-10);
+        }
+    }
+    pot_c.get_energy_gradient_hessian(x, g_c, h_c);
+    pot_v.get_energy_gradient_hessian(x, g_v, h_v);
+    for (size_t i = 0; i < h_c.size(); ++i) {
+        EXPECT_NEAR_RELATIVE(h_c[i], h_v[i], 1e-10);
+    }
+    // no atom moved further than skin / 2 = 0.25, so the list was built once
+    EXPECT_EQ(pot_v.get_nr_verlet_rebuilds(), 1u);
+}
+
+TEST(VerletListsTest, LargeDisplacements_ListIsRebuilt)
+{
+    const double rcut = 2.5;
+    const size_t N = 60;
+    Array<double> boxvec;
+    Array<double> x;
+    get_boxvec_x05<3>(rcut, N, boxvec, x);
+    pele::LJCutPeriodicCellLists<3> pot_c(4., 4., rcut, boxvec, 1);
+    pele::LJCutPeriodicCellLists<3> pot_v(4., 4., rcut, boxvec, 1, 0.2);
+    Array<double> g_c(x.size());
+    Array<double> g_v(x.size());
+    std::mt19937_64 gen(50);
+    std::uniform_real_distribution<double> displacement(-0.3, 0.3);
+    for (size_t step = 0; step < 5; ++step) {
+        for (size_t i = 0; i < x.size(); ++i) {
+            x[i] += displacement(gen);
+        }
+        const double e_c = pot_c.get_energy_gradient(x, g_c);
+        const double e_v = pot_v.get_energy_gradient(x, g_v);
+        EXPECT_NEAR_RELATIVE(e_c, e_v, 1e-10);
+        for (size_t i = 0; i < x.size(); ++i) {
+            EXPECT_NEAR_RELATIVE(g_c[i], g_v[i], 1e-10);
+        }
+    }
+    EXPECT_EQ(pot_v.get_nr_verlet_rebuilds(), 5u);
+}
+
+TEST(CellListPotentialThreads, ManyThreads_AgreesWithOneThread)
+{
+    const double rcut = 2.5;
+    const size_t N = 60;
+    Array<double> boxvec;
+    Array<double> x;
+    get_boxvec_x0L<3>(rcut, N, boxvec, x);
+    for (double skin : {0., 0.3}) {
+        pele::LJCutPeriodicCellLists<3> pot_1(4., 4., rcut, boxvec, 1, skin);
+        pele::LJCutPeriodicCellLists<3> pot_n(4., 4., rcut, boxvec, 1, skin);
+        pot_n.set_nr_threads(4);
+        EXPECT_EQ(pot_n.get_nr_threads(), 4u);
+        Array<double> g_1(x.size());
+        Array<double> g_n(x.size());
+        Array<double> h_1(x.size() * x.size());
+        Array<double> h_n(x.size() * x.size());
+        EXPECT_NEAR_RELATIVE(pot_1.get_energy(x), pot_n.get_energy(x), 1e-10);
+        const double e_1 = pot_1.get_energy_gradient(x, g_1);
+        const double e_n = pot_n.get_energy_gradient(x, g_n);
+        EXPECT_NEAR_RELATIVE(e_1, e_n, 1e-10);
+        for (size_t i = 0; i < x.size(); ++i) {
+            EXPECT_NEAR_RELATIVE(g_1[i], g_n[i], 1e-10);
+        }
+        pot_1.get_energy_gradient_hessian(x, g_1, h_1);
+        pot_n.get_energy_gradient_hessian(x, g_n, h_n);
+        for (size_t i = 0; i < x.size(); ++i) {
+            EXPECT_NEAR_RELATIVE(g_1[i], g_n[i], 1e-10);
+        }
+        for (size_t i = 0; i < h_1.size(); ++i) {
+            EXPECT_NEAR_RELATIVE(h_1[i], h_n[i], 1e-10);
+        }
+    }
+}
+
+TEST(CellListPotentialThreads, ZeroThreads_Throws)
+{
+    Array<double> boxvec(3, 10.);
+    pele::LJCutPeriodicCellLists<3> pot(4., 4., 2.5, boxvec, 1);
+    EXPECT_THROW(pot.set_nr_threads(0), std::invalid_argument);
+}
+
+/**
+ * collect the atom pairs and check that the positions passed to the
+ * visitor are the current ones
+ */
+template <size_t ndim>
+class PairCollector {
+public:
+    Array<double> m_x;
+    std::set<std::pair<long, long> > m_pairs;
+    size_t m_nr_wrong_positions;
+    PairCollector(Array<double> x) : m_x(x), m_nr_wrong_positions(0) {}
+    void insert_atom_pair(pele::AtomPosition<ndim> const & atom_i,
+            pele::AtomPosition<ndim> const & atom_j)
+    {
+        m_pairs.insert(std::make_pair(std::min(atom_i.atom_index, atom_j.atom_index),
+                std::max(atom_i.atom_index, atom_j.atom_index)));
+        for (size_t k = 0; k < ndim; ++k) {
+            if (atom_i.x[k] != m_x[ndim * atom_i.atom_index + k]
+                    || atom_j.x[k] != m_x[ndim * atom_j.atom_index + k]) {
+                ++m_nr_wrong_positions;
+            }
+        }
+    }
+};
+
+TEST(CellListsIncrementalTest, Reset_AgreesWithFreshCellLists)
+{
+    const double rcut = 2.5;
+    const size_t N = 60;
+    Array<double> boxvec;
+    Array<double> x;
+    get_boxvec_x0L<3>(rcut, N, boxvec, x);
+    auto dist = std::make_shared<pele::periodic_distance<3> >(boxvec);
+    pele::CellLists<pele::periodic_distance<3> > cl(dist, boxvec, rcut);
+    cl.reset(x);
+    EXPECT_EQ(cl.get_nr_cell_changes(), 0u);
+
+    std::mt19937_64 gen(52);
+    for (double max_displacement : {1e-6, 0.5, 2.}) {
+        std::uniform_real_distribution<double> displacement(-max_displacement, max_displacement);
+        for (size_t step = 0; step < 5; ++step) {
+            for (size_t i = 0; i < x.size(); ++i) {
+                x[i] += displacement(gen);
+            }
+            cl.reset(x);
+            pele::CellLists<pele::periodic_distance<3> > cl_fresh(dist, boxvec, rcut);
+            cl_fresh.reset(x);
+            PairCollector<3> pairs(x), pairs_fresh(x);
+            cl.get_atom_pair_looper(pairs).loop_through_atom_pairs();
+            cl_fresh.get_atom_pair_looper(pairs_fresh).loop_through_atom_pairs();
+            EXPECT_EQ(pairs.m_pairs, pairs_fresh.m_pairs);
+            EXPECT_EQ(pairs.m_nr_wrong_positions, 0u);
+        }
+        if (max_displacement < 1e-3) {
+            EXPECT_EQ(cl.get_nr_cell_changes(), 0u);
+        }
+    }
+    EXPECT_GT(cl.get_nr_cell_changes(), 0u);
+}
+
+/**
+ * run a short Monte Carlo chain of one- and two-atom moves and compare the
+ * energy and gradient changes with full evaluations of pot_ref
+ */
+template <class potential_t>
+void test_energy_change_chain(potential_t & pot, pele::BasePotential & pot_ref,
+        Array<double> x, const double max_displacement)
+{
+    std::mt19937_64 gen(53);
+    std::uniform_real_distribution<double> displacement(-max_displacement, max_displacement);
+    std::uniform_int_distribution<size_t> random_atom(0, x.size() / 3 - 1);
+    Array<double> g(x.size());
+    Array<double> g_true(x.size());
+    double e = pot.get_energy_gradient(x, g);
+    for (size_t step = 0; step < 40; ++step) {
+        Array<double> x_new = x.copy();
+        Array<size_t> changed(1 + step % 2);
+        changed[0] = random_atom(gen);
+        if (changed.size() == 2) {
+            do {
+                changed[1] = random_atom(gen);
+            } while (changed[1] == changed[0]);
+        }
+        for (size_t const iatom : changed) {
+            for (size_t k = 0; k < 3; ++k) {
+                x_new[3 * iatom + k] += displacement(gen);
+            }
+        }
+        const double e_true = pot_ref.get_energy_gradient(x_new, g_true);
+        if (step % 3 == 0) {
+            // rejected move
+            EXPECT_NEAR(pot.get_energy_change(x, x_new, changed), e_true - e, 1e-9 * (1 + std::fabs(e)));
+        } else {
+            // accepted move
+            const double de = pot.get_energy_gradient_change(x, x_new, changed, g);
+            EXPECT_NEAR(de, e_true - e, 1e-9 * (1 + std::fabs(e)));
+            for (size_t i = 0; i < x.size(); ++i) {
+                EXPECT_NEAR(g[i], g_true[i], 1e-8 * (1 + std::fabs(g_true[i])));
+            }
+            x = x_new;
+            e += de;
+        }
+    }
+}
+
+TEST(EnergyChangeTest, CellLists_AgreesWithFullEnergy)
+{
+    // a dense packing of overlapping soft spheres
+    const size_t N = 200;
+    Array<double> boxvec(3, 6.);
+    Array<double> radii(N);
+    Array<double> x(3 * N);
+    std::mt19937_64 gen(54);
+    std::uniform_real_distribution<double> position(0, 6.);
+    for (size_t i = 0; i < N; ++i) {
+        radii[i] = 0.5 + 0.1 * (i % 3);
+        for (size_t k = 0; k < 3; ++k) {
+            x[3 * i + k] = position(gen);
+        }
+    }
+    pele::InversePowerPeriodic<3> pot_ref(2.5, 1., radii, boxvec);
+    EXPECT_GT(pot_ref.get_energy(x), 1.);
+    pele::InversePowerPeriodicCellLists<3> pot(2.5, 1., radii, boxvec);
+    test_energy_change_chain(pot, pot_ref, x, 0.7);
+    pele::InversePowerPeriodicCellLists<3> pot_verlet(2.5, 1., radii, boxvec, 1., 0.3);
+    test_energy_change_chain(pot_verlet, pot_ref, x, 0.7);
+    pele::InversePowerPeriodic<3> pot_simple(2.5, 1., radii, boxvec);
+    test_energy_change_chain(pot_simple, pot_ref, x, 0.7);
+}
+
+TEST(EnergyChangeTest, IllegalInput_Throws)
+{
+    const double rcut = 2.5;
+    const size_t N = 60;
+    Array<double> boxvec;
+    Array<double> x;
+    get_boxvec_x05<3>(rcut, N, boxvec, x);
+    pele::LJCutPeriodicCellLists<3> pot(4., 4., rcut, boxvec, 1);
+    Array<size_t> duplicate(2, 1);
+    EXPECT_THROW(pot.get_energy_change(x, x, duplicate), std::invalid_argument);
+    Array<size_t> out_of_range(1, N);
+    EXPECT_THROW(pot.get_energy_change(x, x, out_of_range), std::invalid_argument);
+    Array<size_t> one(1, 3);
+    EXPECT_DOUBLE_EQ(pot.get_energy_change(x, x, one), 0.);
+}
+
+/**
+ * check the energy, gradient and sparse Hessian against the dense ones
+ */
+void test_sparse_hessian(pele::BasePotential & pot, pele::BasePotential & pot_ref,
+        Array<double> x, const size_t block_size)
+{
+    const size_t N = x.size();
+    Array<double> g(N);
+    Array<double> g_ref(N);
+    Array<double> h_ref(N * N);
+    pele::BlockSparseMatrix h;
+    const double e = pot.get_energy_gradient_sparse_hessian(x, g, h);
+    const double e_ref = pot_ref.get_energy_gradient_hessian(x, g_ref, h_ref);
+    EXPECT_NEAR_RELATIVE(e, e_ref, 1e-10);
+    EXPECT_EQ(h.block_size(), block_size);
+    ASSERT_EQ(h.nr_rows(), N);
+    EXPECT_LT(h.nr_blocks(), (N / block_size) * (N / block_size) / 2);
+    for (size_t i = 0; i < N; ++i) {
+        EXPECT_NEAR(g[i], g_ref[i], 1e-10 * (1 + std::fabs(g_ref[i])));
+        for (size_t j = 0; j < N; ++j) {
+            EXPECT_NEAR(h.get(i, j), h_ref[N * i + j], 1e-10 * (1 + std::fabs(h_ref[N * i + j])));
+        }
+    }
+    // the sparse and dense matrix vector products agree
+    Array<double> v(N);
+    for (size_t i = 0; i < N; ++i) {
+        v[i] = std::sin(1. + i);
+    }
+    Array<double> hv(N);
+    h.multiply(v, hv);
+    for (size_t i = 0; i < N; ++i) {
+        double hv_ref = 0;
+        for (size_t j = 0; j < N; ++j) {
+            hv_ref += h_ref[N * i + j] * v[j];
+        }
+        EXPECT_NEAR(hv[i], hv_ref, 1e-9 * (1 + std::fabs(hv_ref)));
+    }
+}
+
+TEST(SparseHessianTest, CellLists_AgreesWithDense)
+{
+    const size_t N = 100;
+    Array<double> boxvec(3, 8.);
+    Array<double> radii(N);
+    Array<double> x(3 * N);
+    std::mt19937_64 gen(55);
+    std::uniform_real_distribution<double> position(0, 8.);
+    for (size_t i = 0; i < N; ++i) {
+        radii[i] = 0.5 + 0.1 * (i % 3);
+        for (size_t k = 0; k < 3; ++k) {
+            x[3 * i + k] = position(gen);
+        }
+    }
+    pele::InversePowerPeriodic<3> pot_ref(2.5, 1., radii, boxvec);
+    pele::InversePowerPeriodicCellLists<3> pot(2.5, 1., radii, boxvec);
+    test_sparse_hessian(pot, pot_ref, x, 3);
+    pot.set_nr_threads(3);
+    test_sparse_hessian(pot, pot_ref, x, 3);
+    pele::InversePowerPeriodicCellLists<3> pot_verlet(2.5, 1., radii, boxvec, 1., 0.3);
+    test_sparse_hessian(pot_verlet, pot_ref, x, 3);
+    test_sparse_hessian(pot_ref, pot_ref, x, 3);
+}
+
+TEST(HessianVectorProductTest, CellLists_AgreesWithHessian)
+{
+    const size_t N = 100;
+    Array<double> boxvec(3, 8.);
+    Array<double> radii(N);
+    Array<double> x(3 * N);
+    Array<double> v(3 * N);
+    std::mt19937_64 gen(57);
+    std::uniform_real_distribution<double> position(0, 8.);
+    for (size_t i = 0; i < N; ++i) {
+        radii[i] = 0.5 + 0.1 * (i % 3);
+        for (size_t k = 0; k < 3; ++k) {
+            x[3 * i + k] = position(gen);
+            v[3 * i + k] = position(gen) - 4.;
+        }
+    }
+    pele::InversePowerPeriodic<3> pot_ref(2.5, 1., radii, boxvec);
+    pele::BlockSparseMatrix h;
+    Array<double> g(x.size());
+    pot_ref.get_energy_gradient_sparse_hessian(x, g, h);
+    Array<double> hv_ref(x.size());
+    h.multiply(v, hv_ref);
+    pele::InversePowerPeriodicCellLists<3> pot(2.5, 1., radii, boxvec);
+    pele::InversePowerPeriodicCellLists<3> pot_verlet(2.5, 1., radii, boxvec, 1., 0.3);
+    pot_verlet.set_nr_threads(3);
+    for (pele::BasePotential * p : std::vector<pele::BasePotential *>{&pot, &pot_verlet, &pot_ref}) {
+        Array<double> hv(x.size(), 1.);
+        p->get_hessian_vector_product(x, v, hv);
+        for (size_t i = 0; i < x.size(); ++i) {
+            EXPECT_NEAR(hv[i], hv_ref[i], 1e-10 * (1 + std::fabs(hv_ref[i])));
+        }
+    }
+}
+
+/**
+ * a potential which only has the default sparse Hessian of BasePotential
+ */
+class DenseOnlyPotential : public pele::BasePotential {
+public:
+    pele::BasePotential & m_pot;
+    DenseOnlyPotential(pele::BasePotential & pot) : m_pot(pot) {}
+    virtual double get_energy(Array<double> x) { return m_pot.get_energy(x); }
+    virtual double get_energy_gradient(Array<double> x, Array<double> grad)
+    {
+        return m_pot.get_energy_gradient(x, grad);
+    }
+    virtual double get_energy_gradient_hessian(Array<double> x, Array<double> grad,
+            Array<double> hess)
+    {
+        return m_pot.get_energy_gradient_hessian(x, grad, hess);
+    }
+};
+
+TEST(SparseHessianTest, Default_ConvertsDense)
+{
+    const size_t N = 40;
+    Array<double> boxvec(3, 8.);
+    Array<double> radii(N, 0.6);
+    Array<double> x(3 * N);
+    std::mt19937_64 gen(56);
+    std::uniform_real_distribution<double> position(0, 8.);
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = position(gen);
+    }
+    pele::InversePowerPeriodic<3> pot_ref(2.5, 1., radii, boxvec);
+    DenseOnlyPotential pot(pot_ref);
+    test_sparse_hessian(pot, pot_ref, x, 1);
+}
+
+TEST(SpatialSortTest, MortonOrder_IsPermutation)
+{
+    const size_t N = 500;
+    Array<double> x(3 * N);
+    std::mt19937_64 gen(58);
+    std::uniform_real_distribution<double> position(-3., 5.);
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = position(gen);
+    }
+    std::vector<size_t> order = pele::morton_order<3>(x);
+    ASSERT_EQ(order.size(), N);
+    std::set<size_t> atoms(order.begin(), order.end());
+    EXPECT_EQ(atoms.size(), N);
+    EXPECT_EQ(*atoms.rbegin(), N - 1);
+    // consecutive atoms along the curve are much closer than random pairs
+    double dsum_sorted = 0, dsum_original = 0;
+    for (size_t i = 1; i < N; ++i) {
+        for (size_t k = 0; k < 3; ++k) {
+            dsum_sorted += std::fabs(x[3 * order[i] + k] - x[3 * order[i - 1] + k]);
+            dsum_original += std::fabs(x[3 * i + k] - x[3 * (i - 1) + k]);
+        }
+    }
+    EXPECT_LT(dsum_sorted, 0.5 * dsum_original);
+}
+
+TEST(SpatialSortTest, SortedCellLists_AgreesWithUnsorted)
+{
+    const size_t N = 300;
+    Array<double> boxvec(3, 8.);
+    Array<double> radii(N);
+    Array<double> x(3 * N);
+    std::mt19937_64 gen(59);
+    std::uniform_real_distribution<double> position(0, 8.);
+    std::uniform_real_distribution<double> displacement(-0.2, 0.2);
+    for (size_t i = 0; i < N; ++i) {
+        radii[i] = 0.4 + 0.1 * (i % 4);
+        for (size_t k = 0; k < 3; ++k) {
+            x[3 * i + k] = position(gen);
+        }
+    }
+    for (double skin : {0., 0.3}) {
+        pele::InversePowerPeriodicCellLists<3> pot(2.5, 1., radii, boxvec, 1., skin);
+        pele::InversePowerPeriodicCellLists<3> pot_sorted(2.5, 1., radii, boxvec, 1., skin);
+        pot_sorted.set_spatial_sort_interval(3);
+        pot_sorted.set_nr_threads(2);
+        Array<double> xi = x.copy();
+        Array<double> g(x.size());
+        Array<double> g_sorted(x.size());
+        for (size_t step = 0; step < 8; ++step) {
+            const double e = pot.get_energy_gradient(xi, g);
+            EXPECT_GT(e, 1.);
+            const double e_sorted = pot_sorted.get_energy_gradient(xi, g_sorted);
+            EXPECT_NEAR_RELATIVE(e_sorted, e, 1e-10);
+            const double e_sorted2 = pot_sorted.get_energy(xi);
+            EXPECT_NEAR_RELATIVE(e_sorted2, e, 1e-10);
+            for (size_t i = 0; i < x.size(); ++i) {
+                EXPECT_NEAR(g_sorted[i], g[i], 1e-10 * (1 + std::fabs(g[i])));
+            }
+            for (size_t i = 0; i < xi.size(); ++i) {
+                xi[i] += displacement(gen);
+            }
+        }
+        EXPECT_EQ(pot_sorted.get_nr_spatial_sorts(), 6u);
+    }
+}
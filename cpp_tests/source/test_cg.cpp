@@ -0,0 +1,142 @@
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "pele/cg.h"
+#include "pele/lbfgs.h"
+#include "pele/linesearch.h"
+#include "pele/lj.h"
+
+using pele::Array;
+
+namespace {
+
+/**
+ * a reproducible, not very good starting configuration for an LJ cluster
+ */
+Array<double> lj_start(size_t natoms)
+{
+    Array<double> x(3 * natoms);
+    for (size_t i = 0; i < x.size(); ++i){
+        x[i] = 1.6 * std::sin(7.3 * i + 0.4);
+    }
+    return x;
+}
+
+}
+
+TEST(MoreThuenteLineSearch, SatisfiesWolfeConditions){
+    pele::LJ lj(1., 1.);
+    Array<double> x = lj_start(13);
+    Array<double> g(x.size());
+    const double f = lj.get_energy_gradient(x, g);
+    Array<double> p(x.size());
+    for (size_t i = 0; i < x.size(); ++i){
+        p[i] = -g[i] / pele::norm(g);
+    }
+    const double ginit = pele::dot(g, p);
+    for (double const gtol : {0.9, 0.1}) {
+        pele::MoreThuenteLineSearch ls(1e-4, gtol);
+        Array<double> xnew(x.size());
+        Array<double> gnew(x.size());
+        double fnew;
+        int nfev = 0;
+        const double stp = ls.search(lj, x, f, g, p, 1., 10., xnew, fnew, gnew, nfev);
+        EXPECT_GT(stp, 0);
+        EXPECT_GT(nfev, 0);
+        EXPECT_LE(nfev, ls.get_max_nfev() + 1);
+        EXPECT_LE(fnew, f + 1e-4 * stp * ginit);
+        EXPECT_LE(std::fabs(pele::dot(gnew, p)), gtol * std::fabs(ginit));
+        Array<double> gtest(x.size());
+        EXPECT_DOUBLE_EQ(lj.get_energy_gradient(xnew, gtest), fnew);
+        for (size_t i = 0; i < x.size(); ++i){
+            EXPECT_DOUBLE_EQ(xnew[i], x[i] + stp * p[i]);
+            EXPECT_DOUBLE_EQ(gnew[i], gtest[i]);
+        }
+    }
+}
+
+TEST(MoreThuenteLineSearch, IllegalInput_Throws){
+    EXPECT_THROW(pele::MoreThuenteLineSearch(0.5, 0.1), std::invalid_argument);
+    pele::LJ lj(1., 1.);
+    Array<double> x = lj_start(3);
+    Array<double> g(x.size());
+    const double f = lj.get_energy_gradient(x, g);
+    Array<double> xnew(x.size()), gnew(x.size());
+    double fnew;
+    int nfev = 0;
+    pele::MoreThuenteLineSearch ls;
+    // g is an uphill direction
+    EXPECT_THROW(ls.search(lj, x, f, g, g, 1., 1., xnew, fnew, gnew, nfev),
+            std::invalid_argument);
+}
+
+TEST(LbfgsLJ, WolfeLinesearch_Works){
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    Array<double> x0 = lj_start(13);
+    pele::LBFGS lbfgs1(lj, x0, 1e-6);
+    pele::LBFGS lbfgs2(lj, x0, 1e-6);
+    lbfgs2.set_linesearch(std::make_shared<pele::MoreThuenteLineSearch>());
+    lbfgs1.run();
+    lbfgs2.run();
+    ASSERT_TRUE(lbfgs1.success());
+    ASSERT_TRUE(lbfgs2.success());
+    std::cout << "nfev backtracking " << lbfgs1.get_nfev()
+        << " wolfe " << lbfgs2.get_nfev() << "\n";
+    Array<double> g(x0.size());
+    EXPECT_NEAR(lj->get_energy_gradient(lbfgs2.get_x(), g), lbfgs2.get_f(), 1e-10);
+    EXPECT_NEAR(pele::norm(g) / std::sqrt(g.size()), lbfgs2.get_rms(), 1e-10);
+}
+
+TEST(CGLJ, TwoAtom_Works){
+    auto lj = std::make_shared<pele::LJ> (1., 1.);
+    Array<double> x0(6, 0);
+    x0[0] = 2.;
+    pele::CG cg(lj, x0);
+    cg.run();
+    ASSERT_TRUE(cg.success());
+    ASSERT_GT(cg.get_nfev(), 1);
+    ASSERT_NEAR(cg.get_f(), -.25, 1e-8);
+    Array<double> x = cg.get_x();
+    double dr2 = 0;
+    for (size_t i = 0; i < 3; ++i){
+        const double dr = x[i] - x[3+i];
+        dr2 += dr * dr;
+    }
+    ASSERT_NEAR(sqrt(dr2), pow(2., 1./6), 1e-5);
+}
+
+TEST(CGLJ, Cluster_Works){
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    Array<double> x0 = lj_start(13);
+    pele::CG cg(lj, x0, 1e-6);
+    cg.run();
+    ASSERT_TRUE(cg.success());
+    Array<double> g(x0.size());
+    const double e = lj->get_energy_gradient(cg.get_x(), g);
+    EXPECT_NEAR(e, cg.get_f(), 1e-10);
+    EXPECT_LE(pele::norm(g) / std::sqrt(g.size()), 1e-6);
+    EXPECT_LT(e, lj->get_energy(x0));
+}
+
+TEST(CGLJ, Reset_Works){
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    Array<double> x0 = lj_start(7);
+    pele::CG cg1(lj, x0, 1e-6);
+    cg1.run();
+    Array<double> x2 = lj_start(8);
+    x2 = Array<double>(x2.data(), x0.size()).copy();
+    pele::CG cg2(lj, x2, 1e-6);
+    cg2.run();
+    cg2.reset(x0);
+    cg2.run();
+    ASSERT_EQ(cg1.get_nfev(), cg2.get_nfev());
+    ASSERT_EQ(cg1.get_niter(), cg2.get_niter());
+    ASSERT_DOUBLE_EQ(cg1.get_f(), cg2.get_f());
+    for (size_t i = 0; i < x0.size(); ++i){
+        ASSERT_DOUBLE_EQ(cg1.get_x()[i], cg2.get_x()[i]);
+    }
+}
@@ -5,6 +5,7 @@
 
 #include <gtest/gtest.h>
 
+#include "pele/harmonic.h"
 #include "pele/lj.h"
 #include "pele/modified_fire.h"
 
@@ -97,3 +98,91 @@ TEST(FireLJ, SetFuncGradientWorks){
 }
 
 
+
+TEST(FireLJ, Fire2_Works){
+    auto lj = std::make_shared<pele::LJ> (1., 1.);
+    Array<double> x0(6, 0);
+    x0[0] = 2.;
+    pele::MODIFIED_FIRE fire(lj, x0, 1, 1, 1);
+    fire.set_fire2(true);
+    ASSERT_TRUE(fire.get_fire2());
+    fire.run();
+    ASSERT_TRUE(fire.success());
+    ASSERT_NEAR(fire.get_f(), -.25, 1e-8);
+    Array<double> g = fire.get_g();
+    double rms = pele::norm(g) / sqrt(g.size());
+    ASSERT_NEAR(rms, fire.get_rms(), 1e-10);
+}
+
+TEST(FireHarmonic, Fire2Step_MatchesHandComputed){
+    const double k = 2.;
+    const double dt = 0.1;
+    const double a = 0.1;
+    Array<double> origin(6, 0);
+    auto pot = std::make_shared<pele::Harmonic>(origin, k, 3);
+    Array<double> x0(6);
+    for (size_t i = 0; i < x0.size(); ++i){
+        x0[i] = 0.1 * (i + 1);
+    }
+    pele::MODIFIED_FIRE fire(pot, x0, dt, 1, 10, 5, 1.1, 0.5, 0.99, a);
+    fire.set_fire2(true);
+    fire.run(1);
+    ASSERT_EQ(fire.get_niter(), 1);
+
+    // the initial velocity is -dt * g.  P > 0, so the velocity is updated
+    // v' = v - dt * g and then mixed v'' = (1 - a) * v' - a * |v'| * g / |g|
+    Array<double> g(x0.size());
+    pot->get_energy_gradient(x0, g);
+    const double gnorm = pele::norm(g);
+    Array<double> v(x0.size());
+    for (size_t i = 0; i < x0.size(); ++i){
+        v[i] = -dt * g[i] - dt * g[i];
+    }
+    const double vnorm = pele::norm(v);
+    for (size_t i = 0; i < x0.size(); ++i){
+        const double vi = (1 - a) * v[i] - a * vnorm * g[i] / gnorm;
+        ASSERT_NEAR(fire.get_x()[i], x0[i] + dt * vi, 1e-12);
+    }
+}
+
+TEST(FireLJ, Fire2Cluster_Works){
+    auto lj = std::make_shared<pele::LJ> (1., 1.);
+    Array<double> x0(3 * 13);
+    for (size_t i = 0; i < x0.size(); ++i){
+        x0[i] = 1.2 * std::sin(7.3 * i + 0.4);
+    }
+    pele::MODIFIED_FIRE fire1(lj, x0, 0.1, 1, 0.5);
+    fire1.set_max_iter(10000);
+    fire1.run();
+    pele::MODIFIED_FIRE fire2(lj, x0, 0.1, 1, 0.5);
+    fire2.set_max_iter(10000);
+    fire2.set_fire2(true);
+    fire2.run();
+    ASSERT_TRUE(fire1.success());
+    ASSERT_TRUE(fire2.success());
+    Array<double> g(x0.size());
+    const double e = lj->get_energy_gradient(fire2.get_x(), g);
+    ASSERT_DOUBLE_EQ(e, fire2.get_f());
+    ASSERT_LE(pele::norm(g) / sqrt(g.size()), 1e-4);
+}
+
+TEST(FireLJ, Fire2Reset_Works){
+    auto lj = std::make_shared<pele::LJ> (1., 1.);
+    Array<double> x0(9, 0);
+    x0[0] = 2.;
+    x0[4] = 1.5;
+    pele::MODIFIED_FIRE fire1(lj, x0, 0.1, 1, 0.5);
+    fire1.set_fire2(true);
+    fire1.run();
+    Array<double> x2 = x0.copy();
+    x2[1] = 2;
+    pele::MODIFIED_FIRE fire2(lj, x2, 0.1, 1, 0.5);
+    fire2.set_fire2(true);
+    fire2.run();
+    fire2.reset(x0);
+    fire2.run();
+    ASSERT_EQ(fire1.get_niter(), fire2.get_niter());
+    for (size_t i=0; i<x0.size(); ++i){
+        ASSERT_DOUBLE_EQ(fire1.get_x()[i], fire2.get_x()[i]);
+    }
+}
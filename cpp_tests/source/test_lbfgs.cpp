@@ -97,3 +97,53 @@ TEST(LbfgsLJ, SetFuncGradientWorks){
     ASSERT_DOUBLE_EQ(lbfgs1.get_f(), lbfgs2.get_f());
 }
 
+/**
+ * count the calls to get_energy and get_energy_gradient of another potential
+ */
+class CountingPotential : public pele::BasePotential {
+public:
+    std::shared_ptr<pele::BasePotential> pot;
+    size_t nr_energy;
+    size_t nr_energy_gradient;
+    CountingPotential(std::shared_ptr<pele::BasePotential> pot_)
+        : pot(pot_),
+          nr_energy(0),
+          nr_energy_gradient(0)
+    {}
+    virtual double get_energy(Array<double> x)
+    {
+        ++nr_energy;
+        return pot->get_energy(x);
+    }
+    virtual double get_energy_gradient(Array<double> x, Array<double> grad)
+    {
+        ++nr_energy_gradient;
+        return pot->get_energy_gradient(x, grad);
+    }
+};
+
+TEST(LbfgsLJ, EnergyOnlyLinesearch_Works){
+    Array<double> x0(3 * 13);
+    for (size_t i = 0; i < x0.size(); ++i){
+        x0[i] = 1.7 * std::sin(7.3 * i + 0.4);
+    }
+    auto pot1 = std::make_shared<CountingPotential>(std::make_shared<pele::LJ>(1., 1.));
+    auto pot2 = std::make_shared<CountingPotential>(std::make_shared<pele::LJ>(1., 1.));
+    pele::LBFGS lbfgs1(pot1, x0, 1e-6);
+    pele::LBFGS lbfgs2(pot2, x0, 1e-6);
+    // a large maximum step makes the line search backtrack
+    lbfgs1.set_maxstep(1.);
+    lbfgs2.set_maxstep(1.);
+    lbfgs2.set_energy_only_linesearch(true);
+    lbfgs1.run();
+    lbfgs2.run();
+    ASSERT_TRUE(lbfgs1.success());
+    ASSERT_TRUE(lbfgs2.success());
+    EXPECT_EQ(pot1->nr_energy, 0u);
+    EXPECT_GT(pot2->nr_energy, 0u);
+    EXPECT_LT(pot2->nr_energy_gradient, pot1->nr_energy_gradient);
+    EXPECT_EQ(lbfgs2.get_nfev(), int(pot2->nr_energy + pot2->nr_energy_gradient));
+    // the accepted steps are the same, so the minimizations agree
+    EXPECT_EQ(lbfgs1.get_niter(), lbfgs2.get_niter());
+    EXPECT_NEAR(lbfgs1.get_f(), lbfgs2.get_f(), 1e-10);
+}
@@ -91,6 +91,15 @@ TEST_F(LJTest, EnergyGradientHessian_AgreesWithNumerical){
     test_energy_gradient_hessian();
 }
 
+TEST_F(LJTest, HessianVectorProduct_AgreesWithHessian){
+    test_hessian_vector_product();
+}
+
+TEST_F(LJTest, Batch_AgreesWithSingle){
+    EXPECT_TRUE(pot->can_run_concurrently());
+    test_batch(3);
+}
+
 
 /*
  * LJCut
@@ -175,6 +184,10 @@ TEST_F(LJCutTest, EnergyGradientHessian_AgreesWithNumerical){
     test_energy_gradient_hessian();
 }
 
+TEST_F(LJCutTest, HessianVectorProduct_AgreesWithHessian){
+    test_hessian_vector_product();
+}
+
 /*
  * LJCutAtomList tests
  */
@@ -208,6 +221,10 @@ TEST_F(LJCutAtomListTest, EnergyGradientHessian_AgreesWithNumerical){
     test_energy_gradient_hessian();
 }
 
+TEST_F(LJCutAtomListTest, HessianVectorProduct_AgreesWithHessian){
+    test_hessian_vector_product();
+}
+
 class LJCutPeriodicAtomListTest :  public LJCutTest
 {
 public:
@@ -246,3 +263,48 @@ TEST_F(LJCutPeriodicAtomListTest, EnergyGradient_AgreesWithNumerical){
 TEST_F(LJCutPeriodicAtomListTest, EnergyGradientHessian_AgreesWithNumerical){
     test_energy_gradient_hessian();
 }
+
+/*
+ * the cartesian LJ potentials use the batched loops of pairwise_batch.h.
+ * compare them to the one-pair-at-a-time loops of the periodic versions in a
+ * box which is so large that it has no effect.
+ */
+TEST(LJBatchTest, HasBatchKernel_Works){
+    EXPECT_TRUE(pele::has_batch_kernel<pele::lj_interaction>::value);
+    EXPECT_TRUE(pele::has_batch_kernel<pele::lj_interaction_cut_smooth>::value);
+    EXPECT_FALSE((pele::use_batch_kernel<pele::lj_interaction, pele::periodic_distance<3> >::value));
+    EXPECT_TRUE((pele::use_batch_kernel<pele::lj_interaction, pele::cartesian_distance<3> >::value));
+}
+
+TEST(LJBatchTest, EnergyGradient_AgreesWithPairLoop){
+    const size_t natoms = 37;
+    Array<double> x(3 * natoms);
+    for (size_t i = 0; i < natoms; ++i) {
+        // points on a slightly perturbed cubic lattice
+        x[3 * i + 0] = 1.1 * (i % 4) + 0.01 * std::sin(i);
+        x[3 * i + 1] = 1.1 * ((i / 4) % 4) + 0.01 * std::cos(3. * i);
+        x[3 * i + 2] = 1.1 * (i / 16) + 0.01 * std::sin(7. * i);
+    }
+    Array<double> boxvec(3, 1e4);
+    pele::LJ lj(1.2, 2.3);
+    pele::LJPeriodic ljp(1.2, 2.3, boxvec);
+    pele::LJCut ljcut(1.2, 2.3, 2.5);
+    pele::LJCutPeriodic ljcutp(1.2, 2.3, 2.5, boxvec);
+    Array<double> g(x.size()), gp(x.size());
+
+    EXPECT_NEAR(lj.get_energy(x), ljp.get_energy(x), 1e-10 * std::fabs(ljp.get_energy(x)));
+    double e = lj.get_energy_gradient(x, g);
+    double ep = ljp.get_energy_gradient(x, gp);
+    EXPECT_NEAR(e, ep, 1e-10 * std::fabs(ep));
+    for (size_t i = 0; i < x.size(); ++i) {
+        EXPECT_NEAR(g[i], gp[i], 1e-10 * (1 + std::fabs(gp[i])));
+    }
+
+    EXPECT_NEAR(ljcut.get_energy(x), ljcutp.get_energy(x), 1e-10 * std::fabs(ljcutp.get_energy(x)));
+    e = ljcut.get_energy_gradient(x, g);
+    ep = ljcutp.get_energy_gradient(x, gp);
+    EXPECT_NEAR(e, ep, 1e-10 * std::fabs(ep));
+    for (size_t i = 0; i < x.size(); ++i) {
+        EXPECT_NEAR(g[i], gp[i], 1e-10 * (1 + std::fabs(gp[i])));
+    }
+}
@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
+#include <random>
 #include "pele/graph.hpp"
 #include "pele/ngt.hpp"
+#include "pele/indexed_heap.hpp"
+#include "pele/incremental_ngt.hpp"
+#include "pele/multi_query_ngt.hpp"
 
 using pele::NGT;
 using pele::node_id;
@@ -16,6 +20,100 @@ TEST(Graph, AddDuplicateEdges_NoEffect){
     ASSERT_EQ(g.number_of_edges(), 1u);
 }
 
+TEST(Graph, RemoveNode_RemovesEdges){
+    pele::Graph g;
+    g.add_nodes(3);
+    g.add_edge(0, 1);
+    g.add_edge(1, 2);
+    g.add_edge(2, 1);
+    g.add_edge(1, 1);
+    ASSERT_EQ(g.number_of_edges(), 4u);
+    g.remove_node(1);
+    ASSERT_EQ(g.number_of_nodes(), 2u);
+    ASSERT_EQ(g.number_of_edges(), 0u);
+    ASSERT_FALSE(g.has_node(1));
+    ASSERT_EQ(g.out_degree(0), 0u);
+    ASSERT_EQ(g.in_degree(2), 0u);
+    // the freed edge slots are reused
+    pele::edge_id e = g.add_edge(0, 2);
+    ASSERT_LT(e, 4u);
+    ASSERT_EQ(g.get_edge(0, 2), e);
+    ASSERT_EQ(g.get_edge(2, 0), pele::NO_EDGE);
+}
+
+TEST(Graph, Copy_IsIndependent){
+    pele::Graph g;
+    g.add_nodes(3);
+    pele::edge_id e = g.add_edge(0, 2);
+    g.set_P(e, 0.5);
+    g.set_tau(2, 3.);
+    pele::Graph g2(g);
+    g2.remove_node(2);
+    g.set_P(e, 0.25);
+    ASSERT_EQ(g.number_of_edges(), 1u);
+    ASSERT_EQ(g2.number_of_edges(), 0u);
+    ASSERT_EQ(g.get_tau(2), 3.);
+    ASSERT_EQ(g.get_P(g.get_edge(0, 2)), 0.25);
+    ASSERT_EQ(g2.nodes(), std::vector<node_id>({0, 1}));
+}
+
+TEST(Graph, Compacted_RenumbersNodes){
+    pele::Graph g;
+    g.add_nodes(6);
+    g.set_P(g.add_edge(5, 1), 0.5);
+    g.set_P(g.add_edge(1, 5), 0.25);
+    g.set_P(g.add_edge(3, 3), 0.125);
+    g.set_tau(3, 2.);
+    g.remove_node(0);
+    g.remove_node(2);
+    g.remove_node(4);
+    std::vector<node_id> ids;
+    pele::Graph c = g.compacted(ids);
+    ASSERT_EQ(ids, std::vector<node_id>({1, 3, 5}));
+    ASSERT_EQ(c.node_id_bound(), 3u);
+    ASSERT_EQ(c.number_of_edges(), 3u);
+    ASSERT_EQ(c.get_P(c.get_edge(2, 0)), 0.5);
+    ASSERT_EQ(c.get_P(c.get_edge(0, 2)), 0.25);
+    ASSERT_EQ(c.get_P(c.get_edge(1, 1)), 0.125);
+    ASSERT_EQ(c.get_tau(1), 2.);
+    ASSERT_EQ(c.in_degree(0), 1u);
+
+    pele::Graph e = c.expanded(ids, 6);
+    ASSERT_EQ(e.node_id_bound(), 6u);
+    ASSERT_EQ(e.nodes(), std::vector<node_id>({1, 3, 5}));
+    ASSERT_EQ(e.get_P(e.get_edge(5, 1)), 0.5);
+    ASSERT_EQ(e.get_P(e.get_edge(3, 3)), 0.125);
+    ASSERT_EQ(e.get_tau(3), 2.);
+}
+
+TEST(NGT, UnknownNode_Throws){
+    NGT::rate_map_t rate_map;
+    rate_map[std::pair<node_id, node_id>(0, 1)] = 1.;
+    rate_map[std::pair<node_id, node_id>(1, 0)] = 1.;
+    std::list<node_id> A(1, 0), B(1, 7);
+    ASSERT_THROW(NGT(rate_map, A, B), std::invalid_argument);
+}
+
+TEST(IndexedMinHeap, PopsInKeyOrder){
+    pele::IndexedMinHeap heap(6);
+    heap.push(0, 5);
+    heap.push(3, 1);
+    heap.push(4, 3);
+    heap.push(5, 3);
+    heap.push(1, 4);
+    ASSERT_EQ(heap.size(), 5u);
+    ASSERT_FALSE(heap.contains(2));
+    ASSERT_THROW(heap.push(3, 0), std::invalid_argument);
+    // equal keys are ordered by the item
+    heap.update(0, 3);
+    heap.update(3, 6);
+    std::vector<size_t> order;
+    while (! heap.empty()){
+        order.push_back(heap.pop());
+    }
+    ASSERT_EQ(order, std::vector<size_t>({0, 4, 5, 1, 3}));
+}
+
 class NGT3 :  public ::testing::Test
 {
 public:
@@ -104,3 +202,311 @@ TEST_F(NGT10, RatesCommittors_Correct){
 	ASSERT_NEAR(ngt.get_rate_BA_SS(), kBASS, 1e-9);
 }
 
+
+TEST_F(NGT10, MinUpdatesOrder_SameResults){
+    NGT ngt(rate_map, A, B);
+    ngt.set_elimination_order(NGT::MIN_UPDATES);
+    ngt.compute_rates_and_committors();
+    ASSERT_NEAR(ngt.get_rate_AB(), kAB, 1e-9);
+    ASSERT_NEAR(ngt.get_rate_BA(), kBA, 1e-9);
+    ASSERT_NEAR(ngt.get_rate_AB_SS(), kABSS, 1e-9);
+    ASSERT_NEAR(ngt.get_rate_BA_SS(), kBASS, 1e-9);
+
+    NGT ngt_degree(rate_map, A, B);
+    ngt_degree.compute_rates_and_committors();
+    auto q = ngt.get_committors();
+    auto q_degree = ngt_degree.get_committors();
+    ASSERT_EQ(q.size(), 10u);
+    for (auto const & qval : q_degree){
+        ASSERT_NEAR(q.at(qval.first), qval.second, 1e-9);
+    }
+}
+
+/*
+ * a network of L*L nodes on a square lattice with random rates
+ */
+class NGTLattice :  public ::testing::Test
+{
+public:
+    NGT::rate_map_t rate_map;
+    std::set<node_id> A, B;
+    void make_lattice(size_t L){
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> distribution(0.1, 2.);
+        for (size_t i = 0; i < L; ++i){
+            for (size_t j = 0; j < L; ++j){
+                node_id u = i * L + j;
+                if (i + 1 < L){
+                    rate_map[std::pair<node_id, node_id>(u, u + L)] = distribution(generator);
+                    rate_map[std::pair<node_id, node_id>(u + L, u)] = distribution(generator);
+                }
+                if (j + 1 < L){
+                    rate_map[std::pair<node_id, node_id>(u, u + 1)] = distribution(generator);
+                    rate_map[std::pair<node_id, node_id>(u + 1, u)] = distribution(generator);
+                }
+            }
+        }
+        A.insert(0);
+        A.insert(1);
+        B.insert(L * L - 1);
+    }
+};
+
+TEST_F(NGTLattice, Parallel_SameRates){
+    make_lattice(20);
+    NGT ngt(rate_map, A, B);
+    ngt.compute_rates();
+    NGT ngt_parallel(rate_map, A, B);
+    ngt_parallel.set_nr_threads(4);
+    ngt_parallel.compute_rates();
+    EXPECT_NEAR(ngt_parallel.get_rate_AB() / ngt.get_rate_AB(), 1, 1e-10);
+    EXPECT_NEAR(ngt_parallel.get_rate_BA() / ngt.get_rate_BA(), 1, 1e-10);
+    EXPECT_NEAR(ngt_parallel.get_rate_AB_SS() / ngt.get_rate_AB_SS(), 1, 1e-10);
+    EXPECT_NEAR(ngt_parallel.get_rate_BA_SS() / ngt.get_rate_BA_SS(), 1, 1e-10);
+    ASSERT_THROW(ngt.set_nr_threads(0), std::invalid_argument);
+}
+
+TEST_F(NGTLattice, Parallel_SameCommittors){
+    make_lattice(17);
+    NGT ngt(rate_map, A, B);
+    ngt.compute_rates_and_committors();
+    NGT ngt_parallel(rate_map, A, B);
+    ngt_parallel.set_nr_threads(3);
+    ngt_parallel.compute_rates_and_committors();
+    EXPECT_NEAR(ngt_parallel.get_rate_AB() / ngt.get_rate_AB(), 1, 1e-10);
+    auto q = ngt.get_committors();
+    auto q_parallel = ngt_parallel.get_committors();
+    ASSERT_EQ(q.size(), 17u * 17u);
+    for (auto const & qval : q){
+        EXPECT_NEAR(q_parallel.at(qval.first), qval.second, 1e-10);
+    }
+}
+
+TEST_F(NGTLattice, Incremental_SameRates){
+    const size_t L = 12;
+    make_lattice(L);
+    A.clear();
+    B.clear();
+    A.insert(0);
+    B.insert(1);
+    // add the rows of the lattice one at a time
+    std::vector<NGT::rate_map_t> batches(L);
+    for (auto const & mapval : rate_map){
+        size_t row = std::max(mapval.first.first, mapval.first.second) / L;
+        batches[row].insert(mapval);
+    }
+    pele::IncrementalNGT incremental(batches[0], A, B);
+    NGT::rate_map_t all_rates = batches[0];
+    for (size_t i = 0; i < L; ++i){
+        if (i > 0){
+            incremental.add_rates(batches[i]);
+            all_rates.insert(batches[i].begin(), batches[i].end());
+        }
+        incremental.compute_rates();
+        NGT ngt(all_rates, A, B);
+        ngt.compute_rates();
+        EXPECT_NEAR(incremental.get_rate_AB() / ngt.get_rate_AB(), 1, 1e-9);
+        EXPECT_NEAR(incremental.get_rate_BA() / ngt.get_rate_BA(), 1, 1e-9);
+        EXPECT_NEAR(incremental.get_rate_AB_SS() / ngt.get_rate_AB_SS(), 1, 1e-9);
+        EXPECT_NEAR(incremental.get_rate_BA_SS() / ngt.get_rate_BA_SS(), 1, 1e-9);
+    }
+    ASSERT_EQ(incremental.get_number_of_restored_nodes(), 0u);
+    ASSERT_EQ(incremental.get_number_of_rebuilds(), 0u);
+    // only the last two rows and A and B are left in the graph
+    ASSERT_EQ(incremental.get_number_of_nodes(), 2 * L + 2);
+
+    // a second transition state between two nodes that were removed
+    NGT::rate_map_t extra;
+    extra[std::pair<node_id, node_id>(L + 3, L + 4)] = 0.5;
+    extra[std::pair<node_id, node_id>(L + 4, L + 3)] = 0.25;
+    incremental.add_rates(extra);
+    ASSERT_THROW(incremental.get_rate_AB(), std::runtime_error);
+    incremental.compute_rates();
+    // the rows were removed one after the other, so most removals depend on these nodes
+    ASSERT_EQ(incremental.get_number_of_rebuilds(), 1u);
+    for (auto const & mapval : extra){
+        all_rates[mapval.first] += mapval.second;
+    }
+    NGT ngt(all_rates, A, B);
+    ngt.compute_rates();
+    EXPECT_NEAR(incremental.get_rate_AB() / ngt.get_rate_AB(), 1, 1e-9);
+    EXPECT_NEAR(incremental.get_rate_BA() / ngt.get_rate_BA(), 1, 1e-9);
+}
+
+TEST_F(NGTLattice, Incremental_WeightsSameRates){
+    const size_t L = 8;
+    make_lattice(L);
+    std::map<node_id, double> Peq;
+    for (node_id u = 0; u < L * L; ++u){
+        Peq[u] = 1. + u % 3;
+    }
+    NGT::rate_map_t first, second;
+    for (auto const & mapval : rate_map){
+        if (std::max(mapval.first.first, mapval.first.second) < L * L / 2){
+            first.insert(mapval);
+        } else {
+            second.insert(mapval);
+        }
+    }
+    pele::IncrementalNGT incremental(first, A, B);
+    // B is not in the network yet
+    ASSERT_THROW(incremental.compute_rates(), std::invalid_argument);
+    incremental.set_node_occupation_probabilities(Peq);
+    incremental.add_rates(second);
+    incremental.compute_rates();
+    NGT ngt(rate_map, A, B);
+    ngt.set_node_occupation_probabilities(Peq);
+    ngt.compute_rates();
+    EXPECT_NEAR(incremental.get_rate_AB() / ngt.get_rate_AB(), 1, 1e-9);
+    EXPECT_NEAR(incremental.get_rate_BA() / ngt.get_rate_BA(), 1, 1e-9);
+    EXPECT_NEAR(incremental.get_rate_AB_SS() / ngt.get_rate_AB_SS(), 1, 1e-9);
+    EXPECT_NEAR(incremental.get_rate_BA_SS() / ngt.get_rate_BA_SS(), 1, 1e-9);
+}
+
+TEST_F(NGTLattice, Incremental_AttachToRemovedNodes){
+    const size_t L = 30;
+    make_lattice(L);
+    A.clear();
+    B.clear();
+    A.insert(0);
+    B.insert(L - 1);
+    // add the rows of the lattice one at a time
+    std::vector<NGT::rate_map_t> batches(L);
+    for (auto const & mapval : rate_map){
+        size_t row = std::max(mapval.first.first, mapval.first.second) / L;
+        batches[row].insert(mapval);
+    }
+    pele::IncrementalNGT incremental(batches[0], A, B);
+    NGT::rate_map_t all_rates = batches[0];
+    for (size_t i = 1; i < L; ++i){
+        incremental.add_rates(batches[i]);
+        all_rates.insert(batches[i].begin(), batches[i].end());
+        incremental.compute_rates();
+    }
+    ASSERT_EQ(incremental.get_number_of_restored_nodes(), 0u);
+    ASSERT_EQ(incremental.get_number_of_rebuilds(), 0u);
+
+    /*
+     * new transition states that connect new minima and old minima, which
+     * were removed long ago, as in a double ended connect run.  The rows
+     * were removed one after the other, so at first most removals depend on
+     * each other and the graph is rebuilt.  After that all nodes are removed
+     * in the elimination order, and only the few removals that depend on the
+     * old minima are undone.
+     */
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> uniform(0.1, 2.);
+    for (size_t i = 0; i < 10; ++i){
+        node_id old_min = (3 + 2 * i) * L + 5 + i;
+        node_id new_min = L * L + i;
+        NGT::rate_map_t ts;
+        ts[std::make_pair(old_min, new_min)] = uniform(generator);
+        ts[std::make_pair(new_min, old_min)] = uniform(generator);
+        ts[std::make_pair(old_min, old_min + 2 * L)] = uniform(generator);
+        ts[std::make_pair(old_min + 2 * L, old_min)] = uniform(generator);
+        size_t restored_before = incremental.get_number_of_restored_nodes();
+        size_t removed = L * L + i - incremental.get_number_of_nodes();
+        incremental.add_rates(ts);
+        size_t restored = incremental.get_number_of_restored_nodes() - restored_before;
+        ASSERT_EQ(incremental.get_number_of_rebuilds(), 1u);
+        if (i > 0){
+            ASSERT_GE(restored, 1u);
+            ASSERT_LE(restored, removed / 10);
+        }
+        for (auto const & mapval : ts){
+            all_rates[mapval.first] += mapval.second;
+        }
+        incremental.compute_rates();
+        NGT ngt(all_rates, A, B);
+        ngt.compute_rates();
+        EXPECT_NEAR(incremental.get_rate_AB() / ngt.get_rate_AB(), 1, 1e-9);
+        EXPECT_NEAR(incremental.get_rate_BA() / ngt.get_rate_BA(), 1, 1e-9);
+        EXPECT_NEAR(incremental.get_rate_AB_SS() / ngt.get_rate_AB_SS(), 1, 1e-9);
+        EXPECT_NEAR(incremental.get_rate_BA_SS() / ngt.get_rate_BA_SS(), 1, 1e-9);
+    }
+}
+
+TEST_F(NGT10, MultiQuery_SameResults){
+    std::list<node_id> candidates = {0, 1, 2, 3, 4, 5, 7};
+    pele::MultiQueryNGT multi(rate_map, candidates);
+    ASSERT_EQ(multi.get_reduced_graph()->number_of_nodes(), 7u);
+    auto result = multi.query(A, B, true);
+    ASSERT_NEAR(result->get_rate_AB(), kAB, 1e-9);
+    ASSERT_NEAR(result->get_rate_BA(), kBA, 1e-9);
+    ASSERT_NEAR(result->get_rate_AB_SS(), kABSS, 1e-9);
+    ASSERT_NEAR(result->get_rate_BA_SS(), kBASS, 1e-9);
+
+    NGT ngt(rate_map, A, B);
+    ngt.compute_rates_and_committors();
+    auto q = result->get_committors();
+    ASSERT_EQ(q.size(), 7u);
+    ASSERT_NEAR(q.at(7), ngt.get_committors().at(7), 1e-9);
+
+    // the reduced graph is not changed by a query
+    ASSERT_EQ(multi.get_reduced_graph()->number_of_nodes(), 7u);
+    std::list<node_id> not_candidate(1, 6);
+    ASSERT_THROW(multi.query(not_candidate, B), std::invalid_argument);
+    ASSERT_THROW(multi.query(A, A), std::invalid_argument);
+}
+
+TEST_F(NGTLattice, MultiQuery_SameRates){
+    const size_t L = 10;
+    make_lattice(L);
+    std::vector<std::set<node_id> > funnels(4);
+    funnels[0] = {0, 1, L};
+    funnels[1] = {L - 1, L - 2};
+    funnels[2] = {L * L - 1};
+    funnels[3] = {L * (L / 2) + L / 2, L * (L / 2) + L / 2 + 1};
+    std::set<node_id> candidates;
+    for (auto const & funnel : funnels){
+        candidates.insert(funnel.begin(), funnel.end());
+    }
+    pele::MultiQueryNGT multi(rate_map, candidates);
+    for (size_t i = 0; i < funnels.size(); ++i){
+        for (size_t j = i + 1; j < funnels.size(); ++j){
+            auto result = multi.query(funnels[i], funnels[j]);
+            NGT ngt(rate_map, funnels[i], funnels[j]);
+            ngt.compute_rates();
+            EXPECT_NEAR(result->get_rate_AB() / ngt.get_rate_AB(), 1, 1e-9);
+            EXPECT_NEAR(result->get_rate_BA() / ngt.get_rate_BA(), 1, 1e-9);
+            EXPECT_NEAR(result->get_rate_AB_SS() / ngt.get_rate_AB_SS(), 1, 1e-9);
+            EXPECT_NEAR(result->get_rate_BA_SS() / ngt.get_rate_BA_SS(), 1, 1e-9);
+        }
+    }
+}
+
+TEST(MultiQueryNGT, QueryCost_IndependentOfEliminatedNodes){
+    // the same 20 candidates on chains of very different length
+    const size_t ncandidates = 20;
+    for (size_t N : {1000, 10000}){
+        NGT::rate_map_t rate_map;
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> distribution(0.1, 2.);
+        for (node_id u = 0; u + 1 < N; ++u){
+            double k = distribution(generator);
+            rate_map[std::pair<node_id, node_id>(u, u + 1)] = k;
+            rate_map[std::pair<node_id, node_id>(u + 1, u)] = k;
+        }
+        std::vector<node_id> candidates;
+        for (size_t i = 0; i < ncandidates; ++i){
+            candidates.push_back(i * (N - 1) / (ncandidates - 1));
+        }
+        pele::MultiQueryNGT multi(rate_map, candidates);
+        ASSERT_EQ(multi.get_candidates(), candidates);
+        ASSERT_EQ(multi.get_reduced_graph()->node_id_bound(), ncandidates);
+
+        std::list<node_id> A(1, candidates[0]);
+        std::list<node_id> B(1, candidates[ncandidates / 2]);
+        auto result = multi.query(A, B, true);
+        ASSERT_EQ(result->get_ngt()->initial_tau.size(), ncandidates);
+        auto q = result->get_committors();
+        ASSERT_EQ(q.size(), ncandidates);
+        ASSERT_EQ(q.begin()->first, candidates[0]);
+        ASSERT_EQ(q.rbegin()->first, candidates.back());
+
+        NGT ngt(rate_map, A, B);
+        ngt.compute_rates();
+        EXPECT_NEAR(result->get_rate_AB() / ngt.get_rate_AB(), 1, 1e-9);
+        EXPECT_NEAR(result->get_rate_BA() / ngt.get_rate_BA(), 1, 1e-9);
+    }
+}
@@ -0,0 +1,128 @@
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "pele/cg.h"
+#include "pele/lbfgs.h"
+#include "pele/linesearch.h"
+#include "pele/lj.h"
+#include "pele/modified_fire.h"
+#include "pele/optimizer_trace.h"
+
+using pele::Array;
+
+namespace {
+
+/**
+ * a reproducible, not very good starting configuration for an LJ cluster
+ */
+Array<double> lj_start(size_t natoms)
+{
+    Array<double> x(3 * natoms);
+    for (size_t i = 0; i < x.size(); ++i){
+        x[i] = 1.6 * std::sin(7.3 * i + 0.4);
+    }
+    return x;
+}
+
+}
+
+#ifdef PELE_OPTIMIZER_TRACE
+
+TEST(OptimizerTrace, RingBuffer_Works){
+    pele::OptimizerTrace trace;
+    EXPECT_FALSE(trace.is_enabled());
+    EXPECT_THROW(trace.enable(0), std::invalid_argument);
+    trace.enable(3);
+    EXPECT_TRUE(trace.is_enabled());
+    EXPECT_EQ(trace.capacity(), 3u);
+    for (int i = 1; i <= 5; ++i) {
+        trace.time_potential([]() { return 0; });
+        trace.record(i, -i, 1. / i, 0.1, 2 * i);
+    }
+    ASSERT_EQ(trace.size(), 3u);
+    for (size_t i = 0; i < 3; ++i) {
+        pele::OptimizerTraceRecord const & r = trace.get(i);
+        EXPECT_EQ(r.iteration, int(i) + 3);
+        EXPECT_DOUBLE_EQ(r.energy, -double(i + 3));
+        EXPECT_EQ(r.nfev, 2);
+        EXPECT_GE(r.potential_time, 0);
+        EXPECT_GE(r.wall_time, r.potential_time);
+    }
+    EXPECT_THROW(trace.get(3), std::out_of_range);
+    trace.clear();
+    EXPECT_EQ(trace.size(), 0u);
+    trace.disable();
+    EXPECT_FALSE(trace.is_enabled());
+}
+
+TEST(OptimizerTrace, LineSearch_TimesPotentialCalls){
+    pele::LJ lj(1., 1.);
+    Array<double> x = lj_start(13);
+    Array<double> g(x.size());
+    const double f = lj.get_energy_gradient(x, g);
+    Array<double> p(x.size());
+    for (size_t i = 0; i < x.size(); ++i){
+        p[i] = -g[i] / pele::norm(g);
+    }
+    pele::MoreThuenteLineSearch ls;
+    Array<double> xnew(x.size());
+    Array<double> gnew(x.size());
+    double fnew;
+    int nfev = 0;
+    pele::OptimizerTrace trace;
+    trace.enable(1);
+    ls.search(lj, x, f, g, p, 1., 10., xnew, fnew, gnew, nfev, &trace);
+    trace.record(1, fnew, 0, 0, nfev);
+    EXPECT_EQ(trace.get(0).nfev, nfev);
+    EXPECT_GT(trace.get(0).potential_time, 0);
+    EXPECT_GE(trace.get(0).wall_time, trace.get(0).potential_time);
+}
+
+TEST(OptimizerTrace, Optimizers_RecordIterations){
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    Array<double> x0 = lj_start(13);
+    std::vector<std::shared_ptr<pele::GradientOptimizer> > optimizers;
+    optimizers.push_back(std::make_shared<pele::LBFGS>(lj, x0));
+    optimizers.push_back(std::make_shared<pele::CG>(lj, x0));
+    optimizers.push_back(std::make_shared<pele::MODIFIED_FIRE>(lj, x0, 0.1, 1., 0.5));
+    for (auto opt : optimizers) {
+        opt->set_max_iter(20);
+        opt->enable_trace(8);
+        opt->run();
+        pele::OptimizerTrace const & trace = opt->get_trace();
+        ASSERT_EQ(trace.size(), 8u);
+        EXPECT_EQ(trace.get(7).iteration, opt->get_niter());
+        EXPECT_DOUBLE_EQ(trace.get(7).energy, opt->get_f());
+        EXPECT_DOUBLE_EQ(trace.get(7).rms, opt->get_rms());
+        int nfev = 0;
+        for (size_t i = 0; i < trace.size(); ++i) {
+            pele::OptimizerTraceRecord const & r = trace.get(i);
+            EXPECT_EQ(r.iteration, opt->get_niter() - 7 + int(i));
+            EXPECT_GE(r.nfev, 1);
+            EXPECT_GE(r.stepsize, 0);
+            EXPECT_GT(r.potential_time, 0);
+            EXPECT_GE(r.wall_time, r.potential_time);
+            nfev += r.nfev;
+        }
+        EXPECT_LE(nfev, opt->get_nfev());
+        opt->disable_trace();
+        EXPECT_FALSE(opt->get_trace().is_enabled());
+    }
+}
+
+#else
+
+TEST(OptimizerTrace, DisabledAtCompileTime_Throws){
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    pele::LBFGS lbfgs(lj, lj_start(4));
+    EXPECT_THROW(lbfgs.enable_trace(10), std::runtime_error);
+    lbfgs.run();
+    EXPECT_EQ(lbfgs.get_trace().size(), 0u);
+    EXPECT_FALSE(lbfgs.get_trace().is_enabled());
+    EXPECT_THROW(lbfgs.get_trace().get(0), std::out_of_range);
+}
+
+#endif
@@ -0,0 +1,120 @@
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "pele/array.h"
+#include "pele/inversepower.h"
+#include "pele/lbfgs.h"
+#include "pele/lj.h"
+#include "pele/preconditioner.h"
+
+using pele::Array;
+
+/**
+ * a quadratic potential with very different stiffnesses
+ * E = sum_i k_i x_i^2 / 2
+ */
+class BadlyScaledQuadratic : public pele::BasePotential {
+public:
+    Array<double> k;
+    BadlyScaledQuadratic(size_t n)
+        : k(n)
+    {
+        for (size_t i = 0; i < n; ++i) {
+            k[i] = std::pow(10., 4. * i / (n - 1));
+        }
+    }
+    virtual double get_energy(Array<double> x)
+    {
+        double e = 0;
+        for (size_t i = 0; i < x.size(); ++i) {
+            e += 0.5 * k[i] * x[i] * x[i];
+        }
+        return e;
+    }
+    virtual double get_energy_gradient(Array<double> x, Array<double> grad)
+    {
+        for (size_t i = 0; i < x.size(); ++i) {
+            grad[i] = k[i] * x[i];
+        }
+        return get_energy(x);
+    }
+};
+
+TEST(PreconditionerTest, HessianDiagonal_AgreesWithHessian)
+{
+    const size_t natoms = 10;
+    Array<double> x(3 * natoms);
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = 1.3 * std::sin(2.1 * i + 0.3);
+    }
+    pele::LJ lj(1., 1.);
+    Array<double> radii(natoms, 0.6);
+    Array<double> boxvec(3, 4.);
+    pele::InversePowerPeriodicCellLists<3> ip(2.5, 1., radii, boxvec);
+    for (pele::BasePotential * pot : std::vector<pele::BasePotential *>{&lj, &ip}) {
+        Array<double> grad(x.size());
+        Array<double> hess(x.size() * x.size());
+        pot->get_energy_gradient_hessian(x, grad, hess);
+        Array<double> diag(x.size());
+        pot->get_hessian_diagonal(x, diag);
+        for (size_t i = 0; i < x.size(); ++i) {
+            const double h = hess[x.size() * i + i];
+            EXPECT_NEAR(diag[i], h, 1e-10 * (1 + std::fabs(h)));
+        }
+    }
+}
+
+TEST(PreconditionerTest, Diagonal_ReducesIterations)
+{
+    const size_t n = 30;
+    auto pot = std::make_shared<BadlyScaledQuadratic>(n);
+    Array<double> x0(n, 1.);
+    pele::LBFGS lbfgs1(pot, x0, 1e-8);
+    lbfgs1.set_max_iter(10000);
+    lbfgs1.run();
+    pele::LBFGS lbfgs2(pot, x0, 1e-8);
+    lbfgs2.set_preconditioner(std::make_shared<pele::DiagonalPreconditioner>(pot->k));
+    lbfgs2.run();
+    ASSERT_TRUE(lbfgs1.success());
+    ASSERT_TRUE(lbfgs2.success());
+    EXPECT_LT(5 * lbfgs2.get_niter(), lbfgs1.get_niter());
+    for (size_t i = 0; i < n; ++i) {
+        EXPECT_NEAR(lbfgs2.get_x()[i], 0, 1e-6);
+    }
+}
+
+TEST(PreconditionerTest, HessianDiagonalPreconditioner_Works)
+{
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    Array<double> x0(3 * 13);
+    for (size_t i = 0; i < x0.size(); ++i) {
+        x0[i] = 1.6 * std::sin(7.3 * i + 0.4);
+    }
+    pele::LBFGS lbfgs(lj, x0, 1e-6);
+    auto precond = std::make_shared<pele::HessianDiagonalPreconditioner>(lj, 5);
+    lbfgs.set_preconditioner(precond);
+    lbfgs.run();
+    ASSERT_TRUE(lbfgs.success());
+    Array<double> g(x0.size());
+    const double e = lj->get_energy_gradient(lbfgs.get_x(), g);
+    EXPECT_NEAR(e, lbfgs.get_f(), 1e-10);
+    EXPECT_LE(pele::norm(g) / std::sqrt(g.size()), 1e-6);
+    Array<double> inv = precond->get_inverse_diagonal();
+    for (double const d : inv) {
+        EXPECT_GT(d, 0);
+    }
+}
+
+TEST(PreconditionerTest, IllegalInput_Throws)
+{
+    Array<double> diag(3, 1.);
+    diag[1] = 0;
+    EXPECT_THROW(pele::DiagonalPreconditioner p(diag), std::invalid_argument);
+    pele::DiagonalPreconditioner p(Array<double>(3, 2.));
+    EXPECT_THROW(p.apply(Array<double>(4)), std::invalid_argument);
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    EXPECT_THROW(pele::HessianDiagonalPreconditioner(lj, 0), std::invalid_argument);
+}
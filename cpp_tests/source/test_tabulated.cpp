@@ -0,0 +1,110 @@
+#include "pele/array.h"
+#include "pele/inversepower.h"
+#include "pele/lj.h"
+#include "pele/tabulated_interaction.h"
+
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <gtest/gtest.h>
+
+using pele::Array;
+using pele::InversePower_interaction;
+using pele::TabulatedInteraction;
+
+TEST(TabulatedInteractionTest, InversePower_AgreesWithBase)
+{
+    const double tol = 1e-8;
+    Array<double> radii(2, 0.5);
+    auto base = std::make_shared<InversePower_interaction>(2.5, 1., radii);
+    TabulatedInteraction<InversePower_interaction> table(base, 0.2, 1., tol);
+    EXPECT_GT(table.get_nr_points(), 64u);
+    for (double r = 0.1; r < 1.2; r += 0.00731) {
+        const double r2 = r * r;
+        double g, g_base, h, h_base;
+        const double e = table.energy_gradient_hessian(r2, &g, &h, 0, 1);
+        const double e_base = base->energy_gradient_hessian(r2, &g_base, &h_base, 0, 1);
+        EXPECT_NEAR(e, e_base, 10 * tol * (1 + std::fabs(e_base)));
+        EXPECT_NEAR(g, g_base, 10 * tol * (1 + std::fabs(g_base)));
+        EXPECT_NEAR(h, h_base, 1e-4 * (1 + std::fabs(h_base)));
+        EXPECT_DOUBLE_EQ(table.energy(r2, 0, 1), e);
+        double g2;
+        EXPECT_DOUBLE_EQ(table.energy_gradient(r2, &g2, 0, 1), e);
+        EXPECT_DOUBLE_EQ(g2, g);
+    }
+}
+
+TEST(TabulatedInteractionTest, LJ_AgreesWithBase)
+{
+    const double tol = 1e-8;
+    auto base = std::make_shared<pele::lj_interaction>(1., 1.);
+    TabulatedInteraction<pele::lj_interaction> table(base, 0.8, 3., tol);
+    for (double r = 0.85; r < 3.; r += 0.0137) {
+        double g, g_base;
+        const double e = table.energy_gradient(r * r, &g, 0, 0);
+        const double e_base = base->energy_gradient(r * r, &g_base, 0, 0);
+        EXPECT_NEAR(e, e_base, 10 * tol * (1 + std::fabs(e_base)));
+        EXPECT_NEAR(g, g_base, 10 * tol * (1 + std::fabs(g_base)));
+    }
+}
+
+/**
+ * cell list potential for tabulated bidisperse soft spheres
+ */
+class TabulatedInversePowerCellLists : public pele::CellListPotential<
+        TabulatedInteraction<InversePower_interaction>, pele::periodic_distance<3> > {
+public:
+    TabulatedInversePowerCellLists(double pow, double eps, Array<double> radii,
+            Array<size_t> atom_types, Array<double> boxvec, double tol)
+        : pele::CellListPotential<TabulatedInteraction<InversePower_interaction>,
+              pele::periodic_distance<3> >(
+                  std::make_shared<TabulatedInteraction<InversePower_interaction> >(
+                      std::make_shared<InversePower_interaction>(pow, eps, radii),
+                      0.1, 2 * *std::max_element(radii.begin(), radii.end()), tol, atom_types),
+                  std::make_shared<pele::periodic_distance<3> >(boxvec),
+                  boxvec, 2 * *std::max_element(radii.begin(), radii.end()), 1.)
+    {}
+};
+
+TEST(TabulatedInteractionTest, BidisperseCellLists_AgreesWithInversePower)
+{
+    const size_t N = 200;
+    Array<double> boxvec(3, 6.);
+    Array<double> radii(N);
+    Array<size_t> atom_types(N);
+    Array<double> x(3 * N);
+    std::mt19937_64 gen(60);
+    std::uniform_real_distribution<double> position(0, 6.);
+    for (size_t i = 0; i < N; ++i) {
+        atom_types[i] = i % 2;
+        radii[i] = 0.5 + 0.2 * atom_types[i];
+        for (size_t k = 0; k < 3; ++k) {
+            x[3 * i + k] = position(gen);
+        }
+    }
+    pele::InversePowerPeriodicCellLists<3> pot_ref(2.5, 1., radii, boxvec);
+    TabulatedInversePowerCellLists pot(2.5, 1., radii, atom_types, boxvec, 1e-9);
+    Array<double> g(x.size());
+    Array<double> g_ref(x.size());
+    const double e = pot.get_energy_gradient(x, g);
+    const double e_ref = pot_ref.get_energy_gradient(x, g_ref);
+    EXPECT_GT(e_ref, 1.);
+    EXPECT_NEAR(e, e_ref, 1e-7 * e_ref);
+    for (size_t i = 0; i < x.size(); ++i) {
+        EXPECT_NEAR(g[i], g_ref[i], 1e-7 * (1 + std::fabs(g_ref[i])));
+    }
+}
+
+TEST(TabulatedInteractionTest, IllegalInput_Throws)
+{
+    Array<double> radii(2, 0.5);
+    auto base = std::make_shared<InversePower_interaction>(2.5, 1., radii);
+    typedef TabulatedInteraction<InversePower_interaction> table_t;
+    EXPECT_THROW(table_t(base, 0., 1.), std::invalid_argument);
+    EXPECT_THROW(table_t(base, 1., 0.5), std::invalid_argument);
+    EXPECT_THROW(table_t(base, 0.2, 1., -1.), std::invalid_argument);
+    Array<size_t> missing_type(2, 1);
+    EXPECT_THROW(table_t(base, 0.2, 1., 1e-8, missing_type), std::invalid_argument);
+}
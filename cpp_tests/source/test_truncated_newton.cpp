@@ -0,0 +1,156 @@
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+#include "pele/lbfgs.h"
+#include "pele/lj.h"
+#include "pele/truncated_newton.h"
+
+using pele::Array;
+
+namespace {
+
+/**
+ * a reproducible, not very good starting configuration for an LJ cluster
+ */
+Array<double> lj_start(size_t natoms)
+{
+    Array<double> x(3 * natoms);
+    for (size_t i = 0; i < x.size(); ++i){
+        x[i] = 1.6 * std::sin(7.3 * i + 0.4);
+    }
+    return x;
+}
+
+/**
+ * a minimum of LJ13, perturbed and then minimized with LBFGS to a loose
+ * tolerance
+ */
+Array<double> lj_near_minimum(std::shared_ptr<pele::LJ> lj, double tol)
+{
+    Array<double> x(39);
+    for (size_t i = 0; i < x.size(); ++i){
+        x[i] = 1.2 * std::sin(7.3 * i + 0.4);
+    }
+    pele::LBFGS lbfgs1(lj, x, 1e-6);
+    lbfgs1.run();
+    x = lbfgs1.get_x();
+    for (size_t i = 0; i < x.size(); ++i){
+        x[i] += 0.05 * std::sin(3.1 * i);
+    }
+    pele::LBFGS lbfgs2(lj, x, tol);
+    lbfgs2.run();
+    return lbfgs2.get_x();
+}
+
+/**
+ * E = sum_i (x_i^4 / 4 - x_i^2 / 2), which has negative curvature around 0
+ */
+class DoubleWell : public pele::BasePotential {
+public:
+    virtual double get_energy(Array<double> x)
+    {
+        double e = 0;
+        for (double const xi : x) {
+            e += 0.25 * xi * xi * xi * xi - 0.5 * xi * xi;
+        }
+        return e;
+    }
+    virtual double get_energy_gradient(Array<double> x, Array<double> grad)
+    {
+        for (size_t i = 0; i < x.size(); ++i) {
+            grad[i] = x[i] * x[i] * x[i] - x[i];
+        }
+        return get_energy(x);
+    }
+};
+
+}
+
+TEST(TruncatedNewtonLJ, Polish_ConvergesTightly){
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    Array<double> x0 = lj_near_minimum(lj, 1e-3);
+    Array<double> g0(x0.size());
+    const double e0 = lj->get_energy_gradient(x0, g0);
+
+    pele::TruncatedNewton tn(lj, x0, 1e-10);
+    tn.set_func_gradient(e0, g0);
+    tn.run();
+    ASSERT_TRUE(tn.success());
+    EXPECT_LE(tn.get_niter(), 5);
+    EXPECT_EQ(tn.get_nfev(), tn.get_niter());
+    EXPECT_GT(tn.get_nhev(), 0);
+    EXPECT_LE(tn.get_f(), e0);
+
+    Array<double> g(x0.size());
+    const double e = lj->get_energy_gradient(tn.get_x(), g);
+    EXPECT_DOUBLE_EQ(e, tn.get_f());
+    EXPECT_LE(pele::norm(g) / std::sqrt(g.size()), 1e-10);
+}
+
+TEST(TruncatedNewtonLJ, ConvergesSuperlinearly){
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    pele::TruncatedNewton tn(lj, lj_near_minimum(lj, 1e-2), 1e-11);
+    double rms_old = tn.get_rms();
+    int nfast = 0;
+    while (! tn.success() && tn.get_niter() < 100) {
+        tn.one_iteration();
+        if (tn.get_rms() < 1e-2 * rms_old) {
+            ++nfast;
+        }
+        rms_old = tn.get_rms();
+    }
+    ASSERT_TRUE(tn.success());
+    // near the minimum every step reduces the gradient by a large factor
+    EXPECT_GE(nfast, 2);
+}
+
+TEST(TruncatedNewtonLJ, EscapesSaddle){
+    // LBFGS stops near a saddle point of this fragmented structure.  The
+    // negative curvature directions take truncated Newton to a minimum
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    pele::LBFGS lbfgs(lj, lj_start(13), 1e-3);
+    lbfgs.run();
+    pele::TruncatedNewton tn(lj, lbfgs.get_x(), 1e-8);
+    tn.run();
+    ASSERT_TRUE(tn.success());
+    EXPECT_LT(tn.get_f(), lbfgs.get_f() - 1);
+}
+
+TEST(TruncatedNewton, NegativeCurvature_Works){
+    auto pot = std::make_shared<DoubleWell>();
+    Array<double> x0(5);
+    for (size_t i = 0; i < x0.size(); ++i) {
+        x0[i] = 0.1 * (i + 1) * ((i % 2) ? -1 : 1);
+    }
+    pele::TruncatedNewton tn(pot, x0, 1e-10);
+    tn.set_maxstep(0.5);
+    tn.run();
+    ASSERT_TRUE(tn.success());
+    for (size_t i = 0; i < x0.size(); ++i) {
+        EXPECT_NEAR(std::fabs(tn.get_x()[i]), 1, 1e-8);
+        EXPECT_GT(tn.get_x()[i] * x0[i], 0);
+    }
+    EXPECT_LE(tn.get_trust_radius(), 0.5);
+}
+
+TEST(TruncatedNewton, Reset_Works){
+    auto lj = std::make_shared<pele::LJ>(1., 1.);
+    Array<double> x0 = lj_start(7);
+    pele::TruncatedNewton tn1(lj, x0, 1e-8);
+    tn1.run();
+    pele::TruncatedNewton tn2(lj, lj_start(8), 1e-8);
+    EXPECT_THROW(tn2.reset(x0), std::invalid_argument);
+    Array<double> x1 = x0.copy();
+    x1 += 0.1;
+    pele::TruncatedNewton tn3(lj, x1, 1e-8);
+    tn3.run();
+    tn3.reset(x0);
+    tn3.run();
+    EXPECT_EQ(tn1.get_niter(), tn3.get_niter());
+    EXPECT_EQ(tn1.get_nfev(), tn3.get_nfev());
+    EXPECT_DOUBLE_EQ(tn1.get_f(), tn3.get_f());
+    EXPECT_THROW(tn3.set_max_cg_iter(0), std::invalid_argument);
+}
@@ -54,6 +54,50 @@ public:
             ASSERT_NEAR(h[i], hnum[i], 1e-3);
         }
     }
+
+    void test_hessian_vector_product(){
+        const size_t N = x.size();
+        g = Array<double>(N);
+        h = Array<double>(N*N);
+        Array<double> v(N), hv(N), hvnum(N);
+        for (size_t i=0; i<N; ++i){
+            v[i] = std::cos(0.3 + i);
+        }
+        pot->get_energy_gradient_hessian(x, g, h);
+        pot->get_hessian_vector_product(x, v, hv);
+        pot->numerical_hessian_vector_product(x, v, hvnum);
+        for (size_t i=0; i<N; ++i){
+            double hvtrue = 0;
+            for (size_t j=0; j<N; ++j){
+                hvtrue += h[N*i + j] * v[j];
+            }
+            ASSERT_NEAR(hv[i], hvtrue, 1e-10 * (1 + std::fabs(hvtrue)));
+            ASSERT_NEAR(hvnum[i], hvtrue, 1e-3);
+        }
+    }
+
+    void test_batch(size_t nr_threads){
+        const size_t N = x.size();
+        const size_t nconf = 5;
+        Array<double> xs(nconf*N), es(nconf), gs(nconf*N), es2(nconf);
+        for (size_t c=0; c<nconf; ++c){
+            for (size_t i=0; i<N; ++i){
+                xs[c*N + i] = x[i] + 0.01 * std::sin(1. + c*N + i);
+            }
+        }
+        pot->get_energy_gradient_batch(xs, es, gs, nr_threads);
+        pot->get_energy_batch(xs, es2, nr_threads);
+        g = Array<double>(N);
+        for (size_t c=0; c<nconf; ++c){
+            Array<double> xc(xs.data() + c*N, N);
+            double e = pot->get_energy_gradient(xc, g);
+            EXPECT_DOUBLE_EQ(es[c], e);
+            EXPECT_DOUBLE_EQ(es2[c], e);
+            for (size_t i=0; i<N; ++i){
+                EXPECT_DOUBLE_EQ(gs[c*N + i], g[i]);
+            }
+        }
+    }
 };
 
 #endif
@@ -11,7 +11,13 @@ class BasinHopping(MonteCarlo):
     ----------
     All required and optional parameters from base class MonteCarlo :
     quench : callable, optional
-        Use this quencher as default
+        Use this quencher as default.  If it is a two stage quench, like
+        pele.optimize.TwoStageQuench, each trial is first only quenched to the
+        loose tolerance.  The quench is continued to the tight tolerance only
+        if the step is accepted, or if it is rejected but will be inserted
+        into the storage because insert_rejected is set and the minimum is
+        not in the database yet.  The acceptance test uses the energy after
+        the first stage.
     insert_rejected : bool
         insert the rejected structure into the storage class
     
@@ -63,6 +69,8 @@ class BasinHopping(MonteCarlo):
         if quench is None:
             quench = lambda coords : mylbfgs(coords, self.potential)
         self.quench = quench
+        self.two_stage_quench = hasattr(quench, "loose") and hasattr(quench, "tighten")
+        self.ntight_quenches = 0
                 
         #########################################################################
         # do initial quench
@@ -105,24 +113,19 @@ class BasinHopping(MonteCarlo):
         #########################################################################
         # quench
         #########################################################################
-        res = self.quench(self.coords_after_step)
+        if self.two_stage_quench:
+            res = self.quench.loose(self.coords_after_step)
+        else:
+            res = self.quench(self.coords_after_step)
         self.result.nfev += res.nfev
 #        if isinstance(res, tuple): # for compatability with old and new quenchers
 #            res = res[4]
-        self.trial_coords = res.coords
-        self.trial_energy = res.energy
-        self.rms = res.rms
-        self.funcalls = res.nfev
+        self._set_trial(res)
 
         #########################################################################
         # check if step is a valid configuration, otherwise reject
         #########################################################################
-        self.acceptstep = True
-        self.config_ok = True
-        for check in self.confCheck:
-            if not check(self.trial_energy, self.trial_coords, driver=self):
-                self.acceptstep=False
-                self.config_ok = False
+        self._check_configuration()
         
         #########################################################################
         # check whether step is accepted with user defined tests.  If any returns
@@ -132,12 +135,49 @@ class BasinHopping(MonteCarlo):
             self.acceptstep = self.acceptTest(self.markovE, self.trial_energy,
                                               self.coords, self.trial_coords)
 
+        #########################################################################
+        # finish the quench if the minimum is needed
+        #########################################################################
+        if self.two_stage_quench and self.config_ok and (self.acceptstep or self._store_rejected()):
+            nfev_loose = res.nfev
+            res = self.quench.tighten()
+            self.result.nfev += res.nfev - nfev_loose
+            self.ntight_quenches += 1
+            self._set_trial(res)
+            accepted = self.acceptstep
+            self._check_configuration()
+            self.acceptstep = self.acceptstep and accepted
+
         #########################################################################
         # return new coords and energy and whether or not they were accepted
         #########################################################################
         return self.acceptstep, self.trial_coords, self.trial_energy
 
 
+    def _set_trial(self, res):
+        self.trial_coords = res.coords
+        self.trial_energy = res.energy
+        self.rms = res.rms
+        self.funcalls = res.nfev
+
+    def _check_configuration(self):
+        """set acceptstep and config_ok from the configuration tests"""
+        self.acceptstep = True
+        self.config_ok = True
+        for check in self.confCheck:
+            if not check(self.trial_energy, self.trial_coords, driver=self):
+                self.acceptstep=False
+                self.config_ok = False
+
+    def _store_rejected(self):
+        """return True if the rejected trial minimum will go to the storage"""
+        if not (self.storage and self.insert_rejected):
+            return False
+        db = getattr(self.storage, "db", None)
+        if db is None:
+            return True
+        return db.findMinimum(self.trial_energy, self.trial_coords) is None
+
     def printStep(self):
         if self.stepnum % self.printfrq == 0:
             if self.outstream != None:
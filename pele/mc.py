@@ -55,6 +55,13 @@ class MonteCarlo(object):
         Default to standard out.
     store_initial : bool, optional
         if True store initial structure
+    use_energy_change : bool, optional
+        if True, and the takestep object sets the attribute `changed_atoms`
+        to the list of atoms it moved in the last step, the trial energy is
+        computed as the markov energy plus
+        `potential.getEnergyChange(coords, trial_coords, changed_atoms)`.
+        For potentials which implement getEnergyChange this only computes the
+        interactions of the moved atoms.
     
     See Also
     --------
@@ -64,7 +71,8 @@ class MonteCarlo(object):
     insert_rejected = False
   
     def __init__(self, coords, potential, takeStep, storage=None, event_after_step=None, acceptTest=None,
-                 temperature=1.0, confCheck=None, outstream=sys.stdout, store_initial=True, iprint=1):
+                 temperature=1.0, confCheck=None, outstream=sys.stdout, store_initial=True, iprint=1,
+                 use_energy_change=False):
         # note: make a local copy of lists of events so that an inputted list is not modified.
         if confCheck is None: confCheck = []
         if event_after_step is None: event_after_step = []
@@ -82,6 +90,7 @@ class MonteCarlo(object):
         self.outstream = outstream
         self.printfrq = iprint # controls how often printing is done
         self.confCheck = confCheck
+        self.use_energy_change = use_energy_change
     
         if acceptTest:
             self.acceptTest = acceptTest 
@@ -137,7 +146,14 @@ class MonteCarlo(object):
         #########################################################################
         # calculate new energy
         #########################################################################
-        self.trial_energy = self.potential.getEnergy(self.trial_coords)
+        changed_atoms = None
+        if self.use_energy_change:
+            changed_atoms = getattr(self.takeStep, "changed_atoms", None)
+        if changed_atoms is not None:
+            self.trial_energy = self.markovE + self.potential.getEnergyChange(self.coords, self.trial_coords,
+                                                                              changed_atoms)
+        else:
+            self.trial_energy = self.potential.getEnergy(self.trial_coords)
         self.result.nfev += 1
         
         
@@ -83,7 +83,12 @@ These are not used very often and may be buggy.
 .. autosummary::
     :toctree: generated/
     
+    CG_CPP
     cg
+    TruncatedNewton_CPP
+    truncated_newton
+    lbfgs_truncated_newton
+    TwoStageQuench
     steepest_descent
 
 
@@ -95,4 +100,7 @@ from _mylbfgs import *
 from _fire import *
 from _modified_fire_cpp import ModifiedFireCPP
 from _lbfgs_cpp import LBFGS_CPP
+from _cg_cpp import CG_CPP
+from _truncated_newton_cpp import TruncatedNewton_CPP
+from _batch_cpp import BatchLBFGS_CPP, BatchFIRE_CPP
 from _quench import *
@@ -0,0 +1,170 @@
+"""
+# distutils: language = C++
+"""
+import numpy as np
+
+from pele.potentials import _pele
+from pele.potentials cimport _pele
+from pele.optimize import Result
+from pele.potentials._pythonpotential import as_cpp_potential
+
+cimport numpy as np
+cimport cython
+from libcpp cimport bool as cbool
+cimport pele.optimize._pele_opt as _pele_opt
+from pele.optimize._pele_opt cimport shared_ptr
+
+# import the externally defined batch optimizers
+cdef extern from "pele/batch_optimizer.h" namespace "pele":
+    cdef cppclass cppBatchOptimizer "pele::BatchOptimizer":
+        void one_iteration() except +
+        void run(int) except +
+        void run() except +
+        void set_tol(double) except +
+        void set_maxstep(double) except +
+        void set_max_iter(int) except +
+        void set_iprint(int) except +
+        void set_verbosity(int) except +
+        void set_nr_threads(size_t) except +
+        void set_iterations_per_round(int) except +
+        size_t get_nconf() except +
+        size_t get_ndof() except +
+        size_t get_nr_active() except +
+        shared_ptr[_pele_opt.cGradientOptimizer] get_optimizer(size_t) except +
+        _pele.Array[double] get_x() except +
+        _pele.Array[double] get_g() except +
+        _pele.Array[double] get_f() except +
+        _pele.Array[double] get_rms() except +
+        cbool success() except +
+
+    cdef cppclass cppBatchLBFGS "pele::BatchLBFGS"(cppBatchOptimizer):
+        cppBatchLBFGS(shared_ptr[_pele.cBasePotential], _pele.Array[double], size_t,
+                      double, int, size_t) except +
+        void set_H0(double) except +
+        void set_max_f_rise(double) except +
+        void set_use_relative_f(int) except +
+
+    cdef cppclass cppBatchFIRE "pele::BatchFIRE"(cppBatchOptimizer):
+        cppBatchFIRE(shared_ptr[_pele.cBasePotential], _pele.Array[double], size_t,
+                     double, double, double, size_t, double, double, double, double,
+                     double, cbool, size_t) except +
+        void set_fire2(cbool) except +
+
+
+@cython.boundscheck(False)
+cdef pele_array_to_np_array(_pele.Array[double] v):
+    """copy a pele Array into a new numpy array"""
+    cdef np.ndarray[double, ndim=1] vnew = np.zeros(v.size(), dtype=float)
+    cdef int i
+    cdef int N = vnew.size
+    for i in xrange(N):
+        vnew[i] = v[i]
+    return vnew
+
+
+cdef class _Cdef_BatchOptimizer(object):
+    """This class is the python interface for the c++ batch optimizers
+
+    The configurations are passed as an array of shape (nconf, ndof).  All
+    results are arrays with one entry (or row) per configuration.
+    """
+    cdef shared_ptr[cppBatchOptimizer] thisptr
+    cdef _pele.BasePotential pot
+
+    def one_iteration(self):
+        self.thisptr.get().one_iteration()
+        return self.get_result()
+
+    def run(self, niter=None):
+        if niter is None:
+            self.thisptr.get().run()
+        else:
+            self.thisptr.get().run(niter)
+        return self.get_result()
+
+    def get_nr_active(self):
+        """return the number of configurations which are not finished yet"""
+        return self.thisptr.get().get_nr_active()
+
+    def get_result(self):
+        """return a results object"""
+        cdef size_t nconf = self.thisptr.get().get_nconf()
+        cdef size_t ndof = self.thisptr.get().get_ndof()
+        cdef size_t i
+        cdef shared_ptr[_pele_opt.cGradientOptimizer] opt
+        res = Result()
+        res.coords = pele_array_to_np_array(self.thisptr.get().get_x()).reshape(nconf, ndof)
+        res.grad = pele_array_to_np_array(self.thisptr.get().get_g()).reshape(nconf, ndof)
+        res.energy = pele_array_to_np_array(self.thisptr.get().get_f())
+        res.rms = pele_array_to_np_array(self.thisptr.get().get_rms())
+        res.nsteps = np.zeros(nconf, dtype=int)
+        res.nfev = np.zeros(nconf, dtype=int)
+        res.success = np.zeros(nconf, dtype=bool)
+        for i in xrange(nconf):
+            opt = self.thisptr.get().get_optimizer(i)
+            res.nsteps[i] = opt.get().get_niter()
+            res.nfev[i] = opt.get().get_nfev()
+            res.success[i] = opt.get().success()
+        return res
+
+
+cdef class _Cdef_BatchLBFGS_CPP(_Cdef_BatchOptimizer):
+    """This class is the python interface for the c++ BatchLBFGS implementation
+    """
+    def __cinit__(self, x0, potential, double tol=1e-5, int M=4, double maxstep=0.1,
+                  double maxErise=1e-4, double H0=0.1, int iprint=-1,
+                  int nsteps=10000, int verbosity=0, int nr_threads=1,
+                  rel_energy=False):
+        potential = as_cpp_potential(potential, verbose=verbosity>0)
+        self.pot = potential
+        cdef np.ndarray[double, ndim=2] x0c = np.array(x0, dtype=float, ndmin=2, order="C")
+        cdef cppBatchLBFGS * batch = new cppBatchLBFGS(self.pot.thisptr,
+                _pele.Array[double](<double*> x0c.data, x0c.size), x0c.shape[0],
+                tol, M, nr_threads)
+        self.thisptr = shared_ptr[cppBatchOptimizer](<cppBatchOptimizer*> batch)
+        batch.set_H0(H0)
+        batch.set_maxstep(maxstep)
+        batch.set_max_f_rise(maxErise)
+        batch.set_max_iter(nsteps)
+        batch.set_verbosity(verbosity)
+        batch.set_iprint(iprint)
+        if rel_energy:
+            batch.set_use_relative_f(1)
+
+
+cdef class _Cdef_BatchFIRE_CPP(_Cdef_BatchOptimizer):
+    """This class is the python interface for the c++ BatchFIRE implementation
+    """
+    def __cinit__(self, x0, potential, double dtstart=0.1, double dtmax=1, double maxstep=0.5,
+                  size_t Nmin=5, double finc=1.1, double fdec=0.5, double fa=0.99,
+                  double astart=0.1, double tol=1e-3, cbool stepback=True, int iprint=-1,
+                  int nsteps=10000, int verbosity=0, int nr_threads=1, cbool fire2=False):
+        potential = as_cpp_potential(potential, verbose=verbosity>0)
+        self.pot = potential
+        cdef np.ndarray[double, ndim=2] x0c = np.array(x0, dtype=float, ndmin=2, order="C")
+        cdef cppBatchFIRE * batch = new cppBatchFIRE(
+                self.pot.thisptr, _pele.Array[double](<double*> x0c.data, x0c.size),
+                x0c.shape[0], dtstart, dtmax, maxstep, Nmin, finc, fdec, fa, astart, tol,
+                stepback, nr_threads)
+        batch.set_fire2(fire2)
+        self.thisptr = shared_ptr[cppBatchOptimizer](<cppBatchOptimizer*> batch)
+        self.thisptr.get().set_max_iter(nsteps)
+        self.thisptr.get().set_verbosity(verbosity)
+        self.thisptr.get().set_iprint(iprint)
+
+
+class BatchLBFGS_CPP(_Cdef_BatchLBFGS_CPP):
+    """minimize many configurations at once with the c++ LBFGS implementation
+
+    x0 is an array of shape (nconf, ndof).  If the potential allows it, the
+    configurations are split between nr_threads threads.
+    """
+
+
+class BatchFIRE_CPP(_Cdef_BatchFIRE_CPP):
+    """minimize many configurations at once with the c++ MODIFIED_FIRE
+    implementation
+
+    x0 is an array of shape (nconf, ndof).  If the potential allows it, the
+    configurations are split between nr_threads threads.
+    """
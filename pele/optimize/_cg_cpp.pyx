@@ -0,0 +1,66 @@
+"""
+# distutils: language = C++
+"""
+import numpy as np
+
+from pele.potentials import _pele
+from pele.potentials cimport _pele
+from pele.potentials._pythonpotential import as_cpp_potential
+
+cimport numpy as np
+cimport pele.optimize._pele_opt as _pele_opt
+from pele.optimize._pele_opt cimport shared_ptr
+
+# import the externally defined conjugate gradient implementation
+cdef extern from "pele/cg.h" namespace "pele":
+    cdef cppclass cppCG "pele::CG":
+        cppCG(shared_ptr[_pele.cBasePotential], _pele.Array[double], double) except +
+
+        void set_tol(double) except +
+        void set_maxstep(double) except +
+        void set_max_iter(int) except +
+        void set_iprint(int) except +
+        void set_verbosity(int) except +
+
+
+cdef class _Cdef_CG_CPP(_pele_opt.GradientOptimizer):
+    """This class is the python interface for the c++ nonlinear conjugate
+    gradient implementation
+    """
+    cdef _pele.BasePotential pot
+
+    def __cinit__(self, x0, potential, double tol=1e-5, double maxstep=0.1,
+                  int iprint=-1, energy=None, gradient=None,
+                  int nsteps=10000, int verbosity=0, events=None, logger=None):
+        potential = as_cpp_potential(potential, verbose=verbosity>0)
+
+        self.pot = potential
+        if logger is not None:
+            print "warning c++ CG is ignoring logger"
+        cdef np.ndarray[double, ndim=1] x0c = np.array(x0, dtype=float)
+        self.thisptr = shared_ptr[_pele_opt.cGradientOptimizer]( <_pele_opt.cGradientOptimizer*>
+                new cppCG(self.pot.thisptr,
+                          _pele.Array[double](<double*> x0c.data, x0c.size),
+                          tol) )
+        cdef cppCG* cg_ptr = <cppCG*> self.thisptr.get()
+        cg_ptr.set_maxstep(maxstep)
+        cg_ptr.set_max_iter(nsteps)
+        cg_ptr.set_verbosity(verbosity)
+        cg_ptr.set_iprint(iprint)
+
+        cdef np.ndarray[double, ndim=1] g_
+        if energy is not None and gradient is not None:
+            g_ = gradient
+            self.thisptr.get().set_func_gradient(energy, _pele.Array[double](<double*> g_.data, g_.size))
+
+        self.events = events
+        if self.events is None:
+            self.events = []
+
+class CG_CPP(_Cdef_CG_CPP):
+    """This class is the python interface for the c++ nonlinear conjugate
+    gradient implementation
+
+    The search directions use the Polak-Ribiere+ formula and the steps are
+    found with a line search which enforces the strong Wolfe conditions.
+    """
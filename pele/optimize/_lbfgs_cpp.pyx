@@ -16,6 +16,10 @@ from pele.optimize._pele_opt cimport shared_ptr
 cimport cython
 from cpython cimport bool as cbool
 
+cdef extern from "pele/linesearch.h" namespace "pele":
+    cdef cppclass cppMoreThuenteLineSearch "pele::MoreThuenteLineSearch":
+        cppMoreThuenteLineSearch() except +
+
 # import the externally defined ljbfgs implementation
 cdef extern from "pele/lbfgs.h" namespace "pele":
     cdef cppclass cppLBFGS "pele::LBFGS":
@@ -26,6 +30,8 @@ cdef extern from "pele/lbfgs.h" namespace "pele":
         void set_maxstep(double) except +
         void set_max_f_rise(double) except +
         void set_use_relative_f(int) except +
+        void set_energy_only_linesearch(int) except +
+        void set_linesearch(shared_ptr[cppMoreThuenteLineSearch]) except +
         void set_max_iter(int) except +
         void set_iprint(int) except +
         void set_verbosity(int) except +
@@ -43,7 +49,8 @@ cdef class _Cdef_LBFGS_CPP(_pele_opt.GradientOptimizer):
                   double maxErise=1e-4, double H0=0.1, int iprint=-1,
                   energy=None, gradient=None,
                   int nsteps=10000, int verbosity=0, events=None, logger=None,
-                  rel_energy=False):
+                  rel_energy=False, energy_only_linesearch=False,
+                  wolfe_linesearch=False):
         potential = as_cpp_potential(potential, verbose=verbosity>0)
 
         self.pot = potential
@@ -63,6 +70,11 @@ cdef class _Cdef_LBFGS_CPP(_pele_opt.GradientOptimizer):
         lbfgs_ptr.set_iprint(iprint)
         if rel_energy:
             lbfgs_ptr.set_use_relative_f(1)
+        if energy_only_linesearch:
+            lbfgs_ptr.set_energy_only_linesearch(1)
+        if wolfe_linesearch:
+            lbfgs_ptr.set_linesearch(shared_ptr[cppMoreThuenteLineSearch](
+                    new cppMoreThuenteLineSearch()))
         
         cdef np.ndarray[double, ndim=1] g_  
         if energy is not None and gradient is not None:
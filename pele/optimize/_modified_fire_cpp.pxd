@@ -9,4 +9,5 @@ cdef extern from "pele/modified_fire.h" namespace "pele":
     cdef cppclass cppMODIFIED_FIRE "pele::MODIFIED_FIRE":
         cppMODIFIED_FIRE(shared_ptr[_pele.cBasePotential] , _pele.Array[double], 
                          double, double, double, size_t , double, double, 
-                         double, double, double, cbool) except +
\ No newline at end of file
+                         double, double, double, cbool) except +
+        void set_fire2(cbool) except +
@@ -16,7 +16,8 @@ cdef class _Cdef_MODIFIED_FIRE_CPP(_pele_opt.GradientOptimizer):
     
     def __cinit__(self, x0, potential, double dtstart = 0.1, double dtmax = 1, double maxstep=0.5, size_t Nmin=5, double finc=1.1, 
                    double fdec=0.5, double fa=0.99, double astart=0.1, double tol=1e-3, cbool stepback = True, 
-                   int iprint=-1, energy=None, gradient=None, int nsteps=10000, int verbosity=0, events = None):
+                   int iprint=-1, energy=None, gradient=None, int nsteps=10000, int verbosity=0, events = None,
+                   cbool fire2=False):
         potential = as_cpp_potential(potential, verbose=verbosity>0)
         
         cdef _pele.BasePotential pot = potential
@@ -25,6 +26,7 @@ cdef class _Cdef_MODIFIED_FIRE_CPP(_pele_opt.GradientOptimizer):
                         new cppMODIFIED_FIRE(pot.thisptr, _pele.Array[double](<double*> x0c.data, x0c.size),
                                              dtstart, dtmax, maxstep, Nmin, finc, fdec, fa, astart, tol, stepback) )
         
+        (<cppMODIFIED_FIRE*> self.thisptr.get()).set_fire2(fire2)
         self.thisptr.get().set_max_iter(nsteps)
         self.thisptr.get().set_verbosity(verbosity)
         self.thisptr.get().set_iprint(iprint)
@@ -42,6 +44,8 @@ cdef class _Cdef_MODIFIED_FIRE_CPP(_pele_opt.GradientOptimizer):
 
 class ModifiedFireCPP(_Cdef_MODIFIED_FIRE_CPP):
     """This class is the python interface for the c++ MODIFED_FIRE implementation.
+
+    With fire2=True the FIRE 2.0 variant of the algorithm is used.
     """
     
 #     def reset(self, coords):
@@ -2,6 +2,20 @@ from pele.potentials cimport _pele
 from pele.potentials._pele cimport shared_ptr
 from libcpp cimport bool as cbool
 
+cdef extern from "pele/optimizer_trace.h" namespace "pele":
+    cdef struct cOptimizerTraceRecord "pele::OptimizerTraceRecord":
+        int iteration
+        double energy
+        double rms
+        double stepsize
+        int nfev
+        double potential_time
+        double wall_time
+
+    cdef cppclass cOptimizerTrace "pele::OptimizerTrace":
+        size_t size()
+        cOptimizerTraceRecord get(size_t) except+
+
 cdef extern from "pele/optimizer.h" namespace "pele":
     cdef cppclass  cGradientOptimizer "pele::GradientOptimizer":
         cGradientOptimizer(_pele.cBasePotential *, _pele.Array[double], double) except +
@@ -25,6 +39,9 @@ cdef extern from "pele/optimizer.h" namespace "pele":
         cbool success() except+
         cbool stop_criterion_satisfied() except+
         void initialize_func_gradient() except+
+        void enable_trace(size_t) except+
+        void disable_trace() except+
+        cOptimizerTrace & get_trace() except+
     
 cdef class GradientOptimizer:
     cdef shared_ptr[cGradientOptimizer] thisptr      # hold a C++ instance which we're wrapping
@@ -69,11 +69,56 @@ cdef class GradientOptimizer(object):
     def stop_criterion_satisfied(self):
         return bool(self.thisptr.get().stop_criterion_satisfied())
 
+    def set_tol(self, double tol):
+        """change the tolerance for the rms gradient"""
+        self.thisptr.get().set_tol(tol)
+
     def get_maxiter(self):
         return self.thisptr.get().get_maxiter()
 
     def get_niter(self):
         return self.thisptr.get().get_niter()
+
+    def enable_trace(self, size_t capacity=10000):
+        """record the following iterations in a ring buffer
+
+        This raises an exception if pele was not compiled with
+        -DPELE_OPTIMIZER_TRACE.  Only the last capacity iterations are kept.
+        """
+        self.thisptr.get().enable_trace(capacity)
+
+    def disable_trace(self):
+        self.thisptr.get().disable_trace()
+
+    def get_trace(self):
+        """return the recorded iterations as a dictionary of numpy arrays
+
+        The keys are iteration, energy, rms, stepsize, nfev (the number of
+        function evaluations in the iteration), potential_time and
+        wall_time (both in seconds).
+        """
+        cdef cOptimizerTrace * trace = &self.thisptr.get().get_trace()
+        cdef size_t n = trace.size()
+        cdef size_t i
+        cdef cOptimizerTraceRecord r
+        cdef np.ndarray[long, ndim=1] iteration = np.zeros(n, dtype=int)
+        cdef np.ndarray[long, ndim=1] nfev = np.zeros(n, dtype=int)
+        cdef np.ndarray[double, ndim=1] energy = np.zeros(n)
+        cdef np.ndarray[double, ndim=1] rms = np.zeros(n)
+        cdef np.ndarray[double, ndim=1] stepsize = np.zeros(n)
+        cdef np.ndarray[double, ndim=1] potential_time = np.zeros(n)
+        cdef np.ndarray[double, ndim=1] wall_time = np.zeros(n)
+        for i in xrange(n):
+            r = trace.get(i)
+            iteration[i] = r.iteration
+            energy[i] = r.energy
+            rms[i] = r.rms
+            stepsize[i] = r.stepsize
+            nfev[i] = r.nfev
+            potential_time[i] = r.potential_time
+            wall_time[i] = r.wall_time
+        return dict(iteration=iteration, energy=energy, rms=rms, stepsize=stepsize,
+                    nfev=nfev, potential_time=potential_time, wall_time=wall_time)
     
     def get_result(self):
         """return a results object"""
@@ -7,12 +7,16 @@ we should make this consistent with scipy.
 scipy.minimize would do a similar thing
 """
 
+import copy
+
 import numpy as np
 
-from pele.optimize import LBFGS, MYLBFGS, Fire, Result, LBFGS_CPP, ModifiedFireCPP
+from pele.optimize import LBFGS, MYLBFGS, Fire, Result, LBFGS_CPP, ModifiedFireCPP, CG_CPP, \
+    TruncatedNewton_CPP
 
 __all__ = ["lbfgs_scipy", "fire", "lbfgs_py", "mylbfgs", "cg",
-           "steepest_descent", "bfgs_scipy", "lbfgs_cpp"]
+           "steepest_descent", "bfgs_scipy", "lbfgs_cpp", "truncated_newton",
+           "lbfgs_truncated_newton", "TwoStageQuench"]
 
 
 def lbfgs_scipy(coords, pot, iprint=-1, tol=1e-3, nsteps=15000):
@@ -78,33 +82,105 @@ def fire(coords, pot, tol=1e-3, nsteps=100000, **kwargs):
 
 def cg(coords, pot, iprint=-1, tol=1e-3, nsteps=5000, **kwargs):
     """
-    a wrapper function for conjugate gradient routine in scipy
+    a wrapper function for the c++ nonlinear conjugate gradient routine
     """
-    import scipy.optimize
+    opt = CG_CPP(coords, pot, iprint=iprint, tol=tol, nsteps=nsteps, **kwargs)
+    return opt.run()
 
-    ret = scipy.optimize.fmin_cg(pot.getEnergy, coords, pot.getGradient,
-                                 gtol=tol, full_output=True, disp=iprint > 0,
-                                 maxiter=nsteps, **kwargs)
-    res = Result()
-    res.coords = ret[0]
-    res.nfev = ret[2]
-    res.nfev += ret[3]  # calls to gradient
-    res.success = True
-    warnflag = ret[4]
-    if warnflag > 0:
-        # print "warning: problem with quench: ",
-        res.success = False
-        if warnflag == 1:
-            res.message = "Maximum number of iterations exceeded"
-        if warnflag == 2:
-            print "Gradient and/or function calls not changing"
-    res.energy, res.grad = pot.getEnergyGradient(res.coords)
-    res.nfev += 1
-    g = res.grad
-    res.rms = np.linalg.norm(g) / np.sqrt(len(g))
+
+def truncated_newton(coords, pot, iprint=-1, tol=1e-3, nsteps=1000, **kwargs):
+    """
+    a wrapper function for the c++ truncated newton routine
+    """
+    opt = TruncatedNewton_CPP(coords, pot, iprint=iprint, tol=tol, nsteps=nsteps, **kwargs)
+    return opt.run()
+
+
+def lbfgs_truncated_newton(coords, pot, tol=1e-10, lbfgs_tol=1e-3, nsteps=10000,
+                           **kwargs):
+    """
+    minimize with LBFGS to lbfgs_tol, then converge to tol with truncated newton
+
+    LBFGS converges only linearly, so it is expensive to get the rms gradient
+    very small.  Close to the minimum truncated newton converges
+    superlinearly.  The keyword arguments are passed to LBFGS_CPP.
+    """
+    res1 = LBFGS_CPP(coords, pot, tol=lbfgs_tol, nsteps=nsteps, **kwargs).run()
+    if res1.rms <= tol:
+        return res1
+    opt = TruncatedNewton_CPP(res1.coords, pot, tol=tol, nsteps=nsteps,
+                              energy=res1.energy, gradient=res1.grad)
+    res = opt.run()
+    res.nfev += res1.nfev
+    res.nsteps += res1.nsteps
     return res
 
 
+class TwoStageQuench(object):
+    """a quench which can stop at a loose tolerance and later continue to
+    the tight tolerance
+
+    Calling the object quenches to tol, like the other quench functions.
+    loose(coords) only quenches to loose_tol and keeps the optimizer, so
+    tighten() can continue the same minimization to tol, e.g. only if the
+    minimum turns out to be interesting.
+
+    Parameters
+    ----------
+    pot : potential
+    loose_tol : float
+        the tolerance of the first stage
+    tol : float
+        the tolerance of the second stage
+    minimizer : optimizer class, optional
+        called as minimizer(coords, pot, tol=loose_tol, **kwargs).  The
+        optimizer must continue the minimization when run() is called again
+        after its tolerance was changed with set_tol(), or, for the python
+        optimizers, by setting the attribute tol.  The default is LBFGS_CPP
+    kwargs :
+        passed to minimizer
+
+    See Also
+    --------
+    pele.basinhopping.BasinHopping : uses the two stages if quench is a TwoStageQuench
+    """
+    def __init__(self, pot, loose_tol=1e-2, tol=1e-6, minimizer=None, **kwargs):
+        if loose_tol < tol:
+            raise ValueError("loose_tol must not be smaller than tol")
+        self.pot = pot
+        self.loose_tol = loose_tol
+        self.tol = tol
+        self.minimizer = minimizer if minimizer is not None else LBFGS_CPP
+        self.kwargs = kwargs
+        self._optimizer = None
+
+    def __call__(self, coords):
+        self.loose(coords)
+        return self.tighten()
+
+    def loose(self, coords):
+        """quench coords to loose_tol and return the result"""
+        self._optimizer = self.minimizer(coords, self.pot, tol=self.loose_tol, **self.kwargs)
+        # some optimizers return the same result object after the next call of run()
+        return copy.deepcopy(self._optimizer.run())
+
+    def tighten(self):
+        """continue the last quench to tol and return the result
+
+        The number of function evaluations of the result includes the first
+        stage.
+        """
+        if self._optimizer is None:
+            raise RuntimeError("tighten() must be called after loose()")
+        opt = self._optimizer
+        self._optimizer = None
+        if hasattr(opt, "set_tol"):
+            opt.set_tol(self.tol)
+        else:
+            opt.tol = self.tol
+        return opt.run()
+
+
 def steepest_descent(x0, pot, iprint=-1, dx=1e-4, nsteps=100000,
                      tol=1e-3, maxstep=-1., events=None):
     """steepest descent minimization
@@ -0,0 +1,79 @@
+"""
+# distutils: language = C++
+"""
+import numpy as np
+
+from pele.potentials import _pele
+from pele.potentials cimport _pele
+from pele.potentials._pythonpotential import as_cpp_potential
+
+cimport numpy as np
+cimport pele.optimize._pele_opt as _pele_opt
+from pele.optimize._pele_opt cimport shared_ptr
+
+# import the externally defined truncated newton implementation
+cdef extern from "pele/truncated_newton.h" namespace "pele":
+    cdef cppclass cppTruncatedNewton "pele::TruncatedNewton":
+        cppTruncatedNewton(shared_ptr[_pele.cBasePotential], _pele.Array[double], double) except +
+
+        void set_tol(double) except +
+        void set_maxstep(double) except +
+        void set_max_iter(int) except +
+        void set_iprint(int) except +
+        void set_verbosity(int) except +
+        void set_max_cg_iter(int) except +
+        int get_nhev() except +
+
+
+cdef class _Cdef_TruncatedNewton_CPP(_pele_opt.GradientOptimizer):
+    """This class is the python interface for the c++ truncated newton
+    implementation
+    """
+    cdef _pele.BasePotential pot
+
+    def __cinit__(self, x0, potential, double tol=1e-5, double maxstep=0.1,
+                  int iprint=-1, energy=None, gradient=None,
+                  int nsteps=10000, int verbosity=0, max_cg_iter=None,
+                  events=None, logger=None):
+        potential = as_cpp_potential(potential, verbose=verbosity>0)
+
+        self.pot = potential
+        if logger is not None:
+            print "warning c++ TruncatedNewton is ignoring logger"
+        cdef np.ndarray[double, ndim=1] x0c = np.array(x0, dtype=float)
+        self.thisptr = shared_ptr[_pele_opt.cGradientOptimizer]( <_pele_opt.cGradientOptimizer*>
+                new cppTruncatedNewton(self.pot.thisptr,
+                          _pele.Array[double](<double*> x0c.data, x0c.size),
+                          tol) )
+        cdef cppTruncatedNewton* tn_ptr = <cppTruncatedNewton*> self.thisptr.get()
+        tn_ptr.set_maxstep(maxstep)
+        tn_ptr.set_max_iter(nsteps)
+        tn_ptr.set_verbosity(verbosity)
+        tn_ptr.set_iprint(iprint)
+        if max_cg_iter is not None:
+            tn_ptr.set_max_cg_iter(max_cg_iter)
+
+        cdef np.ndarray[double, ndim=1] g_
+        if energy is not None and gradient is not None:
+            g_ = np.array(gradient, dtype=float)
+            self.thisptr.get().set_func_gradient(energy, _pele.Array[double](<double*> g_.data, g_.size))
+
+        self.events = events
+        if self.events is None:
+            self.events = []
+
+    def get_nhev(self):
+        """return the number of Hessian vector products"""
+        cdef cppTruncatedNewton* tn_ptr = <cppTruncatedNewton*> self.thisptr.get()
+        return tn_ptr.get_nhev()
+
+class TruncatedNewton_CPP(_Cdef_TruncatedNewton_CPP):
+    """This class is the python interface for the c++ truncated newton
+    implementation
+
+    The Newton equations are solved approximately with conjugate gradient
+    iterations which only need Hessian vector products, and the step is
+    limited by a trust region of at most maxstep.  It converges
+    superlinearly close to a minimum, which makes it useful to converge
+    a structure to a very small rms gradient.
+    """
@@ -0,0 +1,36 @@
+import unittest
+import numpy as np
+
+from pele.potentials import LJ
+from pele.optimize import BatchLBFGS_CPP, BatchFIRE_CPP, LBFGS_CPP
+
+
+class TestBatchLBFGS_CPP(unittest.TestCase):
+    def setUp(self):
+        np.random.seed(0)
+        self.natoms = 8
+        self.nconf = 5
+        self.x0 = np.random.uniform(-1, 1, [self.nconf, 3 * self.natoms])
+        self.pot = LJ()
+
+    def test_agrees_with_single(self):
+        batch = BatchLBFGS_CPP(self.x0, self.pot, tol=1e-6, nr_threads=2)
+        res = batch.run()
+        self.assertEqual(res.coords.shape, self.x0.shape)
+        self.assertTrue(np.all(res.success))
+        self.assertEqual(batch.get_nr_active(), 0)
+        for i in xrange(self.nconf):
+            single = LBFGS_CPP(self.x0[i], self.pot, tol=1e-6).run()
+            self.assertEqual(res.energy[i], single.energy)
+            self.assertEqual(res.nfev[i], single.nfev)
+            self.assertTrue(np.all(res.coords[i] == single.coords))
+
+    def test_fire(self):
+        batch = BatchFIRE_CPP(self.x0, self.pot, tol=1e-4)
+        res = batch.run()
+        self.assertTrue(np.all(res.success))
+        self.assertTrue(np.all(res.rms <= 1e-4))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,50 @@
+import unittest
+import numpy as np
+
+from pele.potentials import BasePotential
+from pele.optimize import CG_CPP
+
+ndof = 4
+_xrand = np.random.uniform(-1, 1, [ndof])
+_xmin = np.zeros(ndof)
+_emin = 0.
+
+
+class _E(BasePotential):
+    def getEnergy(self, x):
+        return np.dot(x, x)
+
+
+class _EG(object):
+    def getEnergy(self, x):
+        return np.dot(x, x)
+
+    def getEnergyGradient(self, x):
+        return self.getEnergy(x), 2. * x
+
+
+class TestCG_CPP(unittest.TestCase):
+    def do_check(self, pot, **kwargs):
+        cg = CG_CPP(_xrand, pot, **kwargs)
+        res = cg.run()
+        self.assertAlmostEqual(res.energy, _emin, 4)
+        self.assertTrue(res.success)
+        self.assertLess(np.max(np.abs(res.coords - _xmin)), 1e-2)
+        self.assertGreater(res.nfev, 0)
+
+    def test_E(self):
+        self.do_check(_E())
+
+    def test_EG(self):
+        self.do_check(_EG())
+
+    def test_reset(self):
+        cg = CG_CPP(np.ones(ndof), _EG())
+        cg.run()
+        cg.reset(_xrand)
+        res = cg.run()
+        self.assertAlmostEqual(res.energy, _emin, 4)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -120,6 +120,9 @@ class TestLBFGS_CPP(unittest.TestCase):
     def test_rel_energy(self):
         self.do_check(_EG(), rel_energy=True)
 
+    def test_wolfe_linesearch(self):
+        self.do_check(_EG(), wolfe_linesearch=True)
+
 
 class TestLBFGS_CPP_PassGrad(unittest.TestCase):
     def do_check(self, pot):
@@ -176,5 +179,21 @@ class TestLBFGS_CPP_LJ(unittest.TestCase):
         self.assertTrue(np.all(res1.coords == res2.coords))
 
 
+    def test_trace(self):
+        lbfgs = LBFGS_CPP(_xrand, _EG(), nsteps=20)
+        try:
+            lbfgs.enable_trace(5)
+        except RuntimeError:
+            raise unittest.SkipTest("pele was compiled without PELE_OPTIMIZER_TRACE")
+        res = lbfgs.run()
+        trace = lbfgs.get_trace()
+        n = min(5, res.nsteps)
+        self.assertEqual(trace["energy"].size, n)
+        self.assertEqual(trace["iteration"][-1], res.nsteps)
+        self.assertAlmostEqual(trace["energy"][-1], res.energy)
+        self.assertTrue(np.all(trace["nfev"] >= 1))
+        self.assertTrue(np.all(trace["wall_time"] >= trace["potential_time"]))
+
+
 if __name__ == "__main__":
     unittest.main()
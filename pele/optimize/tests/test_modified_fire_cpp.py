@@ -51,6 +51,9 @@ class TestModifiedFireCPP(unittest.TestCase):
     def test_EG(self):
         self.do_check(_EG())
 
+    def test_fire2(self):
+        self.do_check(_EG(), fire2=True)
+
     def assert_same(self, res1, res2):
         self.assertEqual(res1.energy, res2.energy)
         self.assertEqual(res1.rms, res2.rms)
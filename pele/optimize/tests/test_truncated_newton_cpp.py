@@ -0,0 +1,40 @@
+import unittest
+import numpy as np
+
+from pele.potentials import LJ
+from pele.optimize import TruncatedNewton_CPP, lbfgs_cpp, lbfgs_truncated_newton
+
+
+class TestTruncatedNewton_CPP(unittest.TestCase):
+    def setUp(self):
+        np.random.seed(0)
+        self.pot = LJ()
+        self.xrand = np.random.uniform(-1, 1, 3 * 13)
+        # a structure close to a minimum
+        res = lbfgs_cpp(self.xrand, self.pot, tol=1e-3)
+        self.x0 = res.coords
+
+    def test_converges_tightly(self):
+        opt = TruncatedNewton_CPP(self.x0, self.pot, tol=1e-9)
+        res = opt.run()
+        self.assertTrue(res.success)
+        self.assertLessEqual(res.rms, 1e-9)
+        self.assertGreater(opt.get_nhev(), 0)
+        e, g = self.pot.getEnergyGradient(res.coords)
+        self.assertAlmostEqual(e, res.energy, 8)
+
+    def test_polish(self):
+        res = lbfgs_truncated_newton(self.xrand, self.pot, tol=1e-9)
+        self.assertTrue(res.success)
+        self.assertLessEqual(res.rms, 1e-9)
+
+    def test_reset(self):
+        opt = TruncatedNewton_CPP(self.x0 + 0.01, self.pot, tol=1e-8)
+        opt.run()
+        opt.reset(self.x0)
+        res = opt.run()
+        self.assertTrue(res.success)
+
+
+if __name__ == "__main__":
+    unittest.main()
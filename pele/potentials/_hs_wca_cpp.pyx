@@ -26,14 +26,16 @@ cdef extern from "pele/hs_wca.h" namespace "pele":
     cdef cppclass  cHS_WCACellLists "pele::HS_WCACellLists"[ndim]:
         cHS_WCACellLists(double eps, double sca, _pele.Array[double] radii,
                          _pele.Array[double] boxvec,
-                         double ncellsx_scale) except +
+                         double ncellsx_scale, double skin) except +
+        void set_nr_threads(size_t nr_threads) except +
     cdef cppclass  cHS_WCAPeriodic "pele::HS_WCAPeriodic"[ndim]:
         cHS_WCAPeriodic(double eps, double sca, _pele.Array[double] radii,
                         _pele.Array[double] boxvec) except +
     cdef cppclass  cHS_WCAPeriodicCellLists "pele::HS_WCAPeriodicCellLists"[ndim]:
         cHS_WCAPeriodicCellLists(double eps, double sca,
                                  _pele.Array[double] radii, _pele.Array[double] boxvec, 
-                                 double ncellx_scale) except +
+                                 double ncellx_scale, double skin) except +
+        void set_nr_threads(size_t nr_threads) except +
     cdef cppclass  cHS_WCANeighborList "pele::HS_WCANeighborList":
         cHS_WCANeighborList(_pele.Array[size_t] & ilist, double eps, double sca,
                             _pele.Array[double] radii) except +    
@@ -79,6 +81,13 @@ cdef class HS_WCA(_pele.BasePotential):
     ncellx_scale : float
         Parameter controlling the cell list grid spacing: values larger than
         unity lead to finer cell meshing
+    verlet_skin : float
+        If positive, and cell lists are used, the atom pairs are stored in a
+        Verlet list with cutoff rcut + verlet_skin.  The list is only rebuilt
+        once a particle has moved further than verlet_skin / 2.
+    nr_threads : integer
+        If cell lists are used, the loop over particle pairs is split between
+        this many threads
     """
     cpdef bool periodic
     def __cinit__(self, eps=1.0, sca=0.12,
@@ -88,7 +97,7 @@ cdef class HS_WCA(_pele.BasePotential):
                   np.ndarray[double, ndim=1] reference_coords=None,
                   frozen_atoms=None,
                   rcut=None, # rcut is unused and should be removed
-                  ncellx_scale=1.0):
+                  ncellx_scale=1.0, verlet_skin=0., nr_threads=1):
         assert not (boxvec is not None and boxl is not None)
         cdef np.ndarray[size_t, ndim=1] frozen_dof
         if boxl is not None:
@@ -114,6 +123,10 @@ cdef class HS_WCA(_pele.BasePotential):
         cdef _pele.Array[double] bv_
         cdef _pele.Array[double] rc_
         cdef _pele.Array[size_t] fd_
+        cdef cHS_WCACellLists[INT2] *cl2
+        cdef cHS_WCACellLists[INT3] *cl3
+        cdef cHS_WCAPeriodicCellLists[INT2] *pcl2
+        cdef cHS_WCAPeriodicCellLists[INT3] *pcl3
         if radii is not None:
             rd_ = array_wrap_np(radii)
         if bv is not None:
@@ -135,8 +148,9 @@ cdef class HS_WCA(_pele.BasePotential):
                          cHS_WCA[INT2](eps, sca, rd_))
                 else:
                     # non-frozen, 2d, cartesian, use cell lists
-                    self.thisptr = shared_ptr[_pele.cBasePotential](<_pele.cBasePotential*> new
-                         cHS_WCACellLists[INT2](eps, sca, rd_, bv_, ncellx_scale))
+                    cl2 = new cHS_WCACellLists[INT2](eps, sca, rd_, bv_, ncellx_scale, verlet_skin)
+                    self.thisptr = shared_ptr[_pele.cBasePotential](<_pele.cBasePotential*> cl2)
+                    cl2.set_nr_threads(nr_threads)
             elif ndim == 3:
                 if not use_cell_lists:
                     # non-frozen, 3d, cartesian, no cell lists
@@ -144,8 +158,9 @@ cdef class HS_WCA(_pele.BasePotential):
                          cHS_WCA[INT3](eps, sca, rd_))
                 else:
                     # non-frozen, 3d, cartesian, use cell lists
-                    self.thisptr = shared_ptr[_pele.cBasePotential](<_pele.cBasePotential*> new 
-                         cHS_WCACellLists[INT3](eps, sca, rd_, bv_, ncellx_scale))
+                    cl3 = new cHS_WCACellLists[INT3](eps, sca, rd_, bv_, ncellx_scale, verlet_skin)
+                    self.thisptr = shared_ptr[_pele.cBasePotential](<_pele.cBasePotential*> cl3)
+                    cl3.set_nr_threads(nr_threads)
             else:
                 raise Exception("HS_WCA: illegal ndim")
         else:
@@ -157,8 +172,9 @@ cdef class HS_WCA(_pele.BasePotential):
                          cHS_WCAPeriodic[INT2](eps, sca, rd_, bv_))
                 else:
                     # non-frozen, 2d, periodic, use cell lists
-                    self.thisptr = shared_ptr[_pele.cBasePotential](<_pele.cBasePotential*> new
-                         cHS_WCAPeriodicCellLists[INT2](eps, sca, rd_, bv_, ncellx_scale))
+                    pcl2 = new cHS_WCAPeriodicCellLists[INT2](eps, sca, rd_, bv_, ncellx_scale, verlet_skin)
+                    self.thisptr = shared_ptr[_pele.cBasePotential](<_pele.cBasePotential*> pcl2)
+                    pcl2.set_nr_threads(nr_threads)
             elif ndim == 3:
                 if not use_cell_lists:
                     # non-frozen, 3d, periodic, no cell lists
@@ -166,8 +182,9 @@ cdef class HS_WCA(_pele.BasePotential):
                          cHS_WCAPeriodic[INT3](eps, sca, rd_, bv_))
                 else:
                     # non-frozen, 3d, periodic, use cell lists
-                    self.thisptr = shared_ptr[_pele.cBasePotential](<_pele.cBasePotential*> new
-                         cHS_WCAPeriodicCellLists[INT3](eps, sca, rd_, bv_, ncellx_scale)) 
+                    pcl3 = new cHS_WCAPeriodicCellLists[INT3](eps, sca, rd_, bv_, ncellx_scale, verlet_skin)
+                    self.thisptr = shared_ptr[_pele.cBasePotential](<_pele.cBasePotential*> pcl3)
+                    pcl3.set_nr_threads(nr_threads)
             else:
                 raise Exception("HS_WCA: illegal ndim")
 
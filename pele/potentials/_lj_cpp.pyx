@@ -42,7 +42,9 @@ cdef extern from "pele/lj_cut.h" namespace "pele":
                     _pele.Array[size_t] atoms1) except +
     cdef cppclass cppLJCutPeriodicCellLists "pele::LJCutPeriodicCellLists<3>":
         cppLJCutPeriodicCellLists(double C6, double C12, double rcut, 
-                                  _pele.Array[double] boxvec, double ncellx_scale) except +
+                                  _pele.Array[double] boxvec, double ncellx_scale,
+                                  double skin) except +
+        void set_nr_threads(size_t nr_threads) except +
 
 cdef class LJ(_pele.BasePotential):
     """define the python interface to the c++ LJ implementation
@@ -81,19 +83,29 @@ cdef class LJCut(_pele.BasePotential):
 
 cdef class LJCutCellLists(_pele.BasePotential):
     """define the python interface to the c++ LJ implementation
+    
+    If verlet_skin is positive the atom pairs are taken from a Verlet list
+    with cutoff rcut + verlet_skin which is only rebuilt once an atom has moved
+    further than verlet_skin / 2.
+
+    The loop over atom pairs is split between nr_threads threads.
     """
     cpdef bool periodic 
-    def __cinit__(self, eps=1.0, sigma=1.0, rcut=2.5, boxvec=None, ncellx_scale=1.):
+    def __cinit__(self, eps=1.0, sigma=1.0, rcut=2.5, boxvec=None, ncellx_scale=1.,
+                  verlet_skin=0., nr_threads=1):
         cdef np.ndarray[double, ndim=1] bv
+        cdef cppLJCutPeriodicCellLists *pot
         if boxvec is None:
             raise NotImplementedError("LJCutCellLists currently only works with periodic bounds")
             self.periodic = False
         else:
             self.periodic = True
             bv = np.array(boxvec)
-            self.thisptr = shared_ptr[_pele.cBasePotential]( <_pele.cBasePotential*> new 
-                     cppLJCutPeriodicCellLists(4.*eps*sigma**6, 4.*eps*sigma**12, rcut,
-                                               array_wrap_np(bv), ncellx_scale))
+            pot = new cppLJCutPeriodicCellLists(4.*eps*sigma**6, 4.*eps*sigma**12, rcut,
+                                                array_wrap_np(bv), ncellx_scale,
+                                                verlet_skin)
+            self.thisptr = shared_ptr[_pele.cBasePotential]( <_pele.cBasePotential*> pot )
+            pot.set_nr_threads(nr_threads)
 
 
 cdef class LJFrozen(_pele.BasePotential):
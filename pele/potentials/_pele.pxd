@@ -25,6 +25,18 @@ cdef extern from "pele/array.h" namespace "pele":
         dtype *data() except +
         dtype & operator[](size_t) except +
 
+#===============================================================================
+# pele::BlockSparseMatrix
+#===============================================================================
+cdef extern from "pele/sparse_hessian.h" namespace "pele":
+    cdef cppclass cBlockSparseMatrix "pele::BlockSparseMatrix":
+        cBlockSparseMatrix() except +
+        size_t block_size()
+        size_t nr_rows()
+        Array[size_t] indptr()
+        Array[size_t] indices()
+        Array[double] data()
+
 #===============================================================================
 # pele::BasePotential
 #===============================================================================
@@ -37,6 +49,15 @@ cdef extern from "pele/base_potential.h" namespace "pele":
         void get_hessian(Array[double] &x, Array[double] &hess) except +
         void numerical_gradient(Array[double] &x, Array[double] &grad, double eps) except +
         void numerical_hessian(Array[double] &x, Array[double] &hess, double eps) except +
+        double get_energy_change(Array[double] &x_old, Array[double] &x_new, Array[size_t] &changed_atoms) except +
+        double get_energy_gradient_change(Array[double] &x_old, Array[double] &x_new,
+                                          Array[size_t] &changed_atoms, Array[double] &grad) except +
+        double get_energy_gradient_sparse_hessian(Array[double] &x, Array[double] &grad,
+                                                  cBlockSparseMatrix &hess) except +
+        void get_hessian_vector_product(Array[double] &x, Array[double] &v, Array[double] &out) except +
+        void get_energy_batch(Array[double] &x, Array[double] &energies, size_t nr_threads) except +
+        void get_energy_gradient_batch(Array[double] &x, Array[double] &energies,
+                                       Array[double] &grad, size_t nr_threads) except +
 
 #cdef extern from "potentialfunction.h" namespace "pele":
 #    cdef cppclass  cPotentialFunction "pele::PotentialFunction":
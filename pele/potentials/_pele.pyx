@@ -31,6 +31,59 @@ cdef class BasePotential(object):
         e, grad = self.getEnergyGradient(x)
         return grad
     
+    def getEnergyBatch(self, coords, size_t nr_threads=1):
+        """return the energies of K configurations in one call
+        
+        coords is a K x ndof array.  Potentials which allow it split the
+        configurations between up to nr_threads threads.
+        """
+        cdef np.ndarray[double, ndim=2] x = np.ascontiguousarray(coords, dtype=float)
+        cdef np.ndarray[double, ndim=1] xflat = x.reshape(-1)
+        cdef np.ndarray[double, ndim=1] energies = np.zeros(x.shape[0])
+        self.thisptr.get().get_energy_batch(array_wrap_np(xflat),
+                                            array_wrap_np(energies),
+                                            nr_threads)
+        return energies
+    
+    def getEnergyGradientBatch(self, coords, size_t nr_threads=1):
+        """return the energies and gradients of K configurations in one call
+        
+        coords is a K x ndof array, the gradients are returned as a K x ndof
+        array.  See getEnergyBatch.
+        """
+        cdef np.ndarray[double, ndim=2] x = np.ascontiguousarray(coords, dtype=float)
+        cdef np.ndarray[double, ndim=1] xflat = x.reshape(-1)
+        cdef np.ndarray[double, ndim=1] energies = np.zeros(x.shape[0])
+        cdef np.ndarray[double, ndim=1] grad = np.zeros(x.size)
+        self.thisptr.get().get_energy_gradient_batch(array_wrap_np(xflat),
+                                                     array_wrap_np(energies),
+                                                     array_wrap_np(grad),
+                                                     nr_threads)
+        return energies, grad.reshape([x.shape[0], x.shape[1]])
+    
+    def getEnergyChange(self, np.ndarray[double, ndim=1] x_old not None,
+                        np.ndarray[double, ndim=1] x_new not None, changed_atoms):
+        """return the change in energy when the atoms in changed_atoms move
+        
+        All other atoms must have the same position in x_old and x_new.
+        """
+        return self.thisptr.get().get_energy_change(array_wrap_np(x_old),
+                                                    array_wrap_np(x_new),
+                                                    array_size_t_from_np(changed_atoms))
+    
+    def getEnergyGradientChange(self, np.ndarray[double, ndim=1] x_old not None,
+                                np.ndarray[double, ndim=1] x_new not None, changed_atoms,
+                                np.ndarray[double, ndim=1] grad not None):
+        """return the change in energy when the atoms in changed_atoms move
+        
+        grad must be the gradient at x_old.  It is updated in place to the
+        gradient at x_new.
+        """
+        return self.thisptr.get().get_energy_gradient_change(array_wrap_np(x_old),
+                                                             array_wrap_np(x_new),
+                                                             array_size_t_from_np(changed_atoms),
+                                                             array_wrap_np(grad))
+    
     def getEnergyGradientHessian(self, np.ndarray[double, ndim=1] x not None):
         cdef np.ndarray[double, ndim=1] grad = np.zeros(x.size)
         cdef np.ndarray[double, ndim=1] hess = np.zeros(x.size**2)
@@ -39,11 +92,42 @@ cdef class BasePotential(object):
                                                            array_wrap_np(hess))
         return e, grad, hess.reshape([x.size, x.size])
     
+    def getEnergyGradientSparseHessian(self, np.ndarray[double, ndim=1] x not None):
+        """return the energy, gradient and the Hessian as a scipy.sparse.bsr_matrix
+        
+        Short ranged potentials build the Hessian from their list of
+        interacting pairs with ndim x ndim blocks, without ever storing the
+        dense matrix.
+        """
+        from scipy.sparse import bsr_matrix
+        cdef cBlockSparseMatrix hess
+        cdef np.ndarray[double, ndim=1] grad = np.zeros(x.size)
+        e = self.thisptr.get().get_energy_gradient_sparse_hessian(array_wrap_np(x),
+                                                                  array_wrap_np(grad),
+                                                                  hess)
+        cdef size_t b = hess.block_size()
+        data = pele_array_to_np(hess.data()).reshape([-1, b, b])
+        indices = pele_array_to_np_size_t(hess.indices()).astype(np.intc)
+        indptr = pele_array_to_np_size_t(hess.indptr()).astype(np.intc)
+        return e, grad, bsr_matrix((data, indices, indptr), shape=(x.size, x.size))
+    
     def getHessian(self, np.ndarray[double, ndim=1] x not None):
         cdef np.ndarray[double, ndim=1] hess = np.zeros(x.size**2)
         self.thisptr.get().get_hessian(array_wrap_np(x), array_wrap_np(hess))
         return np.reshape(hess, [x.size, x.size])
     
+    def getHessianVectorProduct(self, np.ndarray[double, ndim=1] x not None,
+                                np.ndarray[double, ndim=1] v not None):
+        """return the product of the Hessian at x with the vector v
+        
+        This is analytic for the pairwise potentials and needs no N**2 memory.
+        """
+        cdef np.ndarray[double, ndim=1] hv = np.zeros(x.size)
+        self.thisptr.get().get_hessian_vector_product(array_wrap_np(x),
+                                                      array_wrap_np(v),
+                                                      array_wrap_np(hv))
+        return hv
+    
     def NumericalDerivative(self, np.ndarray[double, ndim=1] x not None, double eps=1e-6):
         # redirect the call to the c++ class
         cdef np.ndarray[double, ndim=1] grad = np.zeros([x.size])
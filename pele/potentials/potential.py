@@ -46,6 +46,31 @@ class BasePotential(object):
         e, g = self.getEnergyGradient(coords)
         return g
 
+    def getEnergyBatch(self, coords, nr_threads=1):
+        """return the energies of the K configurations in the K x ndof array coords
+        
+        nr_threads is used by the c++ potentials only.
+        """
+        return np.array([self.getEnergy(x) for x in np.asarray(coords)])
+
+    def getEnergyGradientBatch(self, coords, nr_threads=1):
+        """return the energies and the K x ndof gradients of the K configurations in coords"""
+        coords = np.asarray(coords)
+        energies = np.zeros(coords.shape[0])
+        grad = np.zeros(coords.shape)
+        for i, x in enumerate(coords):
+            energies[i], grad[i, :] = self.getEnergyGradient(x)
+        return energies, grad
+
+    def getEnergyChange(self, coords_old, coords_new, changed_atoms):
+        """return the change in energy when the atoms in changed_atoms move
+        
+        All other atoms must have the same position in coords_old and
+        coords_new.  Potentials can overload this to only compute the
+        interactions of the moved atoms.
+        """
+        return self.getEnergy(coords_new) - self.getEnergy(coords_old)
+
     def NumericalHessian(self, coords, eps=1e-6):
         """return the Hessian matrix of second derivatives computed numerically
         
@@ -7,6 +7,8 @@ from libcpp.vector cimport vector
 from libcpp.map cimport map
 from libcpp.pair cimport pair
 from libcpp.list cimport list as stdlist
+from pele.potentials._pele cimport shared_ptr
+from libcpp cimport bool as cbool
 
 cdef extern from "pele/graph.hpp" namespace "pele":
     ctypedef unsigned long node_id
@@ -25,8 +27,39 @@ cdef extern from "pele/ngt.hpp" namespace "pele":
         double get_rate_BA_SS() except +
         void set_node_occupation_probabilities(map[node_id, double] &) except +
         void set_debug() except +
+        void set_nr_threads(size_t) except +
         map[node_id, double] get_committors() except + # as reference ?
 
+cdef extern from "pele/incremental_ngt.hpp" namespace "pele":
+    cdef cppclass cIncrementalNGT "pele::IncrementalNGT":
+        cIncrementalNGT(rate_map_t &, stdlist[node_id] &, stdlist[node_id] &) except +
+        void add_rates(rate_map_t &) except +
+        void compute_rates() except +
+        double get_rate_AB() except +
+        double get_rate_BA() except +
+        double get_rate_AB_SS() except +
+        double get_rate_BA_SS() except +
+        void set_node_occupation_probabilities(map[node_id, double] &) except +
+        void set_nr_threads(size_t) except +
+        void set_keep_batches(size_t) except +
+        size_t get_number_of_restored_nodes()
+        size_t get_number_of_rebuilds()
+        size_t get_number_of_nodes()
+
+cdef extern from "pele/multi_query_ngt.hpp" namespace "pele":
+    cdef cppclass cMultiQueryResult "pele::MultiQueryResult":
+        double get_rate_AB() except +
+        double get_rate_BA() except +
+        double get_rate_AB_SS() except +
+        double get_rate_BA_SS() except +
+        map[node_id, double] get_committors() except +
+    cdef cppclass cMultiQueryNGT "pele::MultiQueryNGT":
+        cMultiQueryNGT(rate_map_t &, stdlist[node_id] &) except +
+        void reduce() except +
+        shared_ptr[cMultiQueryResult] query(stdlist[node_id] &, stdlist[node_id] &, cbool) except +
+        void set_node_occupation_probabilities(map[node_id, double] &) except +
+        void set_nr_threads(size_t) except +
+
 
 
 
@@ -47,6 +80,9 @@ cdef class BaseNGT(object):
         the equilibrium occupation probabilities of the nodes in A and B.  They
         are used to do the weighted mean for the final average over inverse
         mean first passage times.
+    nr_threads : int
+        the number of threads used to remove the intermediate nodes.  The
+        results agree with the serial calculation up to round off.
     
     Notes
     -----
@@ -62,7 +98,7 @@ cdef class BaseNGT(object):
     cdef node_list
     cdef node2id
     time_solve = 0.
-    def __cinit__(self, rate_constants, A, B, debug=False, weights=None):
+    def __cinit__(self, rate_constants, A, B, debug=False, weights=None, size_t nr_threads=1):
         # all this mess is to construct the c++ objects that will be passed to the C++ NGT
         # assign ids to all the nodes
         nodes = set()
@@ -107,6 +143,8 @@ cdef class BaseNGT(object):
         # set the debug flag
         if debug:
             self.thisptr.set_debug()
+        
+        self.thisptr.set_nr_threads(nr_threads)
     
     def __dealloc__(self):
         if self.thisptr != NULL:
@@ -158,4 +196,240 @@ cdef class BaseNGT(object):
 
 class NGT(BaseNGT):
     pass
+
+
+cdef class BaseIncrementalNGT(object):
+    """compute the rates between two groups of nodes of a growing network
+    
+    The network is passed in batches of rate constants, e.g. the rates of the
+    transition states found by each cycle of a double ended connect run.
+    After each batch the rates can be recomputed much faster than by
+    building a new NGT, because the nodes that did not get new rates recently
+    are removed from the graph for good.  If a new rate touches such a node
+    its removal is undone, together with the removals that depend on it, or
+    the graph is rebuilt from all rates if most removals depend on it.
+    
+    Parameters
+    ----------
+    rate_constants : dict
+        the initial rates.  the keys are tuples of nodes (u,v), the values
+        are the rate constants from u to v.
+    A, B : iterables
+        Groups of nodes specifying the reactant and product groups.
+    weights : dict
+        the equilibrium occupation probabilities of the nodes in A and B
+    nr_threads : int
+        the number of threads used to remove the intermediate nodes
+    keep_batches : int
+        the intermediates that got new rates in the last keep_batches batches
+        are kept in the graph
+    
+    See Also
+    --------
+    NGT
+    """
+    cdef cIncrementalNGT* thisptr
+    cdef node2id
+    time_solve = 0.
+    def __cinit__(self, rate_constants, A, B, weights=None, size_t nr_threads=1,
+                  size_t keep_batches=1):
+        self.node2id = dict()
+        cdef rate_map_t rate_map
+        self._fill_rate_map(rate_constants, rate_map)
+        
+        cdef stdlist[node_id] _A, _B
+        for u in A:
+            _A.push_back(self._get_id(u))
+        for u in B:
+            _B.push_back(self._get_id(u))
+        
+        self.thisptr = new cIncrementalNGT(rate_map, _A, _B)
+        
+        cdef map[node_id, double] Peq 
+        if weights is not None:
+            for u, p in weights.iteritems():
+                Peq[self._get_id(u)] = p
+            self.thisptr.set_node_occupation_probabilities(Peq)
+        self.thisptr.set_nr_threads(nr_threads)
+        self.thisptr.set_keep_batches(keep_batches)
+    
+    def __dealloc__(self):
+        if self.thisptr != NULL:
+            del self.thisptr
+            self.thisptr = NULL
+    
+    def _get_id(self, u):
+        try:
+            return self.node2id[u]
+        except KeyError:
+            uid = len(self.node2id)
+            self.node2id[u] = uid
+            return uid
+    
+    cdef _fill_rate_map(self, rate_constants, rate_map_t & rate_map):
+        cdef node_id uid, vid
+        for (u, v), k in rate_constants.iteritems():
+            uid = self._get_id(u)
+            vid = self._get_id(v)
+            rate_map[pair_t(uid, vid)] = k
+    
+    def add_rates(self, rate_constants):
+        """add a batch of rate constants
+        
+        rates between nodes that are already connected are added to the
+        existing rate
+        """
+        cdef rate_map_t rate_map
+        self._fill_rate_map(rate_constants, rate_map)
+        self.thisptr.add_rates(rate_map)
+    
+    def compute_rates(self):
+        """compute the rates from A->B and B->A"""
+        t0 = time.clock()
+        self.thisptr.compute_rates()
+        self.time_solve = time.clock() - t0 
+    
+    def get_rate_AB(self):
+        """return the rate from A->B"""
+        return self.thisptr.get_rate_AB()
+    
+    def get_rate_BA(self):
+        """return the rate from B->A"""
+        return self.thisptr.get_rate_BA()
+    
+    def get_rate_AB_SS(self):
+        """return the steady state rate from A->B"""
+        return self.thisptr.get_rate_AB_SS()
+    
+    def get_rate_BA_SS(self):
+        """return the steady state rate from B->A"""
+        return self.thisptr.get_rate_BA_SS()
+    
+    def get_number_of_restored_nodes(self):
+        """return the number of removed nodes that were put back into the graph
+
+        This happens when a new rate touches a node that was already removed.
+        """
+        return self.thisptr.get_number_of_restored_nodes()
+    
+    def get_number_of_rebuilds(self):
+        """return the number of times the graph was rebuilt from all rates
+
+        This happens when most removed nodes depend on a node that got new
+        rates.
+        """
+        return self.thisptr.get_number_of_rebuilds()
+
+
+class IncrementalNGT(BaseIncrementalNGT):
+    pass
+
+
+cdef class BaseMultiQueryNGT(object):
+    """compute rates between many pairs of groups of nodes of the same network
+    
+    All nodes that are not candidates are removed from the graph once.  Each
+    call of compute_rates only has to remove the other candidates, so many
+    queries cost little more than one.
+    
+    Parameters
+    ----------
+    rate_constants : dict
+        a dictionary of rates.  the keys are tuples of nodes (u,v), the values
+        are the rate constants from u to v.
+    candidates : iterable
+        all nodes that can be in A or B of a query, e.g. the minima of all
+        funnels of interest.  Committors can only be computed for candidates.
+    weights : dict
+        the equilibrium occupation probabilities of the candidates
+    nr_threads : int
+        the number of threads used to remove the intermediate nodes
+    
+    See Also
+    --------
+    NGT
+    """
+    cdef cMultiQueryNGT* thisptr
+    cdef node_list
+    cdef node2id
+    time_solve = 0.
+    def __cinit__(self, rate_constants, candidates, weights=None, size_t nr_threads=1):
+        nodes = set()
+        for u, v in rate_constants.iterkeys():
+            nodes.add(u)
+            nodes.add(v)
+        self.node_list = list(nodes)
+        self.node2id = dict(( (u, i) for i, u in enumerate(self.node_list) ))
+        
+        cdef rate_map_t rate_map
+        cdef node_id uid, vid
+        for (u, v), k in rate_constants.iteritems():
+            uid = self.node2id[u]
+            vid = self.node2id[v]
+            rate_map[pair_t(uid, vid)] = k
+        
+        cdef stdlist[node_id] _candidates
+        for u in candidates:
+            _candidates.push_back(self.node2id[u])
+        
+        self.thisptr = new cMultiQueryNGT(rate_map, _candidates)
+        
+        cdef map[node_id, double] Peq 
+        if weights is not None:
+            for u, p in weights.iteritems():
+                try:
+                    Peq[self.node2id[u]] = p
+                except KeyError:
+                    pass
+            self.thisptr.set_node_occupation_probabilities(Peq)
+        self.thisptr.set_nr_threads(nr_threads)
     
+    def __dealloc__(self):
+        if self.thisptr != NULL:
+            del self.thisptr
+            self.thisptr = NULL
+    
+    def reduce(self):
+        """remove all nodes except the candidates
+        
+        This is done by the first call of compute_rates if it was not called
+        before.
+        """
+        t0 = time.clock()
+        self.thisptr.reduce()
+        self.time_solve = time.clock() - t0 
+    
+    def compute_rates(self, A, B, committors=False):
+        """compute the rates between the groups of candidates A and B
+        
+        Returns
+        -------
+        results : dict
+            the rates with keys "rate_AB", "rate_BA", "rate_AB_SS" and
+            "rate_BA_SS".  If committors is True "committors" is a dictionary
+            of the committor probabilities of the candidates.
+        """
+        cdef stdlist[node_id] _A, _B
+        for u in A:
+            _A.push_back(self.node2id[u])
+        for u in B:
+            _B.push_back(self.node2id[u])
+        cdef shared_ptr[cMultiQueryResult] result = self.thisptr.query(_A, _B, committors)
+        results = dict(rate_AB=result.get().get_rate_AB(),
+                       rate_BA=result.get().get_rate_BA(),
+                       rate_AB_SS=result.get().get_rate_AB_SS(),
+                       rate_BA_SS=result.get().get_rate_BA_SS(),
+                       )
+        cdef map[node_id, double] qmap
+        cdef pair[node_id, double] q
+        if committors:
+            qmap = result.get().get_committors()
+            committor_dict = dict()
+            for q in qmap:
+                committor_dict[self.node_list[q.first]] = q.second
+            results["committors"] = committor_dict
+        return results
+
+
+class MultiQueryNGT(BaseMultiQueryNGT):
+    pass
@@ -2,7 +2,7 @@ import unittest
 import numpy as np
 import networkx as nx
 
-from pele.rates._ngt_cpp import NGT
+from pele.rates._ngt_cpp import NGT, IncrementalNGT, MultiQueryNGT
 from test_graph_transformation import _MakeRandomGraph, _three_state_rates, make_rates_complete
 
 
@@ -61,6 +61,88 @@ class TestNgtCpp10(unittest.TestCase):
     def test01(self):
         self._test_rate([0,1,2],[3,4,5])
 
+    def test_nr_threads(self):
+        reducer = NGT(self.rates, [0,1,2], [3,4,5], nr_threads=2)
+        reducer.compute_rates()
+        self.assertAlmostEqual(reducer.get_rate_AB(), self.true_kAB, 7)
+        self.assertAlmostEqual(reducer.get_rate_BA(), self.true_kBA, 7)
+
+
+def _lattice_rates(L):
+    """random rates between the neighbors in a L x L lattice"""
+    np.random.seed(0)
+    rates = dict()
+    for i in range(L):
+        for j in range(L):
+            u = i * L + j
+            if i + 1 < L:
+                rates[(u, u + L)], rates[(u + L, u)] = np.random.uniform(.5, 1.5, 2)
+            if j + 1 < L:
+                rates[(u, u + 1)], rates[(u + 1, u)] = np.random.uniform(.5, 1.5, 2)
+    return rates
+
+class TestIncrementalNgtCpp(unittest.TestCase):
+    def check_rates(self, incremental, rates, A, B):
+        incremental.compute_rates()
+        reducer = NGT(rates, A, B)
+        reducer.compute_rates()
+        self.assertAlmostEqual(incremental.get_rate_AB() / reducer.get_rate_AB(), 1, 7)
+        self.assertAlmostEqual(incremental.get_rate_BA() / reducer.get_rate_BA(), 1, 7)
+        self.assertAlmostEqual(incremental.get_rate_AB_SS() / reducer.get_rate_AB_SS(), 1, 7)
+        self.assertAlmostEqual(incremental.get_rate_BA_SS() / reducer.get_rate_BA_SS(), 1, 7)
+
+    def grow_lattice(self, keep_batches):
+        L = 8
+        A, B = [0], [L - 1]
+        # add the rows of the lattice one at a time
+        batches = [dict() for i in range(L)]
+        for (u, v), k in _lattice_rates(L).items():
+            batches[max(u, v) // L][(u, v)] = k
+        # a transition state between two rows that were removed, and a second
+        # transition state between two nodes of the last row
+        last = L * (L - 1)
+        batches.append({(L + 2, 3 * L + 2): 0.7, (3 * L + 2, L + 2): 0.4})
+        batches.append({(last, last + 1): 0.3, (last + 1, last): 0.9})
+
+        incremental = IncrementalNGT(batches[0], A, B, keep_batches=keep_batches)
+        rates = dict(batches[0])
+        self.check_rates(incremental, rates, A, B)
+        for batch in batches[1:]:
+            incremental.add_rates(batch)
+            for uv, k in batch.items():
+                rates[uv] = rates.get(uv, 0.) + k
+            self.check_rates(incremental, rates, A, B)
+        return incremental
+
+    def test_batches(self):
+        incremental = self.grow_lattice(keep_batches=1)
+        self.assertGreater(incremental.get_number_of_restored_nodes()
+                           + incremental.get_number_of_rebuilds(), 0)
+
+    def test_batches_remove_all(self):
+        incremental = self.grow_lattice(keep_batches=0)
+        self.assertGreater(incremental.get_number_of_restored_nodes()
+                           + incremental.get_number_of_rebuilds(), 0)
+
+
+class TestMultiQueryNgtCpp(unittest.TestCase):
+    def test_queries(self):
+        rates = make_rates_complete(nnodes=10)
+        multi = MultiQueryNGT(rates, range(7))
+        multi.reduce()
+        self.assertGreaterEqual(multi.time_solve, 0)
+        for A, B in [([0, 1, 2], [3, 4, 5]), ([0], [6]), ([3, 4], [1])]:
+            results = multi.compute_rates(A, B, committors=True)
+            reducer = NGT(rates, A, B)
+            reducer.compute_rates_and_committors()
+            self.assertAlmostEqual(results["rate_AB"], reducer.get_rate_AB(), 7)
+            self.assertAlmostEqual(results["rate_BA"], reducer.get_rate_BA(), 7)
+            self.assertAlmostEqual(results["rate_AB_SS"], reducer.get_rate_AB_SS(), 7)
+            self.assertAlmostEqual(results["rate_BA_SS"], reducer.get_rate_BA_SS(), 7)
+            committors = reducer.get_committors()
+            for u, q in results["committors"].iteritems():
+                self.assertAlmostEqual(q, committors[u], 7)
+
 
 class TestNgtCppRandom(unittest.TestCase):
     def do_check(self, A, B, nnodes=20, nedges=20):
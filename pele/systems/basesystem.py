@@ -300,7 +300,9 @@ class BaseSystem(object):
             if database is None:
                 database = self.create_database()
             add_minimum = database.minimum_adder(max_n_minima=max_n_minima)
-        bh = basinhopping.BasinHopping(coords, pot, takestep, quench=self.get_minimizer(),
+        if "quench" not in kwargs:
+            kwargs["quench"] = self.get_minimizer()
+        bh = basinhopping.BasinHopping(coords, pot, takestep,
                                        storage=add_minimum,
                                        **kwargs)
         return bh
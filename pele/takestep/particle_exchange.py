@@ -18,6 +18,12 @@ class ParticleExchange(Takestep):
         the indices of the atoms in each of the groups
     verbose : bool
         print debugging info
+    
+    Notes
+    -----
+    after each step the indices of the two exchanged atoms are stored in
+    `changed_atoms`, so that the energy change can be computed locally,
+    see MonteCarlo.
     """
 
     def __init__(self, Alist, Blist, verbose=False):
@@ -27,6 +33,7 @@ class ParticleExchange(Takestep):
 
         self.naccept = 0
         self.ntry = 0
+        self.changed_atoms = None
 
     def takeStep(self, coords, **kwargs):
         iA = random.choice(self.Alist)
@@ -38,6 +45,7 @@ class ParticleExchange(Takestep):
         temp = coords[iA, :].copy()
         coords[iA, :] = coords[iB, :]
         coords[iB, :] = temp
+        self.changed_atoms = [iA, iB]
         self.ntry += 1
         return coords
 
@@ -1,9 +1,47 @@
 import unittest
+import numpy as np
 from numpy import abs
 
 from pele.basinhopping import BasinHopping
+from pele.optimize import TwoStageQuench
 from pele.systems import LJCluster
 
+class _RecordingQuench(TwoStageQuench):
+    """a TwoStageQuench which remembers the energies of both stages
+
+    If db is given it also counts the loose minima which are not in db.
+    """
+    def __init__(self, pot, db=None, **kwargs):
+        TwoStageQuench.__init__(self, pot, **kwargs)
+        self.db = db
+        self.loose_energies = []
+        self.tight_energies = []
+        self.nnew = 0
+
+    def loose(self, coords):
+        res = TwoStageQuench.loose(self, coords)
+        self.loose_energies.append(res.energy)
+        if self.db is not None and self.db.findMinimum(res.energy, res.coords) is None:
+            self.nnew += 1
+        return res
+
+    def tighten(self):
+        res = TwoStageQuench.tighten(self)
+        self.tight_energies.append(res.energy)
+        return res
+
+
+class _RecordingAcceptTest(object):
+    """accept the steps in the order given by decisions and remember the trial energies"""
+    def __init__(self, decisions):
+        self.decisions = list(decisions)
+        self.trial_energies = []
+
+    def __call__(self, markovE, trial_energy, coords, trial_coords):
+        self.trial_energies.append(trial_energy)
+        return self.decisions.pop(0)
+
+
 class TestBasinhopping(unittest.TestCase):
     def setUp(self):
         natoms = 6
@@ -26,7 +64,90 @@ class TestBasinhopping(unittest.TestCase):
         bh.run(3)
         self.assertEnergy(bh.result.energy)
         self.assertEnergy(bh.markovE)
-        
-        
+
+    def test_two_stage_quench(self):
+        pot = self.system.get_potential()
+        quench = TwoStageQuench(pot, loose_tol=1e-2, tol=1e-6)
+        db = self.system.create_database()
+        bh = self.system.get_basinhopping(database=db, outstream=None, quench=quench,
+                                          insert_rejected=True)
+        self.assertTrue(bh.two_stage_quench)
+        bh.run(10)
+        self.assertEnergy(bh.result.energy)
+        self.assertEnergy(bh.markovE)
+        # the stored and the markov minima are quenched to the tight tolerance
+        self.assertLessEqual(bh.ntight_quenches, 10)
+        self.assertLess(pot.getGradient(bh.coords).std(), 1e-5)
+        for m in db.minima():
+            self.assertEnergy(m.energy)
+
+    def test_two_stage_quench_stages(self):
+        pot = self.system.get_potential()
+        quench = TwoStageQuench(pot, loose_tol=1e-1, tol=1e-8)
+        x = self.system.get_random_configuration()
+        self.assertRaises(RuntimeError, quench.tighten)
+        res1 = quench.loose(x)
+        self.assertLessEqual(res1.rms, 1e-1)
+        res2 = quench.tighten()
+        self.assertLessEqual(res2.rms, 1e-8)
+        self.assertGreater(res2.nfev, res1.nfev)
+        self.assertLessEqual(res2.energy, res1.energy)
+        res3 = quench(x)
+        self.assertAlmostEqual(res3.energy, res2.energy, 8)
+
+    def test_two_stage_quench_accept_loose(self):
+        np.random.seed(0)
+        pot = self.system.get_potential()
+        quench = _RecordingQuench(pot, loose_tol=1e-1, tol=1e-8)
+        decisions = [True, False, False, True, False, True]
+        accept_test = _RecordingAcceptTest(decisions)
+        bh = self.system.get_basinhopping(outstream=None, quench=quench,
+                                          acceptTest=accept_test)
+        bh.run(len(decisions))
+        # the first entries are from the initial quench
+        self.assertEqual(accept_test.trial_energies, quench.loose_energies[1:])
+        # only the accepted steps are tightened
+        self.assertEqual(bh.ntight_quenches, decisions.count(True))
+        self.assertEqual(len(quench.tight_energies), decisions.count(True) + 1)
+        self.assertEqual(bh.markovE, quench.tight_energies[-1])
+        self.assertLess(pot.getGradient(bh.coords).std(), 1e-7)
+
+    def test_two_stage_quench_store_rejected(self):
+        np.random.seed(0)
+        nsteps = 20
+        pot = self.system.get_potential()
+        db = self.system.create_database()
+        quench = _RecordingQuench(pot, db=db, loose_tol=1e-2, tol=1e-8)
+        bh = self.system.get_basinhopping(database=db, outstream=None, quench=quench,
+                                          insert_rejected=True,
+                                          acceptTest=lambda *args: False)
+        e0 = bh.markovE
+        quench.nnew = 0  # the initial quench found the first minimum
+        bh.run(nsteps)
+        self.assertEqual(bh.markovE, e0)
+        # the rejected minima are tightened only if they are new to the database
+        self.assertEqual(bh.ntight_quenches, quench.nnew)
+        self.assertGreater(bh.ntight_quenches, 0)
+        self.assertLess(bh.ntight_quenches, nsteps)
+        for m in db.minima():
+            self.assertLess(pot.getGradient(m.coords).std(), 1e-7)
+            self.assertIn(m.energy, quench.tight_energies)
+
+    def test_two_stage_quench_store_rejected_without_db(self):
+        np.random.seed(0)
+        nsteps = 5
+        pot = self.system.get_potential()
+        quench = TwoStageQuench(pot, loose_tol=1e-2, tol=1e-8)
+        stored = []
+        bh = self.system.get_basinhopping(outstream=None, quench=quench,
+                                          add_minimum=lambda e, x: stored.append(e),
+                                          insert_rejected=True,
+                                          acceptTest=lambda *args: False)
+        bh.run(nsteps)
+        # without a database every rejected minimum is stored, so all are tightened
+        self.assertEqual(bh.ntight_quenches, nsteps)
+        self.assertEqual(len(stored), nsteps + 1)
+
+
 if __name__ == "__main__":
     unittest.main()
\ No newline at end of file
@@ -207,18 +207,24 @@ depends = [os.path.join("source/pele", f) for f in os.listdir("source/pele/")
 # I run it through valgrind, valgrind complains about an unrecognized
 # instruction.  I don't have a clue what is causing this, but it's probably
 # better to be on the safe side and not use -march=native
-extra_compile_args = ['-std=c++0x',"-Wall", "-O3", '-funroll-loops']
+extra_compile_args = ['-std=c++0x',"-Wall", "-O3", '-funroll-loops', '-pthread']
+# distutils doesn't pass extra_compile_args to the linker.  std::thread (see
+# source/pele/parallel.h) needs -pthread at link time too.
+extra_link_args = ['-pthread']
 # uncomment the next line to add extra optimization options
 #extra_compile_args = ["-std=c++0x","-Wall", '-Wextra','-pedantic','-O3', "-march=native", "-mtune=native"]
 
 # note: to compile with debug on and to override extra_compile_args use, e.g.
 # OPT="-g -O2 -march=native" python setup.py ...
+# The per iteration trace of the c++ optimizers (GradientOptimizer.get_trace)
+# is only available when compiled with OPT="-DPELE_OPTIMIZER_TRACE"
 
 cxx_modules = [
     Extension("pele.potentials._lj_cpp", 
               ["pele/potentials/_lj_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
                
@@ -226,6 +232,7 @@ cxx_modules = [
               ["pele/potentials/_frozen_dof.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
                
@@ -233,103 +240,142 @@ cxx_modules = [
               ["pele/potentials/_morse_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
     Extension("pele.potentials._hs_wca_cpp", 
               ["pele/potentials/_hs_wca_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
              extra_compile_args=extra_compile_args,
+             extra_link_args=extra_link_args,
               language="c++", depends=depends,
              ),
     Extension("pele.potentials._wca_cpp", 
               ["pele/potentials/_wca_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
              ),
     Extension("pele.potentials._harmonic_cpp", 
               ["pele/potentials/_harmonic_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
              ),
     Extension("pele.potentials._inversepower_cpp", 
               ["pele/potentials/_inversepower_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
              ),
     Extension("pele.potentials._inversepower_stillinger_cpp", 
               ["pele/potentials/_inversepower_stillinger_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
              ),
     Extension("pele.potentials._inversepower_stillinger_cut_cpp",
               ["pele/potentials/_inversepower_stillinger_cut_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
              ),
     Extension("pele.potentials._pspin_spherical_cpp", 
               ["pele/potentials/_pspin_spherical_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
              ),
     Extension("pele.potentials._sumgaussianpot_cpp", 
               ["pele/potentials/_sumgaussianpot_cpp.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
              ),
     Extension("pele.potentials._pele", 
               ["pele/potentials/_pele.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
     Extension("pele.optimize._pele_opt", 
               ["pele/optimize/_pele_opt.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
     
     Extension("pele.optimize._lbfgs_cpp", 
-              ["pele/optimize/_lbfgs_cpp.cxx", "source/lbfgs.cpp"] + include_sources,
+              ["pele/optimize/_lbfgs_cpp.cxx", "source/lbfgs.cpp", "source/linesearch.cpp"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
+              language="c++", depends=depends,
+              ),
+    Extension("pele.optimize._cg_cpp", 
+              ["pele/optimize/_cg_cpp.cxx", "source/cg.cpp", "source/linesearch.cpp"] + include_sources,
+              include_dirs=include_dirs,
+              extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
+              language="c++", depends=depends,
+              ),
+    Extension("pele.optimize._truncated_newton_cpp", 
+              ["pele/optimize/_truncated_newton_cpp.cxx", "source/truncated_newton.cpp"] + include_sources,
+              include_dirs=include_dirs,
+              extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
+              language="c++", depends=depends,
+              ),
+    Extension("pele.optimize._batch_cpp", 
+              ["pele/optimize/_batch_cpp.cxx", "source/lbfgs.cpp", "source/linesearch.cpp",
+               "source/modified_fire.cpp"] + include_sources,
+              include_dirs=include_dirs,
+              extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
     Extension("pele.optimize._modified_fire_cpp", 
               ["pele/optimize/_modified_fire_cpp.cxx", "source/modified_fire.cpp"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
     Extension("pele.potentials._pythonpotential", 
               ["pele/potentials/_pythonpotential.cxx"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
     Extension("pele.angleaxis._cpp_aa", 
               ["pele/angleaxis/_cpp_aa.cxx", "source/aatopology.cpp", "source/rotations.cpp"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
     Extension("pele.utils._cpp_utils", 
               ["pele/utils/_cpp_utils.cxx", "source/rotations.cpp"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
     Extension("pele.utils._pressure_tensor", 
               ["pele/utils/_pressure_tensor.cxx", "source/pressure_tensor.cpp"] + include_sources,
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", depends=depends,
               ),
                ]
@@ -340,6 +386,7 @@ cxx_modules.append(
               ["pele/rates/_ngt_cpp.cxx"] + ["sources/pele/graph.hpp", "sources/pele/ngt.hpp"],
               include_dirs=include_dirs,
               extra_compile_args=extra_compile_args,
+              extra_link_args=extra_link_args,
               language="c++", 
               )
                    )
@@ -43,7 +43,7 @@ else:
     cmake_parallel_args = ["-j" + str(jargs.j)]
 
 #extra compiler args
-cmake_compiler_extra_args=["-std=c++0x","-Wall", "-Wextra", "-pedantic", "-O3"]   
+cmake_compiler_extra_args=["-std=c++0x","-Wall", "-Wextra", "-pedantic", "-O3", "-pthread"]   
 
 #
 # Make the git revision visible.  Most of this is copied from scipy
@@ -232,7 +232,9 @@ setup(name='pele',
 # I run it through valgrind, valgrind complains about an unrecognized
 # instruction.  I don't have a clue what is causing this, but it's probably
 # better to be on the safe side and not use -march=native
-extra_compile_args = ['-std=c++0x',"-Wall", "-O3", '-funroll-loops']
+extra_compile_args = ['-std=c++0x',"-Wall", "-O3", '-funroll-loops', '-pthread']
+# the libraries are compiled and linked by cmake with cmake_compiler_extra_args.
+# CMakeLists.txt.in links them against the thread library.
 # uncomment the next line to add extra optimization options
 #extra_compile_args = ["-std=c++0x","-Wall", '-Wextra','-pedantic','-O3', "-march=native", "-mtune=native"]
 
@@ -255,7 +257,10 @@ cxx_files = ["pele/potentials/_lj_cpp.cxx",
              "pele/potentials/_pspin_spherical_cpp.cxx",
              "pele/optimize/_pele_opt.cxx",
              "pele/optimize/_lbfgs_cpp.cxx",
+             "pele/optimize/_cg_cpp.cxx",
+             "pele/optimize/_truncated_newton_cpp.cxx",
              "pele/optimize/_modified_fire_cpp.cxx",
+             "pele/optimize/_batch_cpp.cxx",
              "pele/potentials/_pythonpotential.cxx",
              "pele/angleaxis/_cpp_aa.cxx",
              "pele/utils/_cpp_utils.cxx",
@@ -0,0 +1,120 @@
+#include "pele/cg.h"
+
+#include <algorithm>
+#include <iostream>
+
+using std::cout;
+
+namespace pele {
+
+CG::CG(std::shared_ptr<pele::BasePotential> potential, const pele::Array<double> x0,
+        double tol)
+    : GradientOptimizer(potential, x0, tol),
+      linesearch_(1e-4, 0.1),
+      d_(x_.size()),
+      gold_(x_.size()),
+      xnew_(x_.size()),
+      gnew_(x_.size()),
+      gd_old_(0),
+      stp_old_(0),
+      restart_(true)
+{}
+
+/**
+* Do one iteration iteration of the optimization algorithm
+*/
+void CG::one_iteration()
+{
+    if (!func_initialized_)
+        initialize_func_gradient();
+
+    // compute the new search direction
+    const size_t N = x_.size();
+    double gd = 0;
+    if (! restart_) {
+        double gg = 0, ggold = 0, goldgold = 0;
+        for (size_t j2 = 0; j2 < N; ++j2){
+            gg += g_[j2] * g_[j2];
+            ggold += g_[j2] * gold_[j2];
+            goldgold += gold_[j2] * gold_[j2];
+        }
+        const double beta = std::max(0., (gg - ggold) / goldgold);
+        for (size_t j2 = 0; j2 < N; ++j2){
+            d_[j2] = -g_[j2] + beta * d_[j2];
+            gd += g_[j2] * d_[j2];
+        }
+        if (gd >= 0) {
+            // not a descent direction
+            restart_ = true;
+        }
+    }
+
+    // the initial trial step.  After the first iteration we assume that
+    // the first order change of the function is the same as in the previous
+    // iteration, see Nocedal and Wright (3.60)
+    double stp = 1.;
+    if (restart_) {
+        gd = 0;
+        for (size_t j2 = 0; j2 < N; ++j2){
+            d_[j2] = -g_[j2];
+            gd -= g_[j2] * g_[j2];
+        }
+    } else if (stp_old_ > 0) {
+        stp = stp_old_ * gd_old_ / gd;
+    }
+    const double dnorm = norm(d_);
+    if (dnorm == 0) {
+        // the gradient vanishes, there is nothing left to do
+        iter_number_ += 1;
+        PELE_TRACE_ITERATION(0.);
+        return;
+    }
+    const double stpmax = maxstep_ / dnorm;
+    stp = std::min(stp, stpmax);
+
+    gold_.assign(g_);
+    double fnew;
+    stp = linesearch_.search(*potential_, x_, f_, g_, d_, stp, stpmax,
+            xnew_, fnew, gnew_, nfev_, &trace_);
+    if (stp > 0) {
+        x_.assign(xnew_);
+        g_.assign(gnew_);
+        f_ = fnew;
+        rms_ = norm(g_) / sqrt(g_.size());
+        restart_ = false;
+    } else {
+        if (verbosity_ > 0) {
+            cout << "warning: the line search did not find a lower point\n";
+        }
+        restart_ = true;
+    }
+    gd_old_ = gd;
+    stp_old_ = stp;
+
+    // print some status information
+    if ((iprint_ > 0) && (iter_number_ % iprint_ == 0)){
+        cout << "cg: " << iter_number_
+            << " E " << f_
+            << " rms " << rms_
+            << " nfev " << nfev_
+            << " stepsize " << stp * dnorm << "\n";
+    }
+    iter_number_ += 1;
+    PELE_TRACE_ITERATION(stp * dnorm);
+}
+
+void CG::reset(pele::Array<double> &x0)
+{
+    if (x0.size() != x_.size()){
+        throw std::invalid_argument("The number of degrees of freedom (x0.size()) cannot change when calling reset()");
+    }
+    iter_number_ = 0;
+    nfev_ = 0;
+    gd_old_ = 0;
+    stp_old_ = 0;
+    restart_ = true;
+    x_.assign(x0);
+    initialize_func_gradient();
+}
+
+}
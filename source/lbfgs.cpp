@@ -11,18 +11,21 @@ LBFGS::LBFGS( std::shared_ptr<pele::BasePotential> potential, const pele::Array<
       M_(M),
       max_f_rise_(1e-4),
       use_relative_f_(false),
+      energy_only_linesearch_(false),
+      memory_(2 * M_ * x_.size(), 0.),
       rho_(M_),
       H0_(0.1),
-      k_(0)
+      k_(0),
+      xold_(x_.size()),
+      gold_(x_.size()),
+      step_(x_.size()),
+      xnew_(x_.size()),
+      gnew_(x_.size()),
+      alpha_(M_),
+      preconditioned_y_(x_.size())
 {
     // set the precision of the printing
     cout << std::setprecision(12);
-
-    // allocate space for s_ and y_
-    for (int i = 0; i < M_; ++i){
-        s_.push_back(Array<double>(x_.size()));
-        y_.push_back(Array<double>(x_.size()));
-    }
 }
 
 /**
@@ -33,19 +36,33 @@ void LBFGS::one_iteration()
     if (!func_initialized_)
         initialize_func_gradient();
 
+    if (preconditioner_) {
+        preconditioner_->update(x_, g_);
+    }
+
     // make a copy of the position and gradient
-    Array<double> xold(x_.copy());
-    Array<double> gold(g_.copy());
+    xold_.assign(x_);
+    gold_.assign(g_);
 
     // get the stepsize and direction from the LBFGS algorithm
-    Array<double> step(x_.size());
-    compute_lbfgs_step(step);
-
-    // reduce the stepsize if necessary
-    double stepsize = backtracking_linesearch(step);
+    compute_lbfgs_step(step_);
+
+    double stepsize;
+    if (linesearch_) {
+        stepsize = wolfe_linesearch(step_);
+    } else {
+        // reduce the stepsize if necessary
+        stepsize = backtracking_linesearch(step_);
+    }
 
-    // update the LBFGS memeory
-    update_memory(xold, gold, x_, g_);
+    if (linesearch_ && stepsize == 0) {
+        // the line search failed. forget the memory and start again with a
+        // steepest descent step
+        k_ = 0;
+    } else {
+        // update the LBFGS memeory
+        update_memory(xold_, gold_, x_, g_);
+    }
 
     // print some status information
     if ((iprint_ > 0) && (iter_number_ % iprint_ == 0)){
@@ -56,6 +73,7 @@ void LBFGS::one_iteration()
             << " stepsize " << stepsize << "\n";
     }
     iter_number_ += 1;
+    PELE_TRACE_ITERATION(stepsize);
 }
 
 void LBFGS::update_memory(
@@ -65,24 +83,46 @@ void LBFGS::update_memory(
         Array<double> gnew)
 {
     // update the lbfgs memory
-    // This updates s_, y_, rho_, and H0_, and k_
+    // This updates memory_, rho_, and H0_, and k_
     int klocal = k_ % M_;
-    for (size_t j2 = 0; j2 < x_.size(); ++j2){
-        y_[klocal][j2] = gnew[j2] - gold[j2];
-        s_[klocal][j2] = xnew[j2] - xold[j2];
+    double * const __restrict__ s = s_row(klocal);
+    double * const __restrict__ y = y_row(klocal);
+    double const * const __restrict__ xo = xold.data();
+    double const * const __restrict__ go = gold.data();
+    double const * const __restrict__ xn = xnew.data();
+    double const * const __restrict__ gn = gnew.data();
+    const size_t N = x_.size();
+    // compute y, s, ys and yy in one pass
+    double ys = 0;
+    double yy = 0;
+    for (size_t j2 = 0; j2 < N; ++j2){
+        y[j2] = gn[j2] - go[j2];
+        s[j2] = xn[j2] - xo[j2];
+        ys += y[j2] * s[j2];
+        yy += y[j2] * y[j2];
     }
 
-    double ys = dot(y_[klocal], s_[klocal]);
     if (ys == 0.) {
         if (verbosity_ > 0) {
             cout << "warning: resetting YS to 1.\n";
         }
         ys = 1.;
     }
+    if (preconditioner_) {
+        // scale H0 * M^-1 instead of H0 to the curvature along s
+        double * const __restrict__ py = preconditioned_y_.data();
+        for (size_t j2 = 0; j2 < N; ++j2){
+            py[j2] = y[j2];
+        }
+        preconditioner_->apply(preconditioned_y_);
+        yy = 0;
+        for (size_t j2 = 0; j2 < N; ++j2){
+            yy += py[j2] * y[j2];
+        }
+    }
 
     rho_[klocal] = 1. / ys;
 
-    double yy = dot(y_[klocal], y_[klocal]);
     if (yy == 0.) {
         if (verbosity_ > 0) {
             cout << "warning: resetting YY to 1.\n";
@@ -104,49 +144,90 @@ void LBFGS::compute_lbfgs_step(Array<double> step)
         for (size_t j2 = 0; j2 < x_.size(); ++j2){
             step[j2] = -gnorm * H0_ * g_[j2];
         }
+        if (preconditioner_) {
+            preconditioner_->apply(step);
+        }
         return;
     }
 
-    // copy the gradient into step
-    step.assign(g_);
-
-    int jmin = std::max(0, k_ - M_);
-    int jmax = k_;
-    int i;
-    double beta;
-    Array<double> alpha(M_);
-
-    // loop backwards through the memory
+    const size_t N = x_.size();
+    double * const __restrict__ q = step.data();
+    double const * const __restrict__ g = g_.data();
+    const int jmin = std::max(0, k_ - M_);
+    const int jmax = k_;
+
+    // loop backwards through the memory.  The first pass copies the gradient
+    // into step, the following ones subtract alpha_i y_i.  Each pass also
+    // computes the dot product of the updated step with the next s.
+    double sq = 0;
+    {
+        double const * const __restrict__ s = s_row((jmax - 1) % M_);
+        for (size_t j2 = 0; j2 < N; ++j2){
+            q[j2] = g[j2];
+            sq += s[j2] * q[j2];
+        }
+    }
+    double yq = 0;
     for (int j = jmax - 1; j >= jmin; --j){
-        i = j % M_;
-        //cout << "    i " << i << " j " << j << "\n";
-        alpha[i] = rho_[i] * dot(s_[i], step);
-        for (size_t j2 = 0; j2 < step.size(); ++j2){
-            step[j2] -= alpha[i] * y_[i][j2];
+        const int i = j % M_;
+        alpha_[i] = rho_[i] * sq;
+        const double alpha = alpha_[i];
+        double const * const __restrict__ y = y_row(i);
+        if (j > jmin) {
+            double const * const __restrict__ s = s_row((j - 1) % M_);
+            sq = 0;
+            for (size_t j2 = 0; j2 < N; ++j2){
+                q[j2] -= alpha * y[j2];
+                sq += s[j2] * q[j2];
+            }
+        } else if (! preconditioner_) {
+            // the last pass also scales the step by H0 and starts the
+            // forward loop
+            double const * const __restrict__ ynext = y_row(jmin % M_);
+            for (size_t j2 = 0; j2 < N; ++j2){
+                q[j2] = H0_ * (q[j2] - alpha * y[j2]);
+                yq += ynext[j2] * q[j2];
+            }
+        } else {
+            // apply H0 * M^-1 before starting the forward loop
+            for (size_t j2 = 0; j2 < N; ++j2){
+                q[j2] -= alpha * y[j2];
+            }
+            preconditioner_->apply(step);
+            double const * const __restrict__ ynext = y_row(jmin % M_);
+            for (size_t j2 = 0; j2 < N; ++j2){
+                q[j2] *= H0_;
+                yq += ynext[j2] * q[j2];
+            }
         }
     }
 
-    // scale the step size by H0
-    step *= H0_;
-
-    // loop forwards through the memory
+    // loop forwards through the memory, adding (alpha_i - beta_i) s_i.  The
+    // last pass inverts the step to point downhill.
     for (int j = jmin; j < jmax; ++j){
-        i = j % M_;
-        //cout << "    i " << i << " j " << j << "\n";
-        beta = rho_[i] * dot(y_[i], step);
-        for (size_t j2 = 0; j2 < step.size(); ++j2){
-            step[j2] += s_[i][j2] * (alpha[i] - beta);
+        const int i = j % M_;
+        const double beta = rho_[i] * yq;
+        const double c = alpha_[i] - beta;
+        double const * const __restrict__ s = s_row(i);
+        if (j + 1 < jmax) {
+            double const * const __restrict__ ynext = y_row((j + 1) % M_);
+            yq = 0;
+            for (size_t j2 = 0; j2 < N; ++j2){
+                q[j2] += s[j2] * c;
+                yq += ynext[j2] * q[j2];
+            }
+        } else {
+            for (size_t j2 = 0; j2 < N; ++j2){
+                q[j2] = -(q[j2] + s[j2] * c);
+            }
         }
     }
-
-    // invert the step to point downhill
-    step *= -1;
 }
 
 double LBFGS::backtracking_linesearch(Array<double> step)
 {
-    Array<double> xnew(x_.size());
-    Array<double> gnew(x_.size());
+    Array<double> & xnew = xnew_;
+    Array<double> & gnew = gnew_;
     double fnew;
 
     // if the step is pointing uphill, invert it
@@ -169,11 +250,18 @@ double LBFGS::backtracking_linesearch(Array<double> step)
 
     int nred;
     int nred_max = 10;
+    bool have_gnew = false; // whether gnew belongs to xnew
     for (nred = 0; nred < nred_max; ++nred){
         for (size_t j2 = 0; j2 < xnew.size(); ++j2){
             xnew[j2] = x_[j2] + factor * step[j2];
         }
-        compute_func_gradient(xnew, fnew, gnew);
+        if (nred > 0 && energy_only_linesearch_) {
+            compute_func(xnew, fnew);
+            have_gnew = false;
+        } else {
+            compute_func_gradient(xnew, fnew, gnew);
+            have_gnew = true;
+        }
 
         double df = fnew - f_;
         if (use_relative_f_) {
@@ -206,6 +294,10 @@ double LBFGS::backtracking_linesearch(Array<double> step)
         }
     }
 
+    if (! have_gnew) {
+        compute_func_gradient(xnew, fnew, gnew);
+    }
+
     x_.assign(xnew);
     g_.assign(gnew);
     f_ = fnew;
@@ -213,6 +305,44 @@ double LBFGS::backtracking_linesearch(Array<double> step)
     return stepsize * factor;
 }
 
+double LBFGS::wolfe_linesearch(Array<double> step)
+{
+    // if the step is pointing uphill, invert it
+    double gp = dot(step, g_);
+    if (gp > 0.){
+        if (verbosity_ > 1) {
+            cout << "warning: step direction was uphill.  inverting\n";
+        }
+        step *= -1;
+        gp = -gp;
+    }
+    if (gp == 0.) {
+        if (verbosity_ > 0) {
+            cout << "warning: the step is orthogonal to the gradient\n";
+        }
+        return 0;
+    }
+
+    // the step is limited to maxstep_
+    const double stepsize = norm(step);
+    const double stpmax = maxstep_ / stepsize;
+    double fnew;
+    const double stp = linesearch_->search(*potential_, x_, f_, g_, step,
+            std::min(1., stpmax), stpmax, xnew_, fnew, gnew_, nfev_, &trace_);
+    if (stp == 0) {
+        if (verbosity_ > 0) {
+            cout << "warning: the line search did not find a lower point\n";
+        }
+        return 0;
+    }
+
+    x_.assign(xnew_);
+    g_.assign(gnew_);
+    f_ = fnew;
+    rms_ = norm(g_) / sqrt(g_.size());
+    return stepsize * stp;
+}
+
 void LBFGS::reset(pele::Array<double> &x0)
 {
     if (x0.size() != x_.size()){
@@ -0,0 +1,274 @@
+#include "pele/linesearch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace pele {
+
+MoreThuenteLineSearch::MoreThuenteLineSearch(double ftol, double gtol, double xtol,
+        int max_nfev)
+    : ftol_(ftol),
+      gtol_(gtol),
+      xtol_(xtol),
+      max_nfev_(max_nfev)
+{
+    if (ftol_ <= 0 || gtol_ <= ftol_ || gtol_ >= 1) {
+        throw std::invalid_argument("MoreThuenteLineSearch: 0 < ftol < gtol < 1 is required");
+    }
+}
+
+double MoreThuenteLineSearch::search(BasePotential & potential, Array<double> const & x,
+        double f, Array<double> const & g, Array<double> const & p, double stp,
+        double stpmax, Array<double> xnew, double & fnew, Array<double> gnew, int & nfev,
+        OptimizerTrace * trace) const
+{
+    // extrapolation factors for the trial steps before the minimum is bracketed
+    static const double xtrapl = 1.1;
+    static const double xtrapu = 4.;
+    const double stpmin = 0;
+    const double finit = f;
+    const double ginit = dot(g, p);
+    if (ginit >= 0) {
+        throw std::invalid_argument("MoreThuenteLineSearch: p is not a descent direction");
+    }
+    if (stpmax <= 0) {
+        throw std::invalid_argument("MoreThuenteLineSearch: stpmax must be positive");
+    }
+    stp = std::min(std::max(stp, stpmin), stpmax);
+    const double gtest = ftol_ * ginit;
+
+    // compute f and the directional derivative at x + stp * p
+    double dg;
+    auto evaluate = [&](double const s) {
+        for (size_t j2 = 0; j2 < x.size(); ++j2) {
+            xnew[j2] = x[j2] + s * p[j2];
+        }
+        if (trace != NULL && trace->is_enabled()) {
+            fnew = trace->time_potential([&]() { return potential.get_energy_gradient(xnew, gnew); });
+        } else {
+            fnew = potential.get_energy_gradient(xnew, gnew);
+        }
+        ++nfev;
+        dg = dot(gnew, p);
+    };
+
+    bool brackt = false;
+    int stage = 1;
+    double width = stpmax - stpmin;
+    double width1 = 2 * width;
+    // stx is the step with the lowest function value so far, sty the other
+    // end of the interval of uncertainty
+    double stx = 0, fx = finit, gx = ginit;
+    double sty = 0, fy = finit, gy = ginit;
+    double stmin = 0;
+    double stmax = stp + xtrapu * stp;
+
+    for (int nfev_local = 1; ; ++nfev_local) {
+        evaluate(stp);
+        const double ftest = finit + stp * gtest;
+        if (stage == 1 && fnew <= ftest && dg >= 0) {
+            stage = 2;
+        }
+
+        // test for convergence
+        if (fnew <= ftest && std::fabs(dg) <= -gtol_ * ginit) {
+            return stp;
+        }
+        // test for the cases where the Wolfe conditions can not be satisfied
+        if ((brackt && (stp <= stmin || stp >= stmax))
+                || (brackt && stmax - stmin <= xtol_ * stmax)
+                || (stp == stpmax && fnew <= ftest && dg <= gtest)
+                || (stp == stpmin && (fnew > ftest || dg >= gtest))
+                || nfev_local >= max_nfev_) {
+            break;
+        }
+
+        // In the first stage, while the step does not satisfy the sufficient
+        // decrease condition, use the modified function
+        // psi(stp) = phi(stp) - phi(0) - stp * gtest
+        if (stage == 1 && fnew <= fx && fnew > ftest) {
+            double fm = fnew - stp * gtest;
+            double fxm = fx - stx * gtest;
+            double fym = fy - sty * gtest;
+            double gm = dg - gtest;
+            double gxm = gx - gtest;
+            double gym = gy - gtest;
+            step(stx, fxm, gxm, sty, fym, gym, stp, fm, gm, brackt, stmin, stmax);
+            fx = fxm + stx * gtest;
+            fy = fym + sty * gtest;
+            gx = gxm + gtest;
+            gy = gym + gtest;
+        } else {
+            step(stx, fx, gx, sty, fy, gy, stp, fnew, dg, brackt, stmin, stmax);
+        }
+
+        // force a sufficient decrease of the interval of uncertainty
+        if (brackt) {
+            if (std::fabs(sty - stx) >= 0.66 * width1) {
+                stp = stx + 0.5 * (sty - stx);
+            }
+            width1 = width;
+            width = std::fabs(sty - stx);
+            stmin = std::min(stx, sty);
+            stmax = std::max(stx, sty);
+        } else {
+            stmin = stp + xtrapl * (stp - stx);
+            stmax = stp + xtrapu * (stp - stx);
+        }
+
+        stp = std::min(std::max(stp, stpmin), stpmax);
+        // if further progress is not possible, let stp be the best step
+        if ((brackt && (stp <= stmin || stp >= stmax))
+                || (brackt && stmax - stmin <= xtol_ * stmax)) {
+            stp = stx;
+        }
+    }
+
+    // the search failed. return the lowest point found
+    if (fnew < finit && fnew <= fx) {
+        return stp;
+    }
+    if (stx > 0) {
+        evaluate(stx);
+        return stx;
+    }
+    xnew.assign(x);
+    gnew.assign(g);
+    fnew = f;
+    return 0;
+}
+
+void MoreThuenteLineSearch::step(double & stx, double & fx, double & dx, double & sty,
+        double & fy, double & dy, double & stp, double fp, double dp, bool & brackt,
+        double stpmin, double stpmax)
+{
+    const bool opposite_signs = (dp < 0 && dx > 0) || (dp > 0 && dx < 0);
+    double stpf;
+
+    if (fp > fx) {
+        // case 1: a higher function value.  The minimum is bracketed.  Take
+        // the cubic step if it is closer to stx than the quadratic step,
+        // otherwise the average of the two.
+        const double theta = 3 * (fx - fp) / (stp - stx) + dx + dp;
+        const double s = std::max(std::fabs(theta), std::max(std::fabs(dx), std::fabs(dp)));
+        double gamma = s * std::sqrt((theta / s) * (theta / s) - (dx / s) * (dp / s));
+        if (stp < stx) {
+            gamma = -gamma;
+        }
+        const double p = (gamma - dx) + theta;
+        const double q = ((gamma - dx) + gamma) + dp;
+        const double r = p / q;
+        const double stpc = stx + r * (stp - stx);
+        const double stpq = stx + ((dx / ((fx - fp) / (stp - stx) + dx)) / 2) * (stp - stx);
+        if (std::fabs(stpc - stx) < std::fabs(stpq - stx)) {
+            stpf = stpc;
+        } else {
+            stpf = stpc + (stpq - stpc) / 2;
+        }
+        brackt = true;
+    } else if (opposite_signs) {
+        // case 2: a lower function value and derivatives of opposite sign.
+        // The minimum is bracketed.  Take the step farther from stp.
+        const double theta = 3 * (fx - fp) / (stp - stx) + dx + dp;
+        const double s = std::max(std::fabs(theta), std::max(std::fabs(dx), std::fabs(dp)));
+        double gamma = s * std::sqrt((theta / s) * (theta / s) - (dx / s) * (dp / s));
+        if (stp > stx) {
+            gamma = -gamma;
+        }
+        const double p = (gamma - dp) + theta;
+        const double q = ((gamma - dp) + gamma) + dx;
+        const double r = p / q;
+        const double stpc = stp + r * (stx - stp);
+        const double stpq = stp + (dp / (dp - dx)) * (stx - stp);
+        if (std::fabs(stpc - stp) > std::fabs(stpq - stp)) {
+            stpf = stpc;
+        } else {
+            stpf = stpq;
+        }
+        brackt = true;
+    } else if (std::fabs(dp) < std::fabs(dx)) {
+        // case 3: a lower function value, derivatives of the same sign, and
+        // the magnitude of the derivative decreases.  The cubic step is only
+        // used if it tends to infinity in the direction of the step or if
+        // its minimum is beyond stp.
+        const double theta = 3 * (fx - fp) / (stp - stx) + dx + dp;
+        const double s = std::max(std::fabs(theta), std::max(std::fabs(dx), std::fabs(dp)));
+        double gamma = s * std::sqrt(std::max(0., (theta / s) * (theta / s) - (dx / s) * (dp / s)));
+        if (stp > stx) {
+            gamma = -gamma;
+        }
+        const double p = (gamma - dp) + theta;
+        const double q = (gamma + (dx - dp)) + gamma;
+        const double r = p / q;
+        double stpc;
+        if (r < 0 && gamma != 0) {
+            stpc = stp + r * (stx - stp);
+        } else if (stp > stx) {
+            stpc = stpmax;
+        } else {
+            stpc = stpmin;
+        }
+        const double stpq = stp + (dp / (dp - dx)) * (stx - stp);
+        if (brackt) {
+            // take the step closer to stp, but not too close to sty
+            if (std::fabs(stpc - stp) < std::fabs(stpq - stp)) {
+                stpf = stpc;
+            } else {
+                stpf = stpq;
+            }
+            if (stp > stx) {
+                stpf = std::min(stp + 0.66 * (sty - stp), stpf);
+            } else {
+                stpf = std::max(stp + 0.66 * (sty - stp), stpf);
+            }
+        } else {
+            // take the step farther from stp
+            if (std::fabs(stpc - stp) > std::fabs(stpq - stp)) {
+                stpf = stpc;
+            } else {
+                stpf = stpq;
+            }
+            stpf = std::min(stpmax, stpf);
+            stpf = std::max(stpmin, stpf);
+        }
+    } else {
+        // case 4: a lower function value, derivatives of the same sign, and
+        // the magnitude of the derivative does not decrease.
+        if (brackt) {
+            const double theta = 3 * (fp - fy) / (sty - stp) + dy + dp;
+            const double s = std::max(std::fabs(theta), std::max(std::fabs(dy), std::fabs(dp)));
+            double gamma = s * std::sqrt((theta / s) * (theta / s) - (dy / s) * (dp / s));
+            if (stp > sty) {
+                gamma = -gamma;
+            }
+            const double p = (gamma - dp) + theta;
+            const double q = ((gamma - dp) + gamma) + dy;
+            const double r = p / q;
+            stpf = stp + r * (sty - stp);
+        } else if (stp > stx) {
+            stpf = stpmax;
+        } else {
+            stpf = stpmin;
+        }
+    }
+
+    // update the interval which contains a minimizer
+    if (fp > fx) {
+        sty = stp;
+        fy = fp;
+        dy = dp;
+    } else {
+        if (opposite_signs) {
+            sty = stx;
+            fy = fx;
+            dy = dx;
+        }
+        stx = stp;
+        fx = fp;
+        dx = dp;
+    }
+    stp = stpf;
+}
+
+}
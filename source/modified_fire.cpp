@@ -47,6 +47,7 @@ MODIFIED_FIRE::MODIFIED_FIRE(std::shared_ptr<pele::BasePotential> potential,
       _dtstart(dtstart),
       _dt(dtstart),
       _dtmax(dtmax),
+      _dtmin(0.02 * dtstart),
       _maxstep(maxstep),
       _Nmin(Nmin),
       _finc(finc),
@@ -57,13 +58,17 @@ MODIFIED_FIRE::MODIFIED_FIRE(std::shared_ptr<pele::BasePotential> potential,
       _fold(f_),
       _ifnorm(0),
       _vnorm(0),
+      _vv(0),
+      _vg(0),
+      _gg(0),
+      _dtstep(dtstart),
       _v(x0.size(), 0),
-      _dx(x0.size()),
       _xold(x0.copy()),
       _gold(g_.copy()),
       _fire_iter_number(0),
       _N(x_.size()),
-      _stepback(stepback)
+      _stepback(stepback),
+      _fire2(false)
 {}
 
 /**
@@ -73,13 +78,14 @@ MODIFIED_FIRE::MODIFIED_FIRE(std::shared_ptr<pele::BasePotential> potential,
 void MODIFIED_FIRE::initialize_func_gradient()
 {
     nfev_ += 1;                     //this accounts for the energy evaluation done by the integrator
-    f_ = potential_->get_energy_gradient(x_, g_);
+    f_ = PELE_TRACE_POTENTIAL(potential_->get_energy_gradient(x_, g_));
     _fold = f_;
     for (size_t k = 0; k < x_.size(); ++k) { //set initial velocities (using forward Euler)
         _v[k] = -g_[k] * _dt;
     }
-    _ifnorm = 1. / norm(g_);
-    _vnorm = norm(_v);
+    _update_dot_products();
+    _ifnorm = 1. / sqrt(_gg);
+    _vnorm = sqrt(_vv);
     rms_ = 1. / (_ifnorm * sqrt(_N));
     func_initialized_ = true;
 }
@@ -100,8 +106,9 @@ void MODIFIED_FIRE::set_func_gradient(double f, Array<double> grad)
     for (size_t k = 0; k < x_.size(); ++k) { //set initial velocities (using forward Euler)
         _v[k] = -g_[k] * _dt;
     }
-    _ifnorm = 1. / norm(g_);
-    _vnorm = norm(_v);
+    _update_dot_products();
+    _ifnorm = 1. / sqrt(_gg);
+    _vnorm = sqrt(_vv);
     rms_ = 1. / (_ifnorm * sqrt(_N));
     func_initialized_ = true;
 }
@@ -15,6 +15,7 @@
 #include "pele/array.h"
 #include "pele/rotations.h"
 #include "pele/base_potential.h"
+#include "pele/preconditioner.h"
 #include "pele/vecn.h"
 #include "pele/lowest_eig_potential.h"
 #include "pele/matrix.h"
@@ -255,6 +256,11 @@ public:
      */
     inline size_t natoms() const { return _natoms; }
 
+    /**
+     * return the positions of the atoms in the reference frame of the rigid body
+     */
+    inline pele::Array<double> const & get_atom_positions() const { return _atom_positions; }
+
     /**
      * add a symmetry rotation
      */
@@ -580,6 +586,40 @@ public:
     }
 };
 
+/**
+ * Diagonal preconditioner which scales the translational and rotational
+ * degrees of freedom of rigid bodies.
+ *
+ * Moving the center of mass of a rigid body with n atoms by dx moves all n
+ * atoms by dx, while rotating it by a small angle phi moves atom a by about
+ * phi |x_a|.  The translational degrees of freedom are therefore weighted by
+ * n and the rotational ones by 2/3 sum_a |x_a|^2, the average over the
+ * rotation axes.  This only depends on the topology, not on the coordinates.
+ */
+class RigidBodyPreconditioner : public DiagonalPreconditioner {
+public:
+    RigidBodyPreconditioner(std::shared_ptr<RBTopology> topology)
+    {
+        const size_t nrigid = topology->nrigid();
+        pele::Array<double> diagonal(6 * nrigid);
+        for (size_t isite = 0; isite < nrigid; ++isite) {
+            RigidFragment const & site = topology->get_sites()[isite];
+            pele::Array<double> const & xa = site.get_atom_positions();
+            double r2 = 0;
+            for (double const xk : xa) {
+                r2 += xk * xk;
+            }
+            const double translational = site.natoms();
+            const double rotational = 2. / 3. * r2;
+            for (size_t k = 0; k < 3; ++k) {
+                diagonal[3 * isite + k] = translational;
+                diagonal[3 * nrigid + 3 * isite + k] = (rotational > 0) ? rotational : translational;
+            }
+        }
+        set_diagonal(diagonal);
+    }
+};
+
 }
 
 #endif
@@ -3,6 +3,7 @@
 
 #include "array.h"
 #include "base_potential.h"
+#include "sparse_hessian.h"
 #include <iostream>
 
 namespace pele {
@@ -41,6 +42,8 @@ protected:
 
 public:
 
+    virtual bool can_run_concurrently() const { return true; }
+
     virtual inline double get_energy(Array<double> x)
     {
         double e=0.;
@@ -67,6 +70,12 @@ public:
 
     }
 
+    virtual inline double get_energy_gradient(Array<double> x, Array<double> grad)
+    {
+        grad.assign(0.);
+        return add_energy_gradient(x, grad);
+    }
+
     virtual inline double add_energy_gradient(Array<double> x, Array<double> grad)
     {
         if (x.size() != grad.size()) {
@@ -103,6 +112,14 @@ public:
         return e;
     }
 
+    virtual inline double get_energy_gradient_hessian(Array<double> x,
+            Array<double> grad, Array<double> hess)
+    {
+        grad.assign(0.);
+        hess.assign(0.);
+        return add_energy_gradient_hessian(x, grad, hess);
+    }
+
     virtual inline double add_energy_gradient_hessian(Array<double> x,
             Array<double> grad, Array<double> hess)
     {
@@ -171,6 +188,44 @@ public:
         return e;
     }
 
+    virtual inline void get_hessian_vector_product(Array<double> x, Array<double> v,
+            Array<double> out)
+    {
+        out.assign(0.);
+        add_hessian_vector_product(x, v, out);
+    }
+
+    virtual inline void add_hessian_vector_product(Array<double> x, Array<double> v,
+            Array<double> out)
+    {
+        if (x.size() != v.size() || x.size() != out.size()) {
+            throw std::invalid_argument("v and out must have the same size as x");
+        }
+
+        double hij, gij;
+        size_t jstart = 0;
+        double dr[_ndim];
+
+        for(size_t i=0; i<_atoms1.size(); ++i) {
+            size_t atom1 = _atoms1[i];
+            size_t i1 = _ndim * atom1;
+            if (_one_list){
+                jstart = i+1;
+            }
+            for(size_t j=jstart; j<_atoms2.size(); ++j) {
+                size_t atom2 = _atoms2[j];
+                size_t i2 = _ndim * atom2;
+
+                _dist->get_rij(dr, &x[i1], &x[i2]);
+                double r2 = 0;
+                for (size_t k=0;k<_ndim;++k){r2 += dr[k]*dr[k];}
+
+                _interaction->energy_gradient_hessian(r2, &gij, &hij, atom1, atom2);
+                pair_hessian_vector_product<_ndim>(gij, hij, dr, r2, &v[i1], &v[i2], &out[i1], &out[i2]);
+            }
+        }
+    }
+
 };
 }
 
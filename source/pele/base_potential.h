@@ -6,6 +6,8 @@
 #include <stdexcept>
 #include <iostream>
 #include "array.h"
+#include "parallel.h"
+#include "sparse_hessian.h"
 
 namespace pele {
 
@@ -46,6 +48,34 @@ public:
     }
 
 
+    /**
+     * return the change in energy when the atoms in changed_atoms move from
+     * their positions in x_old to their positions in x_new.
+     *
+     * All other atoms must have the same position in x_old and x_new.  This
+     * is meant for Monte Carlo moves of one or a few atoms.  If not
+     * overloaded the energy is computed twice from scratch.
+     */
+    virtual double get_energy_change(Array<double> x_old, Array<double> x_new,
+            Array<size_t> /*changed_atoms*/)
+    {
+        return get_energy(x_new) - get_energy(x_old);
+    }
+
+    /**
+     * return the change in energy as in get_energy_change and update the gradient.
+     *
+     * On input grad must be the gradient at x_old, on output it is the
+     * gradient at x_new.  If not overloaded the energy and gradient are
+     * computed from scratch.
+     */
+    virtual double get_energy_gradient_change(Array<double> x_old, Array<double> x_new,
+            Array<size_t> /*changed_atoms*/, Array<double> grad)
+    {
+        const double energy_old = get_energy(x_old);
+        return get_energy_gradient(x_new, grad) - energy_old;
+    }
+
     /**
      * compute the energy, gradient, and Hessian, but don't initialize the gradient or hessian to zero
      */
@@ -69,6 +99,107 @@ public:
         return energy;
     }
 
+    /**
+     * compute the energies of K configurations at once.
+     *
+     * x holds the K configurations one after the other, energies has size K.
+     * If the potential can_run_concurrently(), the configurations are split
+     * between up to nr_threads threads.
+     */
+    virtual void get_energy_batch(Array<double> x, Array<double> energies,
+            size_t nr_threads=1)
+    {
+        const size_t ndof = check_batch_size(x, energies);
+        loop_through_batch(energies.size(), nr_threads, [&](size_t iconf) {
+            energies[iconf] = get_energy(Array<double>(x.data() + ndof * iconf, ndof));
+        });
+    }
+
+    /**
+     * compute the energies and gradients of K configurations at once.
+     *
+     * x and grad hold the K configurations and gradients one after the
+     * other, see get_energy_batch.
+     */
+    virtual void get_energy_gradient_batch(Array<double> x, Array<double> energies,
+            Array<double> grad, size_t nr_threads=1)
+    {
+        const size_t ndof = check_batch_size(x, energies);
+        if (grad.size() != x.size()) {
+            throw std::invalid_argument("the gradient has the wrong size");
+        }
+        loop_through_batch(energies.size(), nr_threads, [&](size_t iconf) {
+            energies[iconf] = get_energy_gradient(Array<double>(x.data() + ndof * iconf, ndof),
+                    Array<double>(grad.data() + ndof * iconf, ndof));
+        });
+    }
+
+    /**
+     * return true if get_energy and get_energy_gradient may be called from
+     * several threads at the same time, i.e. if they do not modify the state
+     * of the potential.
+     */
+    virtual bool can_run_concurrently() const { return false; }
+
+    /**
+     * compute the energy and gradient and the Hessian as a sparse matrix.
+     *
+     * Short ranged potentials overload this to fill hess directly with
+     * ndim x ndim blocks.  If not overloaded the dense Hessian is computed
+     * and converted, with blocks of size 1.
+     */
+    virtual double get_energy_gradient_sparse_hessian(Array<double> x, Array<double> grad,
+            BlockSparseMatrix & hess)
+    {
+        Array<double> dense(x.size() * x.size());
+        double energy = get_energy_gradient_hessian(x, grad, dense);
+        hess = BlockSparseMatrix::from_dense(dense, x.size(), 1);
+        return energy;
+    }
+
+    /**
+     * compute out = H(x) v, the product of the Hessian at x with the vector v.
+     *
+     * This needs neither the N^2 memory of the Hessian nor its computation
+     * time.  If not overloaded it is computed from two gradient evaluations
+     * with numerical_hessian_vector_product.
+     */
+    virtual void get_hessian_vector_product(Array<double> x, Array<double> v,
+            Array<double> out)
+    {
+        numerical_hessian_vector_product(x, v, out);
+    }
+
+    /**
+     * compute H(x) v as in get_hessian_vector_product, but add it to out
+     */
+    virtual void add_hessian_vector_product(Array<double> x, Array<double> v,
+            Array<double> out)
+    {
+        Array<double> hv(out.size());
+        get_hessian_vector_product(x, v, hv);
+        out += hv;
+    }
+
+    /**
+     * compute the diagonal of the Hessian at x
+     *
+     * If not overloaded it is taken from get_energy_gradient_sparse_hessian,
+     * which is analytic for the short ranged potentials.
+     */
+    virtual void get_hessian_diagonal(Array<double> x, Array<double> diag)
+    {
+        if (x.size() != diag.size()) {
+            throw std::invalid_argument("diag must have the same size as x");
+        }
+        Array<double> grad(x.size());
+        BlockSparseMatrix hess;
+        get_energy_gradient_sparse_hessian(x, grad, hess);
+        for (size_t i = 0; i < x.size(); ++i) {
+            diag[i] = hess.get(i, i);
+        }
+    }
+
     /**
      * compute the numerical gradient
      */
@@ -100,6 +231,37 @@ public:
         get_energy_gradient_hessian(x, grad, hess);
     }
 
+    /**
+     * compute the Hessian vector product from a central finite difference of
+     * the gradient along v.  The step along v has length eps.
+     */
+    virtual void numerical_hessian_vector_product(Array<double> x, Array<double> v,
+            Array<double> out, double eps=1e-6)
+    {
+        if (x.size() != v.size() || x.size() != out.size()) {
+            throw std::invalid_argument("v and out must have the same size as x");
+        }
+        const double vnorm = norm(v);
+        if (vnorm == 0) {
+            out.assign(0.);
+            return;
+        }
+        const double h = eps / vnorm;
+        Array<double> xnew(x.copy());
+        Array<double> gminus(x.size());
+        for (size_t i = 0; i < x.size(); ++i) {
+            xnew[i] = x[i] - h * v[i];
+        }
+        get_energy_gradient(xnew, gminus);
+        for (size_t i = 0; i < x.size(); ++i) {
+            xnew[i] = x[i] + h * v[i];
+        }
+        get_energy_gradient(xnew, out);
+        for (size_t i = 0; i < x.size(); ++i) {
+            out[i] = (out[i] - gminus[i]) / (2. * h);
+        }
+    }
+
     /**
      * compute the numerical gradient
      */
@@ -141,6 +303,36 @@ public:
         }*/
     }
 
+protected:
+    /**
+     * return the number of degrees of freedom of one configuration of a batch
+     */
+    size_t check_batch_size(Array<double> const & x, Array<double> const & energies) const
+    {
+        if (energies.size() == 0 || x.size() % energies.size() != 0) {
+            throw std::invalid_argument("x.size() must be a multiple of the number of configurations");
+        }
+        return x.size() / energies.size();
+    }
+
+    /**
+     * call func(iconf) for each configuration of a batch
+     */
+    template <class function_t>
+    void loop_through_batch(const size_t nconf, const size_t nr_threads, function_t func)
+    {
+        if (nr_threads == 0) {
+            throw std::invalid_argument("the number of threads must be positive");
+        }
+        const size_t nthreads = can_run_concurrently() ? std::min(nr_threads, nconf) : 1;
+        pele::parallel_for_chunks(nthreads, nconf,
+                [&](size_t /*ithread*/, size_t ibegin, size_t iend) {
+                    for (size_t iconf = ibegin; iconf < iend; ++iconf) {
+                        func(iconf);
+                    }
+                });
+    }
+
 };
 }
 
@@ -0,0 +1,312 @@
+#ifndef _PELE_BATCH_OPTIMIZER_H__
+#define _PELE_BATCH_OPTIMIZER_H__
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "array.h"
+#include "base_potential.h"
+#include "lbfgs.h"
+#include "modified_fire.h"
+#include "optimizer.h"
+#include "parallel.h"
+
+namespace pele {
+
+/**
+ * Minimize several independent configurations of the same potential in
+ * lockstep.
+ *
+ * Each configuration has its own optimizer, and with it its own convergence
+ * state.  An iteration of the batch does one iteration of every
+ * configuration which has not finished yet.  If the potential
+ * can_run_concurrently(), the active configurations are split between up to
+ * nr_threads threads.  Configurations which are converged or have reached
+ * the maximum number of iterations are dropped from the active set, so the
+ * work is rebalanced between the threads.  To keep the cost of starting
+ * the threads small, run() does iterations_per_round iterations of each
+ * configuration between two rebalancings.
+ *
+ * The configurations are passed as one array of size nconf * ndof.
+ */
+class BatchOptimizer {
+protected:
+    std::shared_ptr<pele::BasePotential> potential_;
+    size_t nconf_;
+    size_t ndof_;
+    size_t nr_threads_;
+    int iterations_per_round_;
+    std::vector<std::shared_ptr<GradientOptimizer> > optimizers_;
+    std::vector<size_t> active_; /**< the configurations which are not finished */
+    bool active_initialized_;
+
+    BatchOptimizer(std::shared_ptr<pele::BasePotential> potential, Array<double> const & x0,
+            size_t nconf, size_t nr_threads)
+        : potential_(potential),
+          nconf_(nconf),
+          ndof_(nconf > 0 ? x0.size() / nconf : 0),
+          nr_threads_(nr_threads),
+          iterations_per_round_(10),
+          active_initialized_(false)
+    {
+        if (nconf_ == 0 || x0.size() != nconf_ * ndof_) {
+            throw std::invalid_argument("x0.size() must be a multiple of the number of configurations");
+        }
+        if (nr_threads_ == 0) {
+            throw std::invalid_argument("the number of threads must be positive");
+        }
+        optimizers_.reserve(nconf_);
+        active_.reserve(nconf_);
+    }
+
+    /**
+     * return configuration iconf of x0
+     */
+    Array<double> configuration(Array<double> const & x0, size_t iconf) const
+    {
+        return Array<double>(const_cast<double *>(x0.data()) + ndof_ * iconf, ndof_);
+    }
+
+public:
+    virtual ~BatchOptimizer() {}
+
+    /**
+     * Do one iteration of each configuration which has not finished yet
+     */
+    void one_iteration()
+    {
+        do_round(1);
+    }
+
+    /**
+     * Run until all configurations are converged or have reached their
+     * maximum number of iterations, or for at most niter iterations
+     */
+    void run(int const niter)
+    {
+        for (int i = 0; i < niter; i += iterations_per_round_) {
+            if (! active_initialized_) {
+                update_active_set(true);
+            }
+            if (active_.empty()) {
+                break;
+            }
+            do_round(std::min(iterations_per_round_, niter - i));
+        }
+    }
+
+    void run()
+    {
+        int maxiter = 0;
+        for (auto const & opt : optimizers_) {
+            maxiter = std::max(maxiter, opt->get_maxiter() - opt->get_niter());
+        }
+        run(maxiter);
+    }
+
+    // functions for setting the parameters of all configurations
+    inline void set_tol(double tol) { for (auto & opt : optimizers_) opt->set_tol(tol); }
+    inline void set_maxstep(double maxstep) { for (auto & opt : optimizers_) opt->set_maxstep(maxstep); }
+    inline void set_max_iter(int max_iter)
+    {
+        for (auto & opt : optimizers_) opt->set_max_iter(max_iter);
+        active_initialized_ = false;
+    }
+    inline void set_iprint(int iprint) { for (auto & opt : optimizers_) opt->set_iprint(iprint); }
+    inline void set_verbosity(int verbosity) { for (auto & opt : optimizers_) opt->set_verbosity(verbosity); }
+    inline void set_iterations_per_round(int iterations_per_round)
+    {
+        if (iterations_per_round <= 0) {
+            throw std::invalid_argument("the number of iterations per round must be positive");
+        }
+        iterations_per_round_ = iterations_per_round;
+    }
+    inline void set_nr_threads(size_t nr_threads)
+    {
+        if (nr_threads == 0) {
+            throw std::invalid_argument("the number of threads must be positive");
+        }
+        nr_threads_ = nr_threads;
+    }
+
+    // functions for accessing the status of the optimizers
+    inline size_t get_nconf() const { return nconf_; }
+    inline size_t get_ndof() const { return ndof_; }
+    inline size_t get_nr_threads() const { return nr_threads_; }
+    inline int get_iterations_per_round() const { return iterations_per_round_; }
+    /**
+     * return the number of configurations which are not finished yet.  Before
+     * the first iteration this is the number of configurations
+     */
+    inline size_t get_nr_active()
+    {
+        if (! active_initialized_) {
+            update_active_set(true);
+        }
+        return active_.size();
+    }
+    inline std::shared_ptr<GradientOptimizer> get_optimizer(size_t iconf) const
+    {
+        return optimizers_.at(iconf);
+    }
+
+    /**
+     * return the coordinates of all configurations as one array
+     */
+    Array<double> get_x() const
+    {
+        Array<double> x(nconf_ * ndof_);
+        for (size_t iconf = 0; iconf < nconf_; ++iconf) {
+            configuration(x, iconf).assign(optimizers_[iconf]->get_x());
+        }
+        return x;
+    }
+
+    /**
+     * return the gradients of all configurations as one array
+     */
+    Array<double> get_g() const
+    {
+        Array<double> g(nconf_ * ndof_);
+        for (size_t iconf = 0; iconf < nconf_; ++iconf) {
+            configuration(g, iconf).assign(optimizers_[iconf]->get_g());
+        }
+        return g;
+    }
+
+    Array<double> get_f() const
+    {
+        Array<double> f(nconf_);
+        for (size_t iconf = 0; iconf < nconf_; ++iconf) {
+            f[iconf] = optimizers_[iconf]->get_f();
+        }
+        return f;
+    }
+
+    Array<double> get_rms() const
+    {
+        Array<double> rms(nconf_);
+        for (size_t iconf = 0; iconf < nconf_; ++iconf) {
+            rms[iconf] = optimizers_[iconf]->get_rms();
+        }
+        return rms;
+    }
+
+    /**
+     * return true if all configurations are converged
+     */
+    bool success()
+    {
+        for (auto & opt : optimizers_) {
+            if (! opt->success()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+protected:
+    /**
+     * do up to niter iterations of each active configuration, then remove
+     * the finished configurations from the active set
+     */
+    void do_round(int const niter)
+    {
+        if (! active_initialized_) {
+            update_active_set(true);
+        }
+        const size_t nactive = active_.size();
+        const size_t nthreads = potential_->can_run_concurrently()
+                ? std::max<size_t>(1, std::min(nr_threads_, nactive)) : 1;
+        pele::parallel_for_chunks(nthreads, nactive,
+                [&](size_t /*ithread*/, size_t ibegin, size_t iend) {
+                    for (size_t i = ibegin; i < iend; ++i) {
+                        GradientOptimizer & opt = *optimizers_[active_[i]];
+                        opt.run(std::min(niter, opt.get_maxiter() - opt.get_niter()));
+                    }
+                });
+        update_active_set(false);
+    }
+
+    /**
+     * remove the finished configurations from the active set.  If reset is
+     * true, the active set is instead rebuilt from all configurations.  The
+     * finished ones are then dropped after the next iteration, so the
+     * initial function evaluations are also done in parallel.
+     */
+    void update_active_set(bool reset)
+    {
+        if (reset) {
+            active_.clear();
+            for (size_t iconf = 0; iconf < nconf_; ++iconf) {
+                active_.push_back(iconf);
+            }
+            active_initialized_ = true;
+            return;
+        }
+        active_.erase(std::remove_if(active_.begin(), active_.end(),
+                [&](size_t iconf) {
+                    GradientOptimizer & opt = *optimizers_[iconf];
+                    return opt.get_niter() >= opt.get_maxiter() || opt.stop_criterion_satisfied();
+                }), active_.end());
+    }
+};
+
+/**
+ * Minimize several configurations with LBFGS, see BatchOptimizer
+ */
+class BatchLBFGS : public BatchOptimizer {
+public:
+    BatchLBFGS(std::shared_ptr<pele::BasePotential> potential, Array<double> const & x0,
+            size_t nconf, double tol=1e-4, int M=4, size_t nr_threads=1)
+        : BatchOptimizer(potential, x0, nconf, nr_threads)
+    {
+        for (size_t iconf = 0; iconf < nconf_; ++iconf) {
+            optimizers_.push_back(std::make_shared<LBFGS>(potential_,
+                    configuration(x0, iconf), tol, M));
+        }
+    }
+
+    inline void set_H0(double H0)
+    {
+        for (auto & opt : optimizers_) std::static_pointer_cast<LBFGS>(opt)->set_H0(H0);
+    }
+    inline void set_max_f_rise(double max_f_rise)
+    {
+        for (auto & opt : optimizers_) std::static_pointer_cast<LBFGS>(opt)->set_max_f_rise(max_f_rise);
+    }
+    inline void set_use_relative_f(int use_relative_f)
+    {
+        for (auto & opt : optimizers_) std::static_pointer_cast<LBFGS>(opt)->set_use_relative_f(use_relative_f);
+    }
+};
+
+/**
+ * Minimize several configurations with MODIFIED_FIRE, see BatchOptimizer
+ */
+class BatchFIRE : public BatchOptimizer {
+public:
+    BatchFIRE(std::shared_ptr<pele::BasePotential> potential, Array<double> const & x0,
+            size_t nconf, double dtstart, double dtmax, double maxstep, size_t Nmin=5,
+            double finc=1.1, double fdec=0.5, double fa=0.99, double astart=0.1,
+            double tol=1e-4, bool stepback=true, size_t nr_threads=1)
+        : BatchOptimizer(potential, x0, nconf, nr_threads)
+    {
+        for (size_t iconf = 0; iconf < nconf_; ++iconf) {
+            Array<double> xi = configuration(x0, iconf);
+            optimizers_.push_back(std::make_shared<MODIFIED_FIRE>(potential_, xi,
+                    dtstart, dtmax, maxstep, Nmin, finc, fdec, fa, astart, tol, stepback));
+        }
+    }
+
+    inline void set_fire2(bool fire2)
+    {
+        for (auto & opt : optimizers_) std::static_pointer_cast<MODIFIED_FIRE>(opt)->set_fire2(fire2);
+    }
+};
+
+} // namespace pele
+
+#endif // #ifndef _PELE_BATCH_OPTIMIZER_H__
@@ -1,6 +1,7 @@
 #ifndef _PELE_CELL_LIST_POTENTIAL_H
 #define _PELE_CELL_LIST_POTENTIAL_H
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
 #include <vector>
@@ -11,6 +12,11 @@
 #include "array.h"
 #include "distance.h"
 #include "cell_lists.h"
+#include "energy_change.h"
+#include "sparse_hessian.h"
+#include "verlet_lists.h"
+#include "parallel.h"
+#include "spatial_sort.h"
 #include "vecn.h"
 
 namespace pele{
@@ -196,6 +202,22 @@ public:
         }
         m_energy += m_interaction->energy(r2, atom_i.atom_index, atom_j.atom_index);
     }
+
+    /**
+     * return a new accumulator with the energy set to zero, e.g. for use in another thread
+     */
+    EnergyAccumulator make_empty_copy() const
+    {
+        return EnergyAccumulator(m_interaction, m_dist);
+    }
+
+    /**
+     * add the results of another accumulator to this one
+     */
+    void merge(EnergyAccumulator const & other)
+    {
+        m_energy += other.m_energy;
+    }
 };
 
 /**
@@ -239,6 +261,26 @@ public:
             m_gradient[xj_off + k] += gij * dr[k];
         }
     }
+
+    /**
+     * return a new accumulator with its own zeroed gradient, e.g. for use in another thread
+     */
+    EnergyGradientAccumulator make_empty_copy() const
+    {
+        return EnergyGradientAccumulator(m_interaction, m_dist,
+                pele::Array<double>(m_gradient.size(), 0.));
+    }
+
+    /**
+     * add the results of another accumulator to this one
+     */
+    void merge(EnergyGradientAccumulator const & other)
+    {
+        m_energy += other.m_energy;
+        for (size_t i = 0; i < m_gradient.size(); ++i) {
+            m_gradient[i] += other.m_gradient[i];
+        }
+    }
 };
 
 /**
@@ -314,6 +356,169 @@ public:
             }
         }
     }
+
+    /**
+     * return a new accumulator with its own zeroed gradient and Hessian, e.g. for use in another thread
+     */
+    EnergyGradientHessianAccumulator make_empty_copy() const
+    {
+        return EnergyGradientHessianAccumulator(m_interaction, m_dist,
+                pele::Array<double>(m_gradient.size(), 0.),
+                pele::Array<double>(m_hessian.size(), 0.));
+    }
+
+    /**
+     * add the results of another accumulator to this one
+     *
+     * Every atom pair is visited by exactly one accumulator, so the
+     * off-diagonal blocks, which are assigned rather than incremented, are
+     * zero in all but one of them and summing is correct.
+     */
+    void merge(EnergyGradientHessianAccumulator const & other)
+    {
+        m_energy += other.m_energy;
+        for (size_t i = 0; i < m_gradient.size(); ++i) {
+            m_gradient[i] += other.m_gradient[i];
+        }
+        for (size_t i = 0; i < m_hessian.size(); ++i) {
+            m_hessian[i] += other.m_hessian[i];
+        }
+    }
+};
+
+/**
+ * class which accumulates the energy, gradient, and a sparse Hessian one pair
+ * interaction at a time
+ *
+ * The Hessian blocks are written into a SparseHessianBuilder, so the memory
+ * needed is proportional to the number of interacting pairs.  Pairs beyond
+ * the cutoff of the interaction are not stored.
+ */
+template <typename pairwise_interaction, typename distance_policy>
+class EnergyGradientSparseHessianAccumulator {
+    const static size_t m_ndim = distance_policy::_ndim;
+    std::shared_ptr<pairwise_interaction> m_interaction;
+    std::shared_ptr<distance_policy> m_dist;
+    typedef pele::AtomPosition<m_ndim> atom_position;
+
+public:
+    double m_energy;
+    pele::Array<double> m_gradient;
+    pele::SparseHessianBuilder<m_ndim> m_hessian;
+
+    EnergyGradientSparseHessianAccumulator(std::shared_ptr<pairwise_interaction> interaction,
+            std::shared_ptr<distance_policy> dist, pele::Array<double> gradient)
+        : m_interaction(interaction),
+          m_dist(dist),
+          m_energy(0.),
+          m_gradient(gradient),
+          m_hessian(gradient.size() / m_ndim)
+    {}
+
+    void insert_atom_pair(atom_position const & atom_i, atom_position const & atom_j)
+    {
+        const size_t xi_off = m_ndim * atom_i.atom_index;
+        const size_t xj_off = m_ndim * atom_j.atom_index;
+        double dr[m_ndim];
+        m_dist->get_rij(dr, atom_i.x.data(), atom_j.x.data());
+        double r2 = 0;
+        for (size_t k = 0; k < m_ndim; ++k) {
+            r2 += dr[k] * dr[k];
+        }
+        double gij, hij;
+        m_energy += m_interaction->energy_gradient_hessian(r2, &gij, &hij, atom_i.atom_index, atom_j.atom_index);
+        if (gij == 0 && hij == 0) {
+            return;
+        }
+        for (size_t k = 0; k < m_ndim; ++k) {
+            m_gradient[xi_off + k] -= gij * dr[k];
+        }
+        for (size_t k = 0; k < m_ndim; ++k) {
+            m_gradient[xj_off + k] += gij * dr[k];
+        }
+        double block[m_ndim * m_ndim];
+        pele::pair_hessian_block<m_ndim>(gij, hij, dr, r2, block);
+        m_hessian.add_pair(atom_i.atom_index, atom_j.atom_index, block);
+    }
+
+    /**
+     * return a new accumulator with its own zeroed gradient and Hessian, e.g. for use in another thread
+     */
+    EnergyGradientSparseHessianAccumulator make_empty_copy() const
+    {
+        return EnergyGradientSparseHessianAccumulator(m_interaction, m_dist,
+                pele::Array<double>(m_gradient.size(), 0.));
+    }
+
+    /**
+     * add the results of another accumulator to this one
+     */
+    void merge(EnergyGradientSparseHessianAccumulator const & other)
+    {
+        m_energy += other.m_energy;
+        for (size_t i = 0; i < m_gradient.size(); ++i) {
+            m_gradient[i] += other.m_gradient[i];
+        }
+        m_hessian.merge(other.m_hessian);
+    }
+};
+
+/**
+ * class which accumulates the product of the Hessian with a vector one pair
+ * interaction at a time
+ */
+template <typename pairwise_interaction, typename distance_policy>
+class HessianVectorProductAccumulator {
+    const static size_t m_ndim = distance_policy::_ndim;
+    std::shared_ptr<pairwise_interaction> m_interaction;
+    std::shared_ptr<distance_policy> m_dist;
+    pele::Array<double> m_v;
+    typedef pele::AtomPosition<m_ndim> atom_position;
+
+public:
+    pele::Array<double> m_out;
+
+    HessianVectorProductAccumulator(std::shared_ptr<pairwise_interaction> interaction,
+            std::shared_ptr<distance_policy> dist, pele::Array<double> v,
+            pele::Array<double> out)
+        : m_interaction(interaction),
+          m_dist(dist),
+          m_v(v),
+          m_out(out)
+    {}
+
+    void insert_atom_pair(atom_position const & atom_i, atom_position const & atom_j)
+    {
+        const size_t xi_off = m_ndim * atom_i.atom_index;
+        const size_t xj_off = m_ndim * atom_j.atom_index;
+        double dr[m_ndim];
+        m_dist->get_rij(dr, atom_i.x.data(), atom_j.x.data());
+        double r2 = 0;
+        for (size_t k = 0; k < m_ndim; ++k) {
+            r2 += dr[k] * dr[k];
+        }
+        double gij, hij;
+        m_interaction->energy_gradient_hessian(r2, &gij, &hij, atom_i.atom_index, atom_j.atom_index);
+        pele::pair_hessian_vector_product<m_ndim>(gij, hij, dr, r2, m_v.data() + xi_off,
+                m_v.data() + xj_off, m_out.data() + xi_off, m_out.data() + xj_off);
+    }
+
+    /**
+     * return a new accumulator with its own zeroed output, e.g. for use in another thread
+     */
+    HessianVectorProductAccumulator make_empty_copy() const
+    {
+        return HessianVectorProductAccumulator(m_interaction, m_dist, m_v,
+                pele::Array<double>(m_out.size(), 0.));
+    }
+
+    /**
+     * add the results of another accumulator to this one
+     */
+    void merge(HessianVectorProductAccumulator const & other)
+    {
+        m_out += other.m_out;
+    }
 };
 
 /**
@@ -321,6 +526,27 @@ public:
  * cell list implementation in cell_lists.h.
  * This should also do the cell list construction and refresh, such that
  * the interface is the same for the user as with SimplePairwise.
+ *
+ * If skin is positive the pairs are taken from a Verlet list which contains
+ * all pairs closer than rcut + skin.  The list is built from the cell lists
+ * and only rebuilt once an atom has moved further than skin / 2.
+ *
+ * The loop over atom pairs can be split between several threads, see
+ * set_nr_threads().  Each thread accumulates into its own energy, gradient
+ * and Hessian, which are summed at the end.
+ *
+ * get_energy_change() only visits the atoms in the cells around the moved
+ * atoms.  For this to work the cell lists must be up to date with x_old.
+ * The first call after any other energy function rebuilds them.  After that
+ * they are kept up to date by moving only the atoms which were changed in the
+ * previous call, so x_old must differ from x_old of the previous call at most
+ * in the atoms moved in that call, as is the case in a Monte Carlo chain.
+ *
+ * For large systems the atoms can be renumbered internally along a Morton
+ * curve, see set_spatial_sort_interval(), such that atoms which are close in
+ * space are close in memory.  This is done for get_energy() and
+ * get_energy_gradient() only; the coordinates and the gradient are permuted
+ * on the way in and out.
  */
 template <typename pairwise_interaction, typename distance_policy>
 class CellListPotential : public BasePotential {
@@ -329,19 +555,101 @@ protected:
     pele::CellLists<distance_policy> m_cell_lists;
     std::shared_ptr<pairwise_interaction> m_interaction;
     std::shared_ptr<distance_policy> m_dist;
+    std::shared_ptr<pele::VerletLists<distance_policy> > m_verlet_lists;
+    size_t m_nr_threads;
+    bool m_cell_lists_synced; /**< for get_energy_change: the cell lists are up to date except for m_dirty_atoms */
+    std::vector<size_t> m_dirty_atoms;
+    std::vector<char> m_moved;
+    typedef IndexMappedInteraction<pairwise_interaction> sorted_interaction_t;
+    size_t m_sort_interval; /**< renumber the atoms every m_sort_interval calls, 0 for never */
+    size_t m_nr_calls_since_sort;
+    size_t m_nr_sorts;
+    pele::Array<size_t> m_order; /**< m_order[i] is the atom stored at internal position i */
+    pele::Array<double> m_x_sorted;
+    pele::Array<double> m_grad_sorted;
+    std::shared_ptr<sorted_interaction_t> m_sorted_interaction;
 public:
     ~CellListPotential() {}
     CellListPotential(
             std::shared_ptr<pairwise_interaction> interaction,
             std::shared_ptr<distance_policy> dist,
             pele::Array<double> boxvec,
-            double rcut, double ncellx_scale)
-        : m_cell_lists(dist, boxvec, rcut, ncellx_scale),
+            double rcut, double ncellx_scale,
+            double skin=0)
+        : m_cell_lists(dist, boxvec, rcut + skin, ncellx_scale),
           m_interaction(interaction),
-          m_dist(dist)
-    {}
+          m_dist(dist),
+          m_nr_threads(1),
+          m_cell_lists_synced(false),
+          m_sort_interval(0),
+          m_nr_calls_since_sort(0),
+          m_nr_sorts(0)
+    {
+        if (skin < 0) {
+            throw std::invalid_argument("CellListPotential: skin must not be negative");
+        }
+        if (skin > 0) {
+            m_verlet_lists = std::make_shared<pele::VerletLists<distance_policy> >(
+                    m_cell_lists, m_dist, rcut, skin);
+        }
+    }
     virtual size_t get_ndim(){return m_ndim;}
 
+    /**
+     * return the number of times the Verlet list has been rebuilt
+     */
+    size_t get_nr_verlet_rebuilds() const
+    {
+        if (! m_verlet_lists) {
+            return 0;
+        }
+        return m_verlet_lists->get_nr_rebuilds();
+    }
+
+    /**
+     * set the number of threads used to loop through the atom pairs
+     *
+     * Each additional thread allocates its own gradient (and Hessian) buffer,
+     * so this only pays off for large systems.
+     */
+    void set_nr_threads(size_t nr_threads)
+    {
+        if (nr_threads == 0) {
+            throw std::invalid_argument("CellListPotential: the number of threads must be positive");
+        }
+        m_nr_threads = nr_threads;
+    }
+
+    size_t get_nr_threads() const { return m_nr_threads; }
+
+    /**
+     * renumber the atoms internally along a Morton curve every sort_interval
+     * calls of get_energy() or get_energy_gradient().  0, the default,
+     * switches the renumbering off.
+     *
+     * This reduces the cache misses when scattering the gradient of large
+     * systems.  Interactions which look up per atom data, e.g. radii, still
+     * do so in the original order and gain little.
+     *
+     * The Verlet list, if used, is rebuilt when an atom index moved more
+     * than skin / 2 since the last build.  So a renumbering usually causes
+     * a rebuild, and so does a call of one of the other energy functions,
+     * which work in the original order, in between.
+     */
+    void set_spatial_sort_interval(size_t sort_interval)
+    {
+        m_sort_interval = sort_interval;
+        m_nr_calls_since_sort = 0;
+        m_order = pele::Array<size_t>();
+    }
+
+    size_t get_spatial_sort_interval() const { return m_sort_interval; }
+
+    /**
+     * return the number of times the atoms have been renumbered
+     */
+    size_t get_nr_spatial_sorts() const { return m_nr_sorts; }
+
     virtual double get_energy(Array<double> x)
     {
         const size_t natoms = x.size() / m_ndim;
@@ -349,12 +657,17 @@ public:
             throw std::runtime_error("x.size() is not divisible by the number of dimensions");
         }
 
-        refresh_iterator(x);
+        if (m_sort_interval > 0) {
+            sort_coords(x);
+            typedef EnergyAccumulator<sorted_interaction_t, distance_policy> accumulator_t;
+            accumulator_t accumulator(m_sorted_interaction, m_dist);
+            loop_through_atom_pairs(m_x_sorted, accumulator);
+            return accumulator.m_energy;
+        }
+
         typedef EnergyAccumulator<pairwise_interaction, distance_policy> accumulator_t;
         accumulator_t accumulator(m_interaction, m_dist);
-        auto looper = m_cell_lists.get_atom_pair_looper(accumulator);
-
-        looper.loop_through_atom_pairs();
+        loop_through_atom_pairs(x, accumulator);
 
         return accumulator.m_energy;
     }
@@ -369,13 +682,23 @@ public:
             throw std::invalid_argument("the gradient has the wrong size");
         }
 
-        refresh_iterator(x);
+        if (m_sort_interval > 0) {
+            sort_coords(x);
+            m_grad_sorted.assign(0.);
+            typedef EnergyGradientAccumulator<sorted_interaction_t, distance_policy> accumulator_t;
+            accumulator_t accumulator(m_sorted_interaction, m_dist, m_grad_sorted);
+            loop_through_atom_pairs(m_x_sorted, accumulator);
+            for (size_t i = 0; i < natoms; ++i) {
+                std::copy(m_grad_sorted.data() + m_ndim * i, m_grad_sorted.data() + m_ndim * (i + 1),
+                        grad.data() + m_ndim * m_order[i]);
+            }
+            return accumulator.m_energy;
+        }
+
         grad.assign(0.);
         typedef EnergyGradientAccumulator<pairwise_interaction, distance_policy> accumulator_t;
         accumulator_t accumulator(m_interaction, m_dist, grad);
-        auto looper = m_cell_lists.get_atom_pair_looper(accumulator);
-
-        looper.loop_through_atom_pairs();
+        loop_through_atom_pairs(x, accumulator);
 
         return accumulator.m_energy;
     }
@@ -394,23 +717,252 @@ public:
             throw std::invalid_argument("the Hessian has the wrong size");
         }
 
-        refresh_iterator(x);
         grad.assign(0.);
         hess.assign(0.);
         typedef EnergyGradientHessianAccumulator<pairwise_interaction, distance_policy> accumulator_t;
         accumulator_t accumulator(m_interaction, m_dist, grad, hess);
-        auto looper = m_cell_lists.get_atom_pair_looper(accumulator);
+        loop_through_atom_pairs(x, accumulator);
+
+        return accumulator.m_energy;
+    }
+
+    /**
+     * compute the energy, gradient and the Hessian as a block sparse matrix
+     * with ndim x ndim blocks.  Only the pairs within the cutoff are stored.
+     */
+    virtual double get_energy_gradient_sparse_hessian(Array<double> x,
+            Array<double> grad, BlockSparseMatrix & hess)
+    {
+        const size_t natoms = x.size() / m_ndim;
+        if (m_ndim * natoms != x.size()) {
+            throw std::runtime_error("x.size() is not divisible by the number of dimensions");
+        }
+        if (x.size() != grad.size()) {
+            throw std::invalid_argument("the gradient has the wrong size");
+        }
 
-        looper.loop_through_atom_pairs();
+        grad.assign(0.);
+        typedef EnergyGradientSparseHessianAccumulator<pairwise_interaction, distance_policy> accumulator_t;
+        accumulator_t accumulator(m_interaction, m_dist, grad);
+        loop_through_atom_pairs(x, accumulator);
+        hess = accumulator.m_hessian.assemble();
 
         return accumulator.m_energy;
     }
 
+    /**
+     * compute the product of the Hessian with v analytically from the pair loop
+     */
+    virtual void get_hessian_vector_product(Array<double> x, Array<double> v,
+            Array<double> out)
+    {
+        out.assign(0.);
+        add_hessian_vector_product(x, v, out);
+    }
+
+    virtual void add_hessian_vector_product(Array<double> x, Array<double> v,
+            Array<double> out)
+    {
+        const size_t natoms = x.size() / m_ndim;
+        if (m_ndim * natoms != x.size()) {
+            throw std::runtime_error("x.size() is not divisible by the number of dimensions");
+        }
+        if (x.size() != v.size() || x.size() != out.size()) {
+            throw std::invalid_argument("v and out must have the same size as x");
+        }
+
+        typedef HessianVectorProductAccumulator<pairwise_interaction, distance_policy> accumulator_t;
+        accumulator_t accumulator(m_interaction, m_dist, v, out);
+        loop_through_atom_pairs(x, accumulator);
+    }
+
+    /**
+     * return the energy change when the atoms in changed_atoms move.
+     *
+     * This is O(number of neighbors) per moved atom.  See the class
+     * description for the requirements on x_old.
+     */
+    virtual double get_energy_change(Array<double> x_old, Array<double> x_new,
+            Array<size_t> changed_atoms)
+    {
+        return energy_change<false>(x_old, x_new, changed_atoms, NULL);
+    }
+
+    virtual double get_energy_gradient_change(Array<double> x_old, Array<double> x_new,
+            Array<size_t> changed_atoms, Array<double> grad)
+    {
+        if (grad.size() != x_old.size()) {
+            throw std::invalid_argument("the gradient has the wrong size");
+        }
+        return energy_change<true>(x_old, x_new, changed_atoms, grad.data());
+    }
+
 protected:
     void refresh_iterator(Array<double> x)
     {
         m_cell_lists.reset(x);
     }
+
+    /**
+     * copy x into m_x_sorted in the internal order, renumbering the atoms
+     * first if it is time to
+     */
+    void sort_coords(Array<double> x)
+    {
+        const size_t natoms = x.size() / m_ndim;
+        if (m_order.size() != natoms || m_nr_calls_since_sort >= m_sort_interval) {
+            std::vector<size_t> const order = morton_order<m_ndim>(x);
+            if (m_order.size() != natoms) {
+                m_order = pele::Array<size_t>(natoms);
+                m_x_sorted = pele::Array<double>(x.size());
+                m_grad_sorted = pele::Array<double>(x.size());
+                m_sorted_interaction = std::make_shared<sorted_interaction_t>(m_interaction, m_order);
+            }
+            std::copy(order.begin(), order.end(), m_order.begin());
+            m_nr_calls_since_sort = 0;
+            ++m_nr_sorts;
+        }
+        ++m_nr_calls_since_sort;
+        for (size_t i = 0; i < natoms; ++i) {
+            std::copy(x.data() + m_ndim * m_order[i], x.data() + m_ndim * (m_order[i] + 1),
+                    m_x_sorted.data() + m_ndim * i);
+        }
+    }
+
+    /**
+     * bring the cell lists up to date with x_old
+     */
+    void sync_cell_lists(Array<double> x_old)
+    {
+        if (! m_cell_lists_synced) {
+            refresh_iterator(x_old);
+            m_cell_lists_synced = true;
+            m_dirty_atoms.clear();
+            return;
+        }
+        for (size_t const iatom : m_dirty_atoms) {
+            m_cell_lists.update_atom(iatom, x_old.data() + m_ndim * iatom);
+        }
+        m_dirty_atoms.clear();
+    }
+
+    /**
+     * subtract the old and add the new contribution of every pair with at
+     * least one moved atom.  A pair of two moved atoms is done only when the
+     * outer loop is at the atom with the smaller index.
+     */
+    template <bool with_gradient>
+    double energy_change(Array<double> x_old, Array<double> x_new,
+            Array<size_t> changed_atoms, double * grad)
+    {
+        const size_t natoms = x_old.size() / m_ndim;
+        if (m_moved.size() != natoms) {
+            m_moved.assign(natoms, 0);
+        }
+        try {
+            mark_changed_atoms(x_old, x_new, changed_atoms, m_ndim, m_moved);
+        } catch (...) {
+            m_moved.assign(natoms, 0);
+            throw;
+        }
+        sync_cell_lists(x_old);
+        m_dirty_atoms.assign(changed_atoms.begin(), changed_atoms.end());
+
+        double const * const xo = x_old.data();
+        double const * const xn = x_new.data();
+        double de = 0;
+        for (size_t const atomi : changed_atoms) {
+            // the old neighbors are found from the cell lists, which are up
+            // to date with x_old
+            auto subtract_old = [&](size_t atomj) {
+                if (atomj == atomi || (m_moved[atomj] && atomj < atomi)) {
+                    return;
+                }
+                de -= pair_energy_change<with_gradient>(*m_interaction, *m_dist,
+                        xo + m_ndim * atomi, xo + m_ndim * atomj, atomi, atomj, grad, -1.);
+            };
+            m_cell_lists.visit_atoms_near(xo + m_ndim * atomi, subtract_old);
+            // the new neighbors which did not move are in the cells around
+            // the new position.  Pairs of moved atoms are done directly,
+            // because the cell lists do not know the new positions.
+            auto add_new = [&](size_t atomj) {
+                if (atomj == atomi || m_moved[atomj]) {
+                    return;
+                }
+                de += pair_energy_change<with_gradient>(*m_interaction, *m_dist,
+                        xn + m_ndim * atomi, xn + m_ndim * atomj, atomi, atomj, grad, 1.);
+            };
+            m_cell_lists.visit_atoms_near(xn + m_ndim * atomi, add_new);
+            for (size_t const atomj : changed_atoms) {
+                if (atomj > atomi) {
+                    de += pair_energy_change<with_gradient>(*m_interaction, *m_dist,
+                            xn + m_ndim * atomi, xn + m_ndim * atomj, atomi, atomj, grad, 1.);
+                }
+            }
+        }
+        for (size_t const atomi : changed_atoms) {
+            m_moved[atomi] = 0;
+        }
+        return de;
+    }
+
+    /**
+     * pass every pair of atoms closer than the cutoff to the accumulator
+     *
+     * The pairs come from the Verlet list if one is used, otherwise
+     * directly from the cell lists.
+     */
+    template <class accumulator_t>
+    void loop_through_atom_pairs(Array<double> x, accumulator_t & accumulator)
+    {
+        m_cell_lists_synced = false;
+        if (m_verlet_lists) {
+            m_verlet_lists->reset(x);
+            loop_through_atom_pairs_threaded(accumulator,
+                    [&](accumulator_t & acc) {
+                        return m_verlet_lists->get_atom_pair_looper(acc, x);
+                    });
+        } else {
+            refresh_iterator(x);
+            loop_through_atom_pairs_threaded(accumulator,
+                    [&](accumulator_t & acc) {
+                        return m_cell_lists.get_atom_pair_looper(acc);
+                    });
+        }
+    }
+
+    /**
+     * split the work of the loopers between m_nr_threads threads
+     *
+     * Thread 0 uses the accumulator that was passed in, the others use empty
+     * copies of it which are merged into it afterwards.  This way no two
+     * threads ever write to the same memory.
+     */
+    template <class accumulator_t, class make_looper_t>
+    void loop_through_atom_pairs_threaded(accumulator_t & accumulator,
+            make_looper_t make_looper)
+    {
+        const size_t nr_work_items = make_looper(accumulator).get_nr_work_items();
+        const size_t nthreads = std::max<size_t>(1, std::min(m_nr_threads, nr_work_items));
+        if (nthreads == 1) {
+            make_looper(accumulator).loop_through_atom_pairs();
+            return;
+        }
+        std::vector<accumulator_t> thread_accumulators;
+        thread_accumulators.reserve(nthreads - 1);
+        for (size_t ithread = 1; ithread < nthreads; ++ithread) {
+            thread_accumulators.push_back(accumulator.make_empty_copy());
+        }
+        pele::parallel_for_chunks(nthreads, nr_work_items,
+                [&](size_t ithread, size_t ibegin, size_t iend) {
+                    accumulator_t & acc = (ithread == 0) ? accumulator
+                            : thread_accumulators[ithread - 1];
+                    make_looper(acc).loop_through_atom_pairs(ibegin, iend);
+                });
+        for (auto const & acc : thread_accumulators) {
+            accumulator.merge(acc);
+        }
+    }
 };
 
 } //namespace pele
@@ -4,6 +4,9 @@
 #include <iostream>
 #include <memory>
 #include <exception>
+#include <limits>
+#include <cmath>
+#include <algorithm>
 #include <cassert>
 #include <vector>
 
@@ -154,6 +157,49 @@ public:
 //        std::cout << icell << " adding atom " << m_hoc[icell].atom_index << " " << m_hoc[icell].x << std::endl;
     }
 
+    /**
+     * remove an atom from a cell
+     *
+     * The chain of the cell is walked to find the atom which points to iatom.
+     */
+    inline void remove_atom_from_cell(size_t iatom, size_t icell)
+    {
+        if (m_hoc[icell].atom_index == long(iatom)) {
+            m_hoc[icell] = m_ll[iatom];
+            return;
+        }
+        long jatom = m_hoc[icell].atom_index;
+        while (m_ll[jatom].atom_index != long(iatom)) {
+            jatom = m_ll[jatom].atom_index;
+            assert(jatom != CELL_END);
+        }
+        m_ll[jatom] = m_ll[iatom];
+    }
+
+    /**
+     * copy the current atom positions into the lists
+     *
+     * The position of an atom is stored with the entry which points to it,
+     * i.e. in m_hoc or in m_ll of the previous atom in the chain, so each
+     * chain is walked once.
+     */
+    inline void update_positions(double const * coords)
+    {
+        for (auto & head : m_hoc) {
+            long iatom = head.atom_index;
+            if (iatom == CELL_END) {
+                continue;
+            }
+            std::copy(coords + ndim * iatom, coords + ndim * (iatom + 1), head.x.begin());
+            long jatom = m_ll[iatom].atom_index;
+            while (jatom != CELL_END) {
+                std::copy(coords + ndim * jatom, coords + ndim * (jatom + 1), m_ll[iatom].x.begin());
+                iatom = jatom;
+                jatom = m_ll[iatom].atom_index;
+            }
+        }
+    }
+
     /**
      * set the size of the m_ll array
      *
@@ -213,10 +259,31 @@ public:
     {}
 
     void loop_through_atom_pairs()
+    {
+        loop_through_atom_pairs(0, get_nr_work_items());
+    }
+
+    /**
+     * return the number of independent pieces of work, i.e. the number of
+     * pairs of neighboring cells
+     */
+    size_t get_nr_work_items() const
+    {
+        return m_container.m_cell_neighbor_pairs.size();
+    }
+
+    /**
+     * loop through the atom pairs in the cell pairs [ibegin, iend)
+     *
+     * Disjoint ranges visit disjoint sets of atom pairs, so the work can be
+     * split between threads, each with its own visitor.
+     */
+    void loop_through_atom_pairs(const size_t ibegin, const size_t iend_pair)
     {
         typename CellListsContainer<ndim>::const_iterator iiter, jiter, iend, jend;
         iend = m_container.end();
-        for (auto const & ijpair : m_container.m_cell_neighbor_pairs) {
+        for (size_t ipair = ibegin; ipair < iend_pair; ++ipair) {
+            auto const & ijpair = m_container.m_cell_neighbor_pairs[ipair];
             const size_t icell = ijpair.first;
             const size_t jcell = ijpair.second;
             // do double loop through atoms, avoiding duplicate pairs
@@ -497,6 +564,15 @@ protected:
      * it also manages iterating through the pairs of atoms
      */
     container_type m_container;
+
+    /** m_atom_cell[iatom] is the cell atom iatom was put in at the last reset */
+    std::vector<size_t> m_atom_cell;
+
+    /** the number of times an atom moved to a different cell */
+    size_t m_nr_cell_changes;
+
+    /** m_neighbor_cells[icell] holds all the neighbors of icell, including icell itself */
+    std::vector<std::vector<size_t> > m_neighbor_cells;
 public:
     ~CellLists() {}
 
@@ -530,8 +606,59 @@ public:
      */
     size_t get_nr_cellsx() const { return m_lattice_tool.m_ncells_vec[0]; }
 
+    /**
+     * return the total number of times an atom moved to a different cell in reset()
+     */
+    size_t get_nr_cell_changes() const { return m_nr_cell_changes; }
+
+    /**
+     * return true once the lists have been built by reset()
+     */
+    bool is_initialised() const { return m_initialised; }
+
+    /**
+     * call visitor(jatom) for every atom in the cell of position x and in all
+     * its neighboring cells
+     *
+     * These are all the atoms which can be within rcut of x.  The cell
+     * membership is as of the last call to reset() or update_atom().
+     */
+    template <class visitor_t>
+    void visit_atoms_near(double const * const x, visitor_t & visitor) const
+    {
+        const size_t icell = m_lattice_tool.position_to_cell_index(x);
+        for (size_t const jcell : m_neighbor_cells[icell]) {
+            long jatom = m_container.m_hoc[jcell].atom_index;
+            while (jatom != CELL_END) {
+                visitor(size_t(jatom));
+                jatom = m_container.m_ll[jatom].atom_index;
+            }
+        }
+    }
+
+    /**
+     * move a single atom to the cell of position x
+     *
+     * Only the cell membership is updated, the positions stored in the lists
+     * are refreshed by the next call to reset().
+     */
+    void update_atom(const size_t iatom, double const * const x)
+    {
+        const size_t icell = m_lattice_tool.position_to_cell_index(x);
+        if (icell != m_atom_cell[iatom]) {
+            m_container.remove_atom_from_cell(iatom, m_atom_cell[iatom]);
+            m_container.add_atom_to_cell(iatom, icell, x);
+            m_atom_cell[iatom] = icell;
+            ++m_nr_cell_changes;
+        }
+    }
+
     /**
      * reset the cell list iterator with a new coordinates array
+     *
+     * The lists are built from scratch on the first call.  After that only
+     * the atoms which moved to a different cell are moved between the lists
+     * and the stored positions of all other atoms are refreshed.
      */
     void reset(pele::Array<double> coords);
 
@@ -539,6 +666,7 @@ protected:
     void setup(Array<double> coords);
     void build_cell_neighbors_list();
     void build_linked_lists();
+    void update_linked_lists();
 private:
     static Array<size_t> get_ncells_vec(const Array<double> boxv, const double rcut, const double ncellx_scale);
 };
@@ -553,7 +681,8 @@ CellLists<distance_policy>::CellLists(
     : m_natoms(0),
       m_initialised(false),
       m_lattice_tool(dist, boxv, rcut, get_ncells_vec(boxv, rcut, ncellx_scale)),
-      m_container(m_lattice_tool.m_ncells)
+      m_container(m_lattice_tool.m_ncells),
+      m_nr_cell_changes(0)
 {
     if (boxv.size() != m_ndim) {
         throw std::runtime_error("CellLists::CellLists: distance policy boxv and cell list boxv differ in size");
@@ -630,6 +759,8 @@ void CellLists<distance_policy>::reset(pele::Array<double> coords)
 {
     if (! m_initialised) {
         setup(coords);
+        build_linked_lists();
+        return;
     }
 
     m_coords.assign(coords);
@@ -648,7 +779,7 @@ void CellLists<distance_policy>::reset(pele::Array<double> coords)
 //            }
 //        }
 //    }
-    build_linked_lists();
+    update_linked_lists();
 }
 
 /**
@@ -658,6 +789,13 @@ template <typename distance_policy>
 void CellLists<distance_policy>::build_cell_neighbors_list()
 {
     m_lattice_tool.find_neighbor_pairs(m_container.m_cell_neighbor_pairs);
+    m_neighbor_cells.assign(m_lattice_tool.m_ncells, std::vector<size_t>());
+    for (auto const & ijpair : m_container.m_cell_neighbor_pairs) {
+        m_neighbor_cells[ijpair.first].push_back(ijpair.second);
+        if (ijpair.first != ijpair.second) {
+            m_neighbor_cells[ijpair.second].push_back(ijpair.first);
+        }
+    }
 }
 
 /**
@@ -667,11 +805,29 @@ template <typename distance_policy>
 void CellLists<distance_policy>::build_linked_lists()
 {
     m_container.clear();
+    m_atom_cell.resize(m_natoms);
     for(size_t iatom = 0; iatom < m_natoms; ++iatom) {
         double const * const x = m_coords.data() + m_ndim * iatom;
         size_t icell = m_lattice_tool.position_to_cell_index(x);
         m_container.add_atom_to_cell(iatom, icell, x);
+        m_atom_cell[iatom] = icell;
+    }
+}
+
+/**
+ * move the atoms which changed cell since the last call and refresh the
+ * stored positions of all atoms
+ *
+ * Close to convergence hardly any atom changes cell, so this avoids
+ * rebuilding all the chains.
+ */
+template <typename distance_policy>
+void CellLists<distance_policy>::update_linked_lists()
+{
+    for(size_t iatom = 0; iatom < m_natoms; ++iatom) {
+        update_atom(iatom, m_coords.data() + m_ndim * iatom);
     }
+    m_container.update_positions(m_coords.data());
 }
 
 } // namespace pele
@@ -0,0 +1,66 @@
+#ifndef _PELE_CG_H__
+#define _PELE_CG_H__
+
+#include <memory>
+#include "base_potential.h"
+#include "array.h"
+#include "optimizer.h"
+#include "linesearch.h"
+
+namespace pele{
+
+/**
+ * An implementation of the nonlinear conjugate gradient optimization
+ * algorithm in c++.
+ *
+ * The search directions are d = -g + beta * d_old with the Polak-Ribiere+
+ * choice
+ *
+ *     beta = max(0, dot(g, g - g_old) / dot(g_old, g_old))
+ *
+ * which restarts with steepest descent whenever beta would be negative.  The
+ * step along d is found with a More-Thuente line search which enforces the
+ * strong Wolfe conditions, see J. Nocedal and S. J. Wright, Numerical
+ * Optimization, chapter 5.2.
+ */
+class CG : public GradientOptimizer{
+private:
+    MoreThuenteLineSearch linesearch_;
+    Array<double> d_; /**< The search direction */
+    Array<double> gold_; /**< The gradient before the step */
+    Array<double> xnew_; /**< The position found by the line search */
+    Array<double> gnew_; /**< The gradient found by the line search */
+    double gd_old_; /**< dot(g, d) at the start of the previous iteration */
+    double stp_old_; /**< The step length of the previous iteration */
+    bool restart_; /**< If true, the next step is a steepest descent step */
+
+public:
+    /**
+     * Constructor
+     */
+    CG(std::shared_ptr<pele::BasePotential> potential, const pele::Array<double> x0,
+            double tol=1e-4);
+
+    /**
+     * Destructor
+     */
+    virtual ~CG() {}
+
+    /**
+     * Do one iteration iteration of the optimization algorithm
+     */
+    void one_iteration();
+
+    /**
+     * reset the optimizer to start a new minimization from x0
+     */
+    virtual void reset(pele::Array<double> &x0);
+
+    /**
+     * access the line search, e.g. to change its parameters
+     */
+    inline MoreThuenteLineSearch & get_linesearch() { return linesearch_; }
+};
+}
+
+#endif
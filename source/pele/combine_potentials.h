@@ -32,6 +32,16 @@ public:
         _potentials.push_back(potential);
     }
 
+    virtual bool can_run_concurrently() const
+    {
+        for (auto const & pot_ptr : _potentials){
+            if (! pot_ptr->can_run_concurrently()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
     virtual double get_energy(Array<double> x)
     {
         double energy = 0.;
@@ -76,6 +86,18 @@ public:
         return energy;
     }
 
+    virtual void get_hessian_vector_product(Array<double> x, Array<double> v,
+            Array<double> out)
+    {
+        if (x.size() != out.size()) {
+            throw std::invalid_argument("out has the wrong size");
+        }
+        out.assign(0.);
+        for (auto & pot_ptr : _potentials){
+            pot_ptr->add_hessian_vector_product(x, v, out);
+        }
+    }
+
 };
 }
 
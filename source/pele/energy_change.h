@@ -0,0 +1,75 @@
+#ifndef _PELE_ENERGY_CHANGE_H_
+#define _PELE_ENERGY_CHANGE_H_
+
+#include <stdexcept>
+#include <vector>
+
+#include "array.h"
+
+/*
+ * helper functions for the implementations of get_energy_change and
+ * get_energy_gradient_change of the pairwise potentials
+ */
+
+namespace pele {
+
+/**
+ * check the input of get_energy_change and set moved[i] for each atom in
+ * changed_atoms
+ *
+ * moved must have size natoms and be all zero on input.
+ */
+inline void mark_changed_atoms(Array<double> const & x_old, Array<double> const & x_new,
+        Array<size_t> const & changed_atoms, const size_t ndim, std::vector<char> & moved)
+{
+    const size_t natoms = x_old.size() / ndim;
+    if (ndim * natoms != x_old.size()) {
+        throw std::runtime_error("x is not divisible by the number of dimensions");
+    }
+    if (x_new.size() != x_old.size()) {
+        throw std::invalid_argument("x_old and x_new must have the same size");
+    }
+    for (size_t const iatom : changed_atoms) {
+        if (iatom >= natoms) {
+            throw std::invalid_argument("changed_atoms: atom index out of range");
+        }
+        if (moved[iatom]) {
+            throw std::invalid_argument("changed_atoms: duplicate atom index");
+        }
+        moved[iatom] = 1;
+    }
+}
+
+/**
+ * return the energy of the pair of atoms i and j at positions xi and xj
+ *
+ * If with_gradient is true, the gradient of the pair times sign is added to
+ * grad.
+ */
+template <bool with_gradient, class pairwise_interaction, class distance_policy>
+inline double pair_energy_change(pairwise_interaction const & interaction,
+        distance_policy const & dist, double const * const xi, double const * const xj,
+        const size_t i, const size_t j, double * const grad, const double sign)
+{
+    static const size_t ndim = distance_policy::_ndim;
+    double dr[ndim];
+    dist.get_rij(dr, xi, xj);
+    double r2 = 0;
+    for (size_t k = 0; k < ndim; ++k) {
+        r2 += dr[k] * dr[k];
+    }
+    if (! with_gradient) {
+        return interaction.energy(r2, i, j);
+    }
+    double gij;
+    const double e = interaction.energy_gradient(r2, &gij, i, j);
+    for (size_t k = 0; k < ndim; ++k) {
+        grad[ndim * i + k] -= sign * gij * dr[k];
+        grad[ndim * j + k] += sign * gij * dr[k];
+    }
+    return e;
+}
+
+} // namespace pele
+
+#endif // #ifndef _PELE_ENERGY_CHANGE_H_
@@ -9,21 +9,24 @@
  *     * iteration over out edges
  *     * iteration over in edges
  *     * return the edge u->v
- *     * access node property `double `
+ *     * access node property `double tau`
  *     * access edge property `double P`
  *     * allow for loop edges u->u
  *     * copy graph
  *
- * The requirement for fast removing of nodes means I can't assign each node
- * an index and use std::vector's.  This is at odds with fast access to the edge u->v.
- * The solution here is to use a std::map Node.successor_edge_
+ * The storage is flat so that it stays compact for networks with millions of
+ * nodes and edges.  Nodes are dense indices into std::vector's and a removed
+ * node simply leaves an empty slot.  The edges live in a single pool and are
+ * referred to by their index in the pool.  The slots of removed edges are
+ * recycled by later calls to add_edge.  Each node keeps its out edges sorted
+ * by the head node, so the edge u->v is found by a binary search, and its in
+ * edges in an unsorted vector.  Copying a graph is a copy of a few vectors.
  */
 
 #include <cstdlib>
 #include <iostream>
-#include <list>
-#include <map>
-#include <set>
+#include <vector>
+#include <algorithm>
 #include <assert.h>
 #include <stdexcept>
 #include <memory>
@@ -31,284 +34,306 @@
 
 namespace pele
 {
-class Edge;
-class Node;
 typedef size_t node_id;
-typedef Node * node_ptr;
-typedef Edge * edge_ptr;
-typedef int color_type;
-color_type color_white = 0;
-color_type color_grey = 1;
-color_type color_black = 4;
+typedef size_t edge_id;
 
 /**
- * basic class for an edge (arc) in the graph
+ * returned by Graph::get_edge if the edge does not exist
  */
-class Edge{
-public:
-    node_ptr head_; // node the edge points to
-    node_ptr tail_; // node the edge comes from
-    double P;
-
-    Edge(node_ptr tail, node_ptr head):
-        head_(head),
-        tail_(tail)
-    {}
-
-    node_ptr head(){ return head_; }
-    node_ptr tail(){ return tail_; }
-};
-
-/**
- * basic class for a node in the graph
- */
-class Node{
-public:
-    typedef std::set<edge_ptr> edge_list;
-    typedef typename edge_list::iterator edge_iterator;
-    typedef std::map<node_ptr, edge_ptr> successor_map_t;
-private:
-    node_id id_;
-    edge_list out_edge_list_; // list of outgoing edges
-    edge_list in_edge_list_; // list of outgoing edges
-
+const edge_id NO_EDGE = static_cast<edge_id>(-1);
 
+class Graph
+{
 public:
-    successor_map_t successor_map_;
-    double tau;
-
-    Node(node_id id):
-        id_(id)
-    {}
-
-    void add_out_edge(edge_ptr edge){
-        out_edge_list_.insert(edge);
-        successor_map_[edge->head()] = edge;
-    }
-    void remove_out_edge(edge_ptr edge){
-        out_edge_list_.erase(edge);
-        successor_map_.erase(edge->head());
-    }
-    edge_list & get_out_edges(){ return out_edge_list_; }
-    edge_iterator out_edge_begin(){ return out_edge_list_.begin(); }
-    edge_iterator out_edge_end(){ return out_edge_list_.end(); }
-
-    void add_in_edge(edge_ptr edge){ in_edge_list_.insert(edge); }
-    void remove_in_edge(edge_ptr edge){ in_edge_list_.erase(edge); }
-    edge_list & get_in_edges(){ return in_edge_list_; }
-    edge_iterator in_edge_begin(){ return in_edge_list_.begin(); }
-    edge_iterator in_edge_end(){ return in_edge_list_.end(); }
-
-    node_id id() const { return id_; }
-    size_t out_degree() const { return out_edge_list_.size(); }
-    size_t in_degree() const { return in_edge_list_.size(); }
-    size_t in_out_degree() const { return out_degree() + in_degree(); }
-    std::set<node_ptr> in_out_neighbors();
+    /**
+     * basic class for an edge (arc) in the graph
+     */
+    struct Edge {
+        node_id tail; // node the edge comes from
+        node_id head; // node the edge points to
+        double P;
+    };
 
-    /*
-     * return the edge u->v
+    /**
+     * entry in the list of out edges of a node
      */
-    edge_ptr get_successor_edge(node_ptr v){
-        successor_map_t::iterator miter = successor_map_.find(v);
-        if (miter == successor_map_.end()){
-            return NULL;
-        } else{
-            return miter->second;
-        }
-    }
-};
+    struct OutEdge {
+        node_id head;
+        edge_id edge;
+    };
+    typedef std::vector<OutEdge> out_edge_list;
+    typedef std::vector<edge_id> in_edge_list;
 
-std::set<node_ptr> Node::in_out_neighbors() {
-    std::set<node_ptr> neibs;
-    Node::edge_iterator eiter;
-    for (eiter = out_edge_begin(); eiter != out_edge_end(); eiter++){
-        neibs.insert((*eiter)->head());
+private:
+    struct Node {
+        out_edge_list out_edges; // sorted by head
+        in_edge_list in_edges;
+        double tau;
+        bool exists;
+        Node() : tau(0), exists(false) {}
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Edge> m_edges;
+    std::vector<edge_id> m_free_edges; // slots in m_edges that can be reused
+    size_t m_number_of_nodes;
+
+    static bool compare_head(OutEdge const & e, node_id v) { return e.head < v; }
+
+    Node & node(node_id u)
+    {
+        assert(has_node(u));
+        return m_nodes[u];
     }
-    for (eiter = in_edge_begin(); eiter != in_edge_end(); eiter++){
-        neibs.insert((*eiter)->tail());
+    Node const & node(node_id u) const
+    {
+        assert(has_node(u));
+        return m_nodes[u];
     }
-    return neibs;
-}
 
-
-class Graph
-{
 public:
-    typedef std::map<node_id, node_ptr> node_map_t;
-    node_map_t node_map_;
-    typedef std::set<edge_ptr> edge_list_t;
-    edge_list_t edge_list_;
-
-    node_id next_node_id_;
-
-    Graph():
-        next_node_id_(0)
+    Graph()
+        : m_number_of_nodes(0)
     {}
 
-    ~Graph()
-    {
-        // delete all nodes
-        for (auto const & mapval : node_map_){
-            node_ptr node = mapval.second;
-            delete node;
-        }
-        // delete all edges
-        for (auto edge : edge_list_){
-            delete edge;
-        }
-    }
+    size_t number_of_nodes() const { return m_number_of_nodes; }
+    size_t number_of_edges() const { return m_edges.size() - m_free_edges.size(); }
+
+    /**
+     * one more than the largest node id that was ever added.  All node ids
+     * are smaller than this.
+     */
+    node_id node_id_bound() const { return m_nodes.size(); }
 
-    size_t number_of_nodes() const { return node_map_.size(); }
-    size_t number_of_edges() const { return edge_list_.size(); }
+    bool has_node(node_id u) const { return u < m_nodes.size() && m_nodes[u].exists; }
 
     /**
      * create a new node
      */
-    node_ptr add_node(){
-        node_ptr node = new Node(next_node_id_);
-        next_node_id_++;
-        node_map_.insert(std::pair<node_id, node_ptr> (node->id(), node));
-        return node;
+    node_id add_node()
+    {
+        return add_node(m_nodes.size());
     }
 
-    node_ptr add_node(node_id nodeid){
-        node_ptr node = NULL;
-        try {
-            node = node_map_.at(nodeid);
-            return node;
-        } catch (std::out_of_range & e) {
-            node = new Node(nodeid);
+    /**
+     * create the node with the given id if it does not exist yet
+     */
+    node_id add_node(node_id u)
+    {
+        if (u >= m_nodes.size()) {
+            m_nodes.resize(u + 1);
         }
-
-        if (next_node_id_ < nodeid){
-            next_node_id_ = nodeid + 1;
+        if (! m_nodes[u].exists) {
+            m_nodes[u].exists = true;
+            ++m_number_of_nodes;
         }
-        node_map_[node->id()] = node;
-        return node;
+        return u;
     }
 
-
     /**
      * create a n new nodes
      */
-    void add_nodes(node_id n){
-        for (node_id i = 0; i < n; ++i){
+    void add_nodes(node_id n)
+    {
+        for (node_id i = 0; i < n; ++i) {
             add_node();
         }
     }
 
     /**
-     * return a pointer to the node with given node id
+     * reserve space for nodes with id smaller than n
      */
-    node_ptr get_node(node_id nodeid)
+    void reserve_nodes(size_t n) { m_nodes.reserve(n); }
+
+    /**
+     * reserve space for n edges
+     */
+    void reserve_edges(size_t n) { m_edges.reserve(n); }
+
+    /**
+     * return the edge tail->head or NO_EDGE if it doesn't exist
+     */
+    edge_id get_edge(node_id tail, node_id head) const
     {
-        typedef std::map<node_id, node_ptr> maptype;
-        maptype::iterator iter = node_map_.find(nodeid);
-        if (iter == node_map_.end()){
-            return NULL;
+        out_edge_list const & out = node(tail).out_edges;
+        auto iter = std::lower_bound(out.begin(), out.end(), head, compare_head);
+        if (iter == out.end() || iter->head != head) {
+            return NO_EDGE;
         }
-        return iter->second;
-        return NULL;
+        return iter->edge;
     }
 
     /**
-     * add an edge from tail to head
+     * add an edge from tail to head and return it.  If the edge already
+     * exists it is returned unchanged.  A new edge has P = 0.
      */
-    edge_ptr add_edge(node_id tail, node_id head)
+    edge_id add_edge(node_id tail, node_id head)
     {
-        return _add_edge(get_node(tail), get_node(head));
-    }
-    edge_ptr _add_edge(node_ptr node_tail, node_ptr node_head)
-    {
-        assert(node_tail != NULL);
-        assert(node_head != NULL);
-        // check whether they're already connected
-        edge_ptr edge = node_tail->get_successor_edge(node_head);
-        if (edge != NULL){
-            return edge;
+        assert(has_node(tail));
+        assert(has_node(head));
+        out_edge_list & out = m_nodes[tail].out_edges;
+        auto iter = std::lower_bound(out.begin(), out.end(), head, compare_head);
+        if (iter != out.end() && iter->head == head) {
+            return iter->edge;
+        }
+        edge_id e;
+        if (m_free_edges.empty()) {
+            e = m_edges.size();
+            m_edges.push_back(Edge());
+        } else {
+            e = m_free_edges.back();
+            m_free_edges.pop_back();
         }
-        edge = new Edge(node_tail, node_head);
-        edge_list_.insert(edge);
-        node_tail->add_out_edge(edge);
-        node_head->add_in_edge(edge);
-        return edge;
+        m_edges[e].tail = tail;
+        m_edges[e].head = head;
+        m_edges[e].P = 0;
+        OutEdge entry = {head, e};
+        out.insert(iter, entry);
+        m_nodes[head].in_edges.push_back(e);
+        return e;
     }
 
     /**
      * remove a node and all edges connecting it
      */
-    void remove_node(node_id nodeid){
-        return _remove_node(get_node(nodeid));
-    }
-
-    void _remove_node(node_ptr u)
+    void remove_node(node_id u)
     {
-        Node::edge_iterator eiter;
+        Node & nu = node(u);
 
         // remove the edges from the nodes connected to u
-        for (eiter = u->out_edge_begin(); eiter != u->out_edge_end(); ++eiter){
-            edge_ptr edge = *eiter;
-            edge->head()->remove_in_edge(edge);
+        for (OutEdge const & uv : nu.out_edges) {
+            if (uv.head != u) {
+                in_edge_list & in = m_nodes[uv.head].in_edges;
+                auto iter = std::find(in.begin(), in.end(), uv.edge);
+                assert(iter != in.end());
+                *iter = in.back();
+                in.pop_back();
+            }
+            m_free_edges.push_back(uv.edge);
         }
-        for (eiter = u->in_edge_begin(); eiter != u->in_edge_end(); ++eiter){
-            edge_ptr edge = *eiter;
-            edge->tail()->remove_out_edge(edge);
+        for (edge_id wu : nu.in_edges) {
+            node_id w = m_edges[wu].tail;
+            if (w != u) {
+                out_edge_list & out = m_nodes[w].out_edges;
+                auto iter = std::lower_bound(out.begin(), out.end(), u, compare_head);
+                assert(iter != out.end() && iter->head == u);
+                out.erase(iter);
+                m_free_edges.push_back(wu);
+            }
         }
 
-        Node::edge_list to_delete;
-        to_delete.insert(u->in_edge_begin(), u->in_edge_end());
-        to_delete.insert(u->out_edge_begin(), u->out_edge_end());
+        // release the memory of the edge lists
+        out_edge_list().swap(nu.out_edges);
+        in_edge_list().swap(nu.in_edges);
+        nu.exists = false;
+        --m_number_of_nodes;
+    }
 
-        // remove the edges from the edge list
-        for (auto edge : to_delete){
-            edge_list_.erase(edge);
-        }
+    /*
+     * accessors for the node and edge properties
+     */
+    double get_tau(node_id u) const { return node(u).tau; }
+    void set_tau(node_id u, double tau) { node(u).tau = tau; }
+    double get_P(edge_id e) const { return m_edges[e].P; }
+    void set_P(edge_id e, double P) { m_edges[e].P = P; }
+    node_id tail(edge_id e) const { return m_edges[e].tail; }
+    node_id head(edge_id e) const { return m_edges[e].head; }
+
+    out_edge_list const & out_edges(node_id u) const { return node(u).out_edges; }
+    in_edge_list const & in_edges(node_id u) const { return node(u).in_edges; }
 
-        // remove the node from the node list
-        node_map_.erase(u->id());
+    size_t out_degree(node_id u) const { return node(u).out_edges.size(); }
+    size_t in_degree(node_id u) const { return node(u).in_edges.size(); }
+    size_t in_out_degree(node_id u) const { return out_degree(u) + in_degree(u); }
 
-        // deallocate the memory
-        for (auto edge : to_delete){
-            delete edge;
+    /**
+     * return the ids of all nodes in increasing order
+     */
+    std::vector<node_id> nodes() const
+    {
+        std::vector<node_id> ids;
+        ids.reserve(m_number_of_nodes);
+        for (node_id u = 0; u < m_nodes.size(); ++u) {
+            if (m_nodes[u].exists) {
+                ids.push_back(u);
+            }
         }
+        return ids;
+    }
 
-        delete u;
+    /**
+     * return a copy of the graph in which the nodes are numbered 0 ... n-1
+     * in the order of their ids, with n = number_of_nodes().  ids is set to
+     * the old id of each node of the copy.
+     *
+     * The copy only needs memory for the nodes that exist, so copying it is
+     * cheap even if most nodes of this graph were removed.
+     */
+    Graph compacted(std::vector<node_id> & ids) const
+    {
+        ids = nodes();
+        return renumbered(ids, ids.size(), [&ids](node_id u) {
+            return static_cast<node_id>(std::lower_bound(ids.begin(), ids.end(), u) - ids.begin());
+        });
     }
 
-    /*
-     * copy constructor
+    /**
+     * the inverse of compacted: return a copy of the graph in which node u is
+     * renamed ids[u].  ids must be increasing and smaller than bound, which
+     * is the node_id_bound() of the copy.
      */
-    Graph(Graph & graph):
-        next_node_id_(0)
+    Graph expanded(std::vector<node_id> const & ids, node_id bound) const
     {
-        for (auto const & mapval : graph.node_map_){
-            node_ptr u = mapval.second;
-//            std::cout << "making node " << u->id() << "\n";
-            node_ptr unew = this->add_node(u->id());
-            unew->tau = u->tau;
-        }
+        assert(ids.empty() || ids.back() < bound);
+        return renumbered(nodes(), bound, [&ids](node_id u) { return ids[u]; });
+    }
 
-        for (auto eiter = graph.edge_list_.begin(); eiter != graph.edge_list_.end(); ++eiter){
-            edge_ptr edge = *eiter;
-            node_id uid = edge->tail()->id();
-            node_id vid = edge->head()->id();
-            edge_ptr edge_new = this->add_edge(uid, vid);
-            edge_new->P = edge->P;
+private:
+    /**
+     * return a copy of the graph with node u renamed new_id(u) for the nodes
+     * in old_ids.  new_id must be increasing, so that the out edges stay
+     * sorted by head.
+     */
+    template <class NewId>
+    Graph renumbered(std::vector<node_id> const & old_ids, node_id bound, NewId new_id) const
+    {
+        Graph g;
+        g.m_nodes.resize(bound);
+        g.m_edges.reserve(number_of_edges());
+        g.m_number_of_nodes = old_ids.size();
+        for (node_id u : old_ids) {
+            g.m_nodes[new_id(u)].exists = true;
+        }
+        for (node_id u : old_ids) {
+            Node const & nu = m_nodes[u];
+            node_id tail = new_id(u);
+            Node & ntail = g.m_nodes[tail];
+            ntail.tau = nu.tau;
+            ntail.out_edges.reserve(nu.out_edges.size());
+            for (OutEdge const & uv : nu.out_edges) {
+                Edge e = {tail, new_id(uv.head), m_edges[uv.edge].P};
+                OutEdge entry = {e.head, g.m_edges.size()};
+                g.m_edges.push_back(e);
+                ntail.out_edges.push_back(entry);
+                g.m_nodes[e.head].in_edges.push_back(entry.edge);
+            }
         }
+        return g;
     }
-
 };
 
 inline std::ostream &operator<<(std::ostream &out, std::shared_ptr<Graph> g) {
     out << "nodes\n";
     out << "-----\n";
-    for (auto const & nn : g->node_map_) {
-        out << nn.first << " tau " << nn.second->tau << "\n";
+    for (node_id u : g->nodes()) {
+        out << u << " tau " << g->get_tau(u) << "\n";
     }
     out << "edges\n";
     out << "-----\n";
-    for (auto const & e : g->edge_list_) {
-        out << e->tail_->id() << " -> " << e->head_->id() << " P " << e->P << "\n";
+    for (node_id u : g->nodes()) {
+        for (auto const & uv : g->out_edges(u)) {
+            out << u << " -> " << uv.head << " P " << g->get_P(uv.edge) << "\n";
+        }
     }
     return out;
 }
@@ -0,0 +1,492 @@
+#ifndef _PELE_INCREMENTAL_NGT_HPP_
+#define _PELE_INCREMENTAL_NGT_HPP_
+/*
+ * Rates from the New Graph Transformation method (NGT) for a transition
+ * network that grows, e.g. while a double ended connect run adds transition
+ * states to the database.
+ *
+ * The rate A->B follows from the reduced graph in which all intermediates
+ * are removed.  Removing a node x only changes the rows (tau and out edges)
+ * of the nodes that remain.  The row of a remaining node u is linear in the
+ * original row of u, (k_u. , 1) / K_u with K_u the sum of the out rates of u.
+ * So, as long as u and v are still in the graph, a new rate k_uv is taken
+ * into account exactly by scaling the reduced row of u by K_u / (K_u + k_uv)
+ * and adding k_uv / (K_u + k_uv) to P_uv.
+ *
+ * IncrementalNGT keeps such a partially reduced graph.  The nodes that
+ * received new rates in the last few batches are kept in the graph, the
+ * others are removed for good.  A query copies the partially reduced graph
+ * and removes only the remaining intermediates.
+ *
+ * A new rate can also touch a node x that was removed for good, e.g. a new
+ * transition state of an old minimum.  The removal of x is then undone.  For
+ * this the row of x and its in edges are stored when x is removed, and the
+ * changes to its neighbors are subtracted again.  The nodes that were
+ * removed after x next to it depend on the removal of x, so they are put
+ * back first, in reverse order.  All other removals stay in effect.  The
+ * nodes that were put back are removed again by the next compute_rates.
+ *
+ * If most removals depend on x it is cheaper to rebuild the graph from all
+ * rates.  This happens when the network grew in a line, so that each batch
+ * of removals depends on the previous one.  The rebuilt graph is then
+ * reduced in the elimination order all at once, after which far fewer
+ * removals depend on each other.
+ *
+ * The partially reduced graph only holds the nodes that were not removed for
+ * good, numbered 0 ... n-1 in the order of their ids.  So a batch costs as
+ * much as the part of the network that is still in the graph, not as much as
+ * the whole network.
+ */
+
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <iterator>
+#include <assert.h>
+
+#include "graph.hpp"
+#include "ngt.hpp"
+
+namespace pele
+{
+
+class IncrementalNGT {
+public:
+    typedef NGT::rate_map_t rate_map_t;
+
+private:
+    /*
+     * node x just before it was removed for good.  The in edges are stored
+     * as rates K_u P_ux, because the row of u is scaled when u gets new rates.
+     */
+    struct Elimination {
+        size_t step; // the number of the removal, 0 if x is in the graph
+        double tau;
+        double omPxx;
+        std::vector<std::pair<node_id, double> > out_edges; // v and P_xv, including the loop x->x
+        std::vector<std::pair<node_id, double> > in_rates; // u and K_u P_ux for u != x
+        Elimination() : step(0), tau(0), omPxx(0) {}
+    };
+
+    rate_map_t _rates; // the sum of all rate constants passed so far
+    std::vector<node_id> _A;
+    std::vector<node_id> _B;
+    std::shared_ptr<Graph> _graph; // the partially reduced graph, node i is _ids[i]
+    std::vector<node_id> _ids; // increasing
+    std::vector<double> _sum_out_rates; // K_u for each node
+    std::vector<Elimination> _eliminations; // the nodes that were removed for good
+    size_t _number_of_removed_nodes;
+    size_t _step;
+    std::vector<size_t> _last_batch; // the last batch in which each node got new rates
+    size_t _batch;
+    size_t _keep_batches;
+    size_t _nr_threads;
+    NGT::elimination_order_t _order;
+    std::map<node_id, double> _weights;
+    std::shared_ptr<NGT> _result; // the reduction of the last call to compute_rates
+    size_t _number_of_restored_nodes;
+    size_t _number_of_rebuilds;
+
+public:
+    /*
+     * construct from the initial rate constants.  A and B must be nodes of
+     * the network when compute_rates is called.
+     */
+    template<class Acontainer, class Bcontainer>
+    IncrementalNGT(rate_map_t const &rate_constants, Acontainer const &A, Bcontainer const &B) :
+        _rates(rate_constants),
+        _A(A.begin(), A.end()),
+        _B(B.begin(), B.end()),
+        _number_of_removed_nodes(0),
+        _step(0),
+        _batch(0),
+        _keep_batches(1),
+        _nr_threads(1),
+        _order(NGT::MIN_DEGREE),
+        _number_of_restored_nodes(0),
+        _number_of_rebuilds(0)
+    {
+        std::sort(_A.begin(), _A.end());
+        _A.erase(std::unique(_A.begin(), _A.end()), _A.end());
+        std::sort(_B.begin(), _B.end());
+        _B.erase(std::unique(_B.begin(), _B.end()), _B.end());
+        _build_graph();
+    }
+
+    void set_node_occupation_probabilities(std::map<node_id, double> &Peq){
+        _weights.insert(Peq.begin(), Peq.end());
+        _result.reset();
+    }
+    void set_nr_threads(size_t nr_threads){
+        if (nr_threads == 0){
+            throw std::invalid_argument("the number of threads must be positive");
+        }
+        _nr_threads = nr_threads;
+    }
+    void set_elimination_order(NGT::elimination_order_t order) { _order = order; }
+
+    /*
+     * The intermediates that got new rates in the last keep_batches calls of
+     * add_rates stay in the partially reduced graph.  The others are removed
+     * for good by compute_rates.  With 0 all intermediates are removed.
+     */
+    void set_keep_batches(size_t keep_batches) { _keep_batches = keep_batches; }
+
+    /*
+     * the number of nodes that were put back into the graph because a new
+     * rate touched them or a node they depend on after they were removed
+     */
+    size_t get_number_of_restored_nodes() const { return _number_of_restored_nodes; }
+
+    /*
+     * the number of times the graph was rebuilt because most removals
+     * depended on a node that got new rates
+     */
+    size_t get_number_of_rebuilds() const { return _number_of_rebuilds; }
+
+    /*
+     * the number of nodes in the partially reduced graph
+     */
+    size_t get_number_of_nodes() const { return _graph->number_of_nodes(); }
+
+    /*
+     * add a batch of rate constants.  Rates for pairs of nodes that are
+     * already connected are added to the existing rate.
+     */
+    void add_rates(rate_map_t const &rate_constants){
+        ++_batch;
+        _result.reset();
+        std::vector<node_id> removed;
+        for (auto const & mapval : rate_constants){
+            node_id u = mapval.first.first;
+            node_id v = mapval.first.second;
+            _rates[mapval.first] += mapval.second;
+            _resize(std::max(u, v) + 1);
+            _last_batch[u] = _batch;
+            _last_batch[v] = _batch;
+            if (_eliminations[u].step){
+                removed.push_back(u);
+            }
+            if (_eliminations[v].step){
+                removed.push_back(v);
+            }
+        }
+        std::vector<node_id> order;
+        if (! _nodes_to_restore(removed, order)){
+            ++_number_of_rebuilds;
+            _build_graph();
+            return;
+        }
+        std::vector<node_id> nodes(order);
+        for (auto const & mapval : rate_constants){
+            nodes.push_back(mapval.first.first);
+            nodes.push_back(mapval.first.second);
+        }
+        _make_room(nodes);
+
+        // undo the removals in reverse order
+        for (node_id x : order){
+            _restore_node(x);
+        }
+        _number_of_restored_nodes += order.size();
+        _number_of_removed_nodes -= order.size();
+
+        // add the new nodes with a loop edge, as in the NGT constructor
+        for (auto const & mapval : rate_constants){
+            _add_node(mapval.first.first);
+            _add_node(mapval.first.second);
+        }
+
+        // the rates are sorted by the tail node, so each row is one range
+        auto iter = rate_constants.begin();
+        while (iter != rate_constants.end()){
+            node_id u = iter->first.first;
+            auto row_end = iter;
+            double new_rates = 0.;
+            while (row_end != rate_constants.end() && row_end->first.first == u){
+                new_rates += row_end->second;
+                ++row_end;
+            }
+            _add_row(u, iter, row_end, new_rates);
+            iter = row_end;
+        }
+    }
+
+    /*
+     * compute the rates A->B and B->A
+     */
+    void compute_rates(){
+        // remove the intermediates that didn't get new rates recently for good
+        NGT reducer(_graph, _local_group(_A), _local_group(_B));
+        reducer.set_elimination_order(_order);
+        reducer.set_nr_threads(_nr_threads);
+        reducer.set_removal_callback([this, &reducer](node_id x){ _record_elimination(reducer, x); });
+        std::vector<node_id> stale;
+        for (node_id u : reducer.intermediates){
+            if (_last_batch[_ids[u]] + _keep_batches <= _batch){
+                stale.push_back(u);
+            }
+        }
+        reducer.intermediates.swap(stale);
+        reducer.remove_intermediates();
+
+        // renumber the nodes that are left
+        std::vector<node_id> kept;
+        _graph = std::make_shared<Graph>(_graph->compacted(kept));
+        for (node_id & u : kept){
+            u = _ids[u];
+        }
+        _ids.swap(kept);
+
+        // remove the remaining intermediates from a copy
+        auto graph = std::make_shared<Graph>(*_graph);
+        _result = std::make_shared<NGT>(graph, _local_group(_A), _local_group(_B));
+        _result->set_elimination_order(_order);
+        _result->set_nr_threads(_nr_threads);
+        if (! _weights.empty()){
+            std::map<node_id, double> weights;
+            for (node_id i = 0; i < _ids.size(); ++i){
+                auto iter = _weights.find(_ids[i]);
+                if (iter != _weights.end()){
+                    weights[i] = iter->second;
+                }
+            }
+            _result->set_node_occupation_probabilities(weights);
+        }
+        for (node_id u : _A){
+            _result->initial_tau[_local(u)] = 1. / _sum_out_rates[u];
+        }
+        for (node_id u : _B){
+            _result->initial_tau[_local(u)] = 1. / _sum_out_rates[u];
+        }
+        _result->compute_rates();
+    }
+
+    double get_rate_AB(){ return result().get_rate_AB(); }
+    double get_rate_BA(){ return result().get_rate_BA(); }
+    double get_rate_AB_SS(){ return result().get_rate_AB_SS(); }
+    double get_rate_BA_SS(){ return result().get_rate_BA_SS(); }
+
+private:
+    NGT & result(){
+        if (! _result){
+            throw std::runtime_error("IncrementalNGT: compute_rates must be called after adding rates");
+        }
+        return *_result;
+    }
+
+    void _resize(size_t n){
+        if (n > _eliminations.size()){
+            _sum_out_rates.resize(n, 0.);
+            _eliminations.resize(n);
+            _last_batch.resize(n, 0);
+        }
+    }
+
+    /*
+     * build the graph from all rate constants.  No node is removed yet.
+     */
+    void _build_graph(){
+        NGT ngt(_rates, std::list<node_id>(), std::list<node_id>());
+        _graph = std::make_shared<Graph>(ngt._graph->compacted(_ids));
+        _resize(ngt._graph->node_id_bound());
+        std::fill(_sum_out_rates.begin(), _sum_out_rates.end(), 0.);
+        std::fill(_eliminations.begin(), _eliminations.end(), Elimination());
+        _number_of_removed_nodes = 0;
+        for (auto const & mapval : _rates){
+            _sum_out_rates[mapval.first.first] += mapval.second;
+        }
+    }
+
+    /*
+     * the position of node u in _graph
+     */
+    node_id _local(node_id u) const {
+        auto iter = std::lower_bound(_ids.begin(), _ids.end(), u);
+        assert(iter != _ids.end() && *iter == u);
+        return iter - _ids.begin();
+    }
+
+    std::vector<node_id> _local_group(std::vector<node_id> const & group) const {
+        std::vector<node_id> local;
+        for (node_id u : group){
+            auto iter = std::lower_bound(_ids.begin(), _ids.end(), u);
+            if (iter == _ids.end() || *iter != u){
+                throw std::invalid_argument("IncrementalNGT: a node in A or B is not in the graph");
+            }
+            local.push_back(iter - _ids.begin());
+        }
+        return local;
+    }
+
+    /*
+     * renumber _graph so that there is a free position for each node in
+     * nodes that is not in the graph yet.  The nodes are not added.
+     */
+    void _make_room(std::vector<node_id> nodes){
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        std::vector<node_id> missing;
+        std::set_difference(nodes.begin(), nodes.end(), _ids.begin(), _ids.end(),
+                std::back_inserter(missing));
+        if (missing.empty()){
+            return;
+        }
+        std::vector<node_id> ids;
+        ids.reserve(_ids.size() + missing.size());
+        std::merge(_ids.begin(), _ids.end(), missing.begin(), missing.end(),
+                std::back_inserter(ids));
+        std::vector<node_id> positions;
+        positions.reserve(_ids.size());
+        size_t i = 0;
+        for (node_id u : _ids){
+            while (ids[i] != u){
+                ++i;
+            }
+            positions.push_back(i);
+        }
+        _graph = std::make_shared<Graph>(_graph->expanded(positions, ids.size()));
+        _ids.swap(ids);
+    }
+
+    /*
+     * store the row and the in edges of the node at position x, which is
+     * about to be removed by reducer
+     */
+    void _record_elimination(NGT & reducer, node_id x){
+        Elimination & e = _eliminations[_ids[x]];
+        e.step = ++_step;
+        ++_number_of_removed_nodes;
+        e.tau = _graph->get_tau(x);
+        e.omPxx = reducer.get_node_one_minus_P(x);
+        e.out_edges.clear();
+        for (auto const & xv : _graph->out_edges(x)){
+            e.out_edges.push_back(std::make_pair(_ids[xv.head], _graph->get_P(xv.edge)));
+        }
+        e.in_rates.clear();
+        for (edge_id ux : _graph->in_edges(x)){
+            node_id u = _graph->tail(ux);
+            if (u != x){
+                e.in_rates.push_back(std::make_pair(_ids[u], _sum_out_rates[_ids[u]] * _graph->get_P(ux)));
+            }
+        }
+    }
+
+    /*
+     * set order to the removed nodes in removed together with the nodes that
+     * were removed after them and depend on them, in the reverse order of
+     * their removal.  Return false if that is more than half of the removed
+     * nodes.
+     */
+    bool _nodes_to_restore(std::vector<node_id> const & removed, std::vector<node_id> & order){
+        order.clear();
+        if (removed.empty()){
+            return true;
+        }
+        // a node that was removed after x and was a neighbor of x at that
+        // time was changed by the removal of x
+        std::set<node_id> to_restore;
+        std::vector<node_id> stack(removed);
+        while (! stack.empty()){
+            node_id x = stack.back();
+            stack.pop_back();
+            if (! to_restore.insert(x).second){
+                continue;
+            }
+            if (2 * to_restore.size() > _number_of_removed_nodes){
+                return false;
+            }
+            Elimination const & e = _eliminations[x];
+            for (auto const & xv : e.out_edges){
+                if (_eliminations[xv.first].step > e.step){
+                    stack.push_back(xv.first);
+                }
+            }
+            for (auto const & ux : e.in_rates){
+                if (_eliminations[ux.first].step > e.step){
+                    stack.push_back(ux.first);
+                }
+            }
+        }
+
+        order.assign(to_restore.begin(), to_restore.end());
+        std::sort(order.begin(), order.end(), [this](node_id x, node_id y){
+            return _eliminations[x].step > _eliminations[y].step;
+        });
+        return true;
+    }
+
+    /*
+     * undo the removal of x.  There must be room for x in the graph, see
+     * _make_room, and its neighbors at the time of its removal must be in
+     * the graph.
+     */
+    void _restore_node(node_id x){
+        Elimination & e = _eliminations[x];
+        node_id lx = _local(x);
+        _graph->add_node(lx);
+        _graph->set_tau(lx, e.tau);
+        for (auto const & xv : e.out_edges){
+            _graph->set_P(_graph->add_edge(lx, _local(xv.first)), xv.second);
+        }
+        // subtract what NGT::remove_node added to the in neighbors
+        for (auto const & ux : e.in_rates){
+            node_id u = _local(ux.first);
+            double Pux = ux.second / _sum_out_rates[ux.first];
+            _graph->set_tau(u, _graph->get_tau(u) - Pux * e.tau / e.omPxx);
+            for (auto const & xv : e.out_edges){
+                if (xv.first == x) continue;
+                edge_id uv = _graph->add_edge(u, _local(xv.first));
+                _graph->set_P(uv, _graph->get_P(uv) - Pux * xv.second / e.omPxx);
+            }
+            _graph->set_P(_graph->add_edge(u, lx), Pux);
+        }
+        e = Elimination();
+    }
+
+    void _add_node(node_id u){
+        node_id lu = _local(u);
+        if (! _graph->has_node(lu)){
+            _graph->add_node(lu);
+            _graph->set_tau(lu, 0.);
+            _graph->set_P(_graph->add_edge(lu, lu), 0.);
+        }
+    }
+
+    /*
+     * add the new out rates [begin, end) of node u, which sum to new_rates
+     */
+    template<class iterator>
+    void _add_row(node_id u, iterator begin, iterator end, double new_rates){
+        double K_old = _sum_out_rates[u];
+        double K_new = K_old + new_rates;
+        if (K_new <= 0.){
+            return;
+        }
+        node_id lu = _local(u);
+        if (K_old > 0.){
+            // scale the reduced row of u
+            double scale = K_old / K_new;
+            _graph->set_tau(lu, scale * _graph->get_tau(lu));
+            for (auto const & uv : _graph->out_edges(lu)){
+                _graph->set_P(uv.edge, scale * _graph->get_P(uv.edge));
+            }
+        } else {
+            _graph->set_tau(lu, 1. / K_new);
+        }
+        for (auto iter = begin; iter != end; ++iter){
+            edge_id uv = _graph->add_edge(lu, _local(iter->first.second));
+            _graph->set_P(uv, _graph->get_P(uv) + iter->second / K_new);
+        }
+        _sum_out_rates[u] = K_new;
+    }
+};
+
+}
+
+#endif
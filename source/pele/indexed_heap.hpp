@@ -0,0 +1,161 @@
+#ifndef _PELE_INDEXED_HEAP_HPP_
+#define _PELE_INDEXED_HEAP_HPP_
+
+#include <cstdlib>
+#include <vector>
+#include <assert.h>
+#include <stdexcept>
+
+namespace pele
+{
+
+/**
+ * A binary min-heap of the integers 0 ... n-1 with a key for each.
+ *
+ * The position of each item in the heap is stored, so the key of an item
+ * can be changed in O(log n).  Items with equal keys are ordered by the item
+ * itself, so the order in which items are popped is deterministic.  This is
+ * used by NGT to remove the node of smallest degree next.
+ */
+class IndexedMinHeap
+{
+    static inline size_t npos() { return static_cast<size_t>(-1); }
+    std::vector<size_t> m_heap; // the items in heap order
+    std::vector<size_t> m_position; // the position of each item in m_heap or npos()
+    std::vector<size_t> m_key;
+
+    inline bool less(size_t i, size_t j) const
+    {
+        size_t a = m_heap[i];
+        size_t b = m_heap[j];
+        return m_key[a] < m_key[b] || (m_key[a] == m_key[b] && a < b);
+    }
+
+    inline void swap(size_t i, size_t j)
+    {
+        std::swap(m_heap[i], m_heap[j]);
+        m_position[m_heap[i]] = i;
+        m_position[m_heap[j]] = j;
+    }
+
+    void sift_up(size_t i)
+    {
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (! less(i, parent)) {
+                break;
+            }
+            swap(i, parent);
+            i = parent;
+        }
+    }
+
+    void sift_down(size_t i)
+    {
+        const size_t n = m_heap.size();
+        while (true) {
+            size_t smallest = i;
+            size_t left = 2 * i + 1;
+            size_t right = left + 1;
+            if (left < n && less(left, smallest)) {
+                smallest = left;
+            }
+            if (right < n && less(right, smallest)) {
+                smallest = right;
+            }
+            if (smallest == i) {
+                break;
+            }
+            swap(i, smallest);
+            i = smallest;
+        }
+    }
+
+public:
+    /**
+     * create an empty heap for the items 0 ... n-1
+     */
+    IndexedMinHeap(size_t n=0)
+        : m_position(n, npos()),
+          m_key(n, 0)
+    {}
+
+    /**
+     * remove all items and allow the items 0 ... n-1
+     */
+    void reset(size_t n)
+    {
+        m_heap.clear();
+        m_position.assign(n, npos());
+        m_key.assign(n, 0);
+    }
+
+    inline size_t size() const { return m_heap.size(); }
+    inline bool empty() const { return m_heap.empty(); }
+    inline bool contains(size_t item) const
+    {
+        return item < m_position.size() && m_position[item] != npos();
+    }
+    inline size_t key(size_t item) const { return m_key[item]; }
+
+    /**
+     * add an item that is not in the heap yet
+     */
+    void push(size_t item, size_t key)
+    {
+        if (item >= m_position.size()) {
+            throw std::out_of_range("IndexedMinHeap: item out of range");
+        }
+        if (contains(item)) {
+            throw std::invalid_argument("IndexedMinHeap: item is already in the heap");
+        }
+        m_key[item] = key;
+        m_position[item] = m_heap.size();
+        m_heap.push_back(item);
+        sift_up(m_heap.size() - 1);
+    }
+
+    /**
+     * the item with the smallest key
+     */
+    inline size_t top() const
+    {
+        assert(! empty());
+        return m_heap[0];
+    }
+
+    /**
+     * remove the item with the smallest key and return it
+     */
+    size_t pop()
+    {
+        assert(! empty());
+        size_t item = m_heap[0];
+        swap(0, m_heap.size() - 1);
+        m_heap.pop_back();
+        m_position[item] = npos();
+        if (! m_heap.empty()) {
+            sift_down(0);
+        }
+        return item;
+    }
+
+    /**
+     * change the key of an item in the heap
+     */
+    void update(size_t item, size_t key)
+    {
+        assert(contains(item));
+        size_t old_key = m_key[item];
+        m_key[item] = key;
+        if (key < old_key) {
+            sift_up(m_position[item]);
+        } else if (key > old_key) {
+            sift_down(m_position[item]);
+        }
+    }
+};
+
+}
+
+#endif
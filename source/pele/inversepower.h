@@ -169,6 +169,42 @@ struct InverseIntPower_interaction {
         }
         return E;
     }
+
+    /*
+     * energy of n pairs from their distances squared, see pairwise_batch.h
+     *
+     * the cutoff is applied with a select rather than a branch so that the
+     * loop can be vectorized
+     */
+    void energy_batch(double const * __restrict__ r2, double * __restrict__ e,
+            size_t n, size_t atomi, size_t atomj0) const
+    {
+        double const * const radii_j = _radii.data() + atomj0;
+        const double radius_i = _radii[atomi];
+        for (size_t j = 0; j < n; ++j) {
+            const double r0 = radius_i + radii_j[j];
+            const double r = std::sqrt(r2[j]);
+            const double E = pos_int_pow<POW>(1 -r/r0) * _eps/_pow;
+            e[j] = (r2[j] < r0 * r0) ? E : 0.;
+        }
+    }
+
+    /* energy and gradient of n pairs from their distances squared, see pairwise_batch.h */
+    void energy_gradient_batch(double const * __restrict__ r2, double * __restrict__ e,
+            double * __restrict__ gij, size_t n, size_t atomi, size_t atomj0) const
+    {
+        double const * const radii_j = _radii.data() + atomj0;
+        const double radius_i = _radii[atomi];
+        for (size_t j = 0; j < n; ++j) {
+            const double r0 = radius_i + radii_j[j];
+            const double r = std::sqrt(r2[j]);
+            const double factor = pos_int_pow<POW>(1 -r/r0) * _eps;
+            const double g = - factor / ((r-r0)*r);
+            const bool overlap = r2[j] < r0 * r0;
+            e[j] = overlap ? factor / _pow : 0.;
+            gij[j] = overlap ? g : 0.;
+        }
+    }
 };
 
 template<int POW2>
@@ -342,13 +378,13 @@ class InversePowerPeriodicCellLists : public CellListPotential< InversePower_int
 public:
     InversePowerPeriodicCellLists(double pow, double eps,
             pele::Array<double> const radii, pele::Array<double> const boxvec,
-            const double ncellx_scale = 1.0)
+            const double ncellx_scale = 1.0, const double skin = 0)
         : CellListPotential< InversePower_interaction, periodic_distance<ndim> >(
                 std::make_shared<InversePower_interaction>(pow, eps, radii),
                 std::make_shared<periodic_distance<ndim> >(boxvec),
                 boxvec, 
 				2.0* (*std::max_element(radii.begin(), radii.end())), // rcut, 
-				ncellx_scale)
+				ncellx_scale, skin)
     {}
 };
 
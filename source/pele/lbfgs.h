@@ -6,6 +6,7 @@
 #include "base_potential.h"
 #include "array.h"
 #include "optimizer.h"
+#include "linesearch.h"
 
 namespace pele{
 
@@ -26,22 +27,44 @@ private:
                           * a step.  
                           * (f_new - f_old) / abs(f_old) < max_f_rise
                           */
+    bool energy_only_linesearch_; /**< If True, the trial steps after a
+                                   * rejected step are evaluated with
+                                   * get_energy only and the gradient is
+                                   * computed at the accepted point.
+                                   */
+    /**
+     * If set, this line search is used instead of the backtracking line
+     * search
+     */
+    std::shared_ptr<MoreThuenteLineSearch> linesearch_;
 
     // places to store the lbfgs memory
-    /** s_ stores the changes in position for the previous M steps */
-    std::vector<Array<double> > s_;
-    /** y_ stores the changes in gradient for the previous M steps */
-    std::vector<Array<double> > y_;
+    /**
+     * memory_ stores the changes in position s and in gradient y for the
+     * previous M steps in one contiguous block, with rows s_0, y_0, s_1, y_1,
+     * ... of length N.  Use s_row() and y_row() to access them.
+     */
+    Array<double> memory_;
     /** rho stores 1/dot(y_, s_) for the previous M steps */
     Array<double> rho_;
     /**
      * H0 is the initial estimate for the diagonal component of the inverse Hessian.
      * It is an input parameter, but the estimate is improved during the run.
      * H0 is a scalar, which means that we use the same value for all degrees of freedom.
+     * If a preconditioner M is set, H0 * M^-1 is used instead.
      */
     double H0_;
     int k_; /**< Counter for how many times the memory has been updated */
 
+    // workspace, allocated once so that an iteration does no heap allocations
+    Array<double> xold_; /**< the position before the step */
+    Array<double> gold_; /**< the gradient before the step */
+    Array<double> step_; /**< the step direction */
+    Array<double> xnew_; /**< trial position in the line search */
+    Array<double> gnew_; /**< trial gradient in the line search */
+    Array<double> alpha_; /**< coefficients of the two loop recursion */
+    Array<double> preconditioned_y_; /**< M^-1 y, if a preconditioner is set */
+
 public:
     /**
      * Constructor
@@ -74,8 +97,35 @@ public:
         use_relative_f_ = (bool) use_relative_f;
     }
 
+    /**
+     * evaluate the backtracked trial steps of the line search with the
+     * energy only
+     *
+     * The first trial step of each iteration is still evaluated with
+     * get_energy_gradient, because it is usually accepted.  This pays off if
+     * the line search backtracks often and get_energy is cheaper than
+     * get_energy_gradient.
+     */
+    inline void set_energy_only_linesearch(int energy_only_linesearch)
+    {
+        energy_only_linesearch_ = (bool) energy_only_linesearch;
+    }
+
+    /**
+     * use a line search which enforces the strong Wolfe conditions instead of
+     * the backtracking line search.  Pass a null pointer to go back to the
+     * backtracking line search.
+     *
+     * The Wolfe line search ignores max_f_rise and energy_only_linesearch.
+     */
+    inline void set_linesearch(std::shared_ptr<MoreThuenteLineSearch> linesearch)
+    {
+        linesearch_ = linesearch;
+    }
+
     // functions for accessing the results
     inline double get_H0() const { return H0_; }
+    inline bool get_energy_only_linesearch() const { return energy_only_linesearch_; }
 
     /**
      * reset the lbfgs optimizer to start a new minimization from x0
@@ -87,15 +137,21 @@ public:
 
 private:
 
+    inline double * s_row(int i) { return memory_.data() + 2 * x_.size() * i; }
+    inline double * y_row(int i) { return memory_.data() + 2 * x_.size() * i + x_.size(); }
+
     /**
      * Add a step to the LBFGS Memory
-     * This updates s_, y_, rho_, H0_, and k_
+     * This updates memory_, rho_, H0_, and k_
      */
     void update_memory( Array<double> xold, Array<double> gold, 
             Array<double> xnew, Array<double> gnew);
 
     /**
      * Compute the LBFGS step from the memory
+     *
+     * Each dot product of the two loop recursion is computed in the same pass
+     * over the data as the preceding update of the step.
      */
     void compute_lbfgs_step(Array<double> step);
 
@@ -106,6 +162,11 @@ private:
      */
     double backtracking_linesearch(Array<double> step);
 
+    /**
+     * Take the step using linesearch_.  Return 0 if no lower point was found.
+     */
+    double wolfe_linesearch(Array<double> step);
+
 };
 }
 
@@ -0,0 +1,95 @@
+#ifndef _PELE_LINESEARCH_H__
+#define _PELE_LINESEARCH_H__
+
+#include "base_potential.h"
+#include "array.h"
+#include "optimizer_trace.h"
+
+namespace pele {
+
+/**
+ * A line search which finds a step satisfying the strong Wolfe conditions.
+ *
+ * This is the algorithm of
+ *
+ * Jorge J. More and David J. Thuente, "Line search algorithms with guaranteed
+ * sufficient decrease", ACM Trans. Math. Software 20, 286 (1994)
+ *
+ * as implemented in the routines dcsrch and dcstep of MINPACK-2.  With
+ * phi(stp) = f(x + stp * p) it searches for a step with
+ *
+ *     phi(stp) <= phi(0) + ftol * stp * phi'(0)
+ *     |phi'(stp)| <= gtol * |phi'(0)|
+ *
+ * using safeguarded cubic and quadratic interpolation.  Every trial step
+ * costs one call to get_energy_gradient.
+ */
+class MoreThuenteLineSearch {
+private:
+    double ftol_; /**< The sufficient decrease parameter */
+    double gtol_; /**< The curvature condition parameter */
+    double xtol_; /**< The relative tolerance for the width of the interval */
+    int max_nfev_; /**< The maximum number of function evaluations */
+
+public:
+    /**
+     * Constructor
+     *
+     * 0 < ftol < gtol < 1 is required.  For quasi-Newton methods gtol = 0.9 is
+     * the usual choice, nonlinear conjugate gradient methods need a more
+     * accurate line search, e.g. gtol = 0.1.
+     */
+    MoreThuenteLineSearch(double ftol=1e-4, double gtol=0.9, double xtol=1e-10,
+            int max_nfev=20);
+
+    inline void set_ftol(double ftol) { ftol_ = ftol; }
+    inline void set_gtol(double gtol) { gtol_ = gtol; }
+    inline void set_xtol(double xtol) { xtol_ = xtol; }
+    inline void set_max_nfev(int max_nfev) { max_nfev_ = max_nfev; }
+
+    inline double get_ftol() const { return ftol_; }
+    inline double get_gtol() const { return gtol_; }
+    inline double get_xtol() const { return xtol_; }
+    inline int get_max_nfev() const { return max_nfev_; }
+
+    /**
+     * Search along the direction p starting from x.
+     *
+     * f and g are the function value and gradient at x and p must be a
+     * descent direction, dot(g, p) < 0.  stp is the initial trial step and
+     * stpmax the largest step allowed, both in units of p.  On return xnew,
+     * fnew and gnew hold the accepted point and nfev has been incremented by
+     * the number of function evaluations.
+     *
+     * If the Wolfe conditions can not be satisfied, e.g. because of rounding
+     * errors or because max_nfev is reached, the point with the lowest
+     * function value found is returned.  If no point lower than f was found
+     * the return value is 0 and xnew, fnew and gnew are a copy of x, f and g.
+     *
+     * If trace is given, the time spent in the potential is added to it.
+     *
+     * @return the accepted step length in units of p
+     */
+    double search(BasePotential & potential, Array<double> const & x, double f,
+            Array<double> const & g, Array<double> const & p, double stp, double stpmax,
+            Array<double> xnew, double & fnew, Array<double> gnew, int & nfev,
+            OptimizerTrace * trace=NULL) const;
+
+private:
+    /**
+     * Compute a safeguarded step for the search and update the interval
+     * which contains a step satisfying the Wolfe conditions.
+     *
+     * This is dcstep of MINPACK-2.  stx is the step with the lowest function
+     * value so far and sty the other end point of the interval, fx, dx and
+     * fy, dy the function values and derivatives there.  stp, fp, dp describe
+     * the current step, which is replaced by the new trial step.
+     */
+    static void step(double & stx, double & fx, double & dx, double & sty, double & fy,
+            double & dy, double & stp, double fp, double dp, bool & brackt, double stpmin,
+            double stpmax);
+};
+
+}
+
+#endif
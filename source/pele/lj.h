@@ -68,6 +68,31 @@ public:
         *hij = (_156C12 * ir12 - _42C6 * ir6) * ir2;
         return -_C6*ir6 + _C12*ir12;
     }
+
+    /* energy of n pairs from their distances squared, see pairwise_batch.h */
+    void inline energy_batch(double const * __restrict__ r2, double * __restrict__ e,
+            size_t n, size_t /*atom_i*/, size_t /*atom_j0*/) const
+    {
+        for (size_t j = 0; j < n; ++j) {
+            double ir2 = 1.0/r2[j];
+            double ir6 = ir2*ir2*ir2;
+            double ir12 = ir6*ir6;
+            e[j] = -_C6*ir6 + _C12*ir12;
+        }
+    }
+
+    /* energy and gradient of n pairs from their distances squared, see pairwise_batch.h */
+    void inline energy_gradient_batch(double const * __restrict__ r2, double * __restrict__ e,
+            double * __restrict__ gij, size_t n, size_t /*atom_i*/, size_t /*atom_j0*/) const
+    {
+        for (size_t j = 0; j < n; ++j) {
+            double ir2 = 1.0/r2[j];
+            double ir6 = ir2*ir2*ir2;
+            double ir12 = ir6*ir6;
+            gij[j] = (_12C12 * ir12 - _6C6 * ir6) * ir2;
+            e[j] = -_C6*ir6 + _C12*ir12;
+        }
+    }
 };
 
 
@@ -79,6 +79,40 @@ struct lj_interaction_cut_smooth {
         *hij = (_156C12 * ir12 - _42C6 * ir6) * ir2 + _2A2;
         return -_C6*ir6 + _C12*ir12 + _A0 + _A2*r2;
     }
+
+    /*
+     * energy of n pairs from their distances squared, see pairwise_batch.h
+     *
+     * the cutoff is applied with a select rather than a branch so that the
+     * loop can be vectorized
+     */
+    void inline energy_batch(double const * __restrict__ r2, double * __restrict__ e,
+            size_t n, size_t /*atom_i*/, size_t /*atom_j0*/) const
+    {
+        for (size_t j = 0; j < n; ++j) {
+            double ir2 = 1.0/r2[j];
+            double ir6 = ir2*ir2*ir2;
+            double ir12 = ir6*ir6;
+            double ej = -_C6*ir6 + _C12*ir12 + _A0 + _A2*r2[j];
+            e[j] = (r2[j] < _rcut2) ? ej : 0.;
+        }
+    }
+
+    /* energy and gradient of n pairs from their distances squared, see pairwise_batch.h */
+    void inline energy_gradient_batch(double const * __restrict__ r2, double * __restrict__ e,
+            double * __restrict__ gij, size_t n, size_t /*atom_i*/, size_t /*atom_j0*/) const
+    {
+        for (size_t j = 0; j < n; ++j) {
+            double ir2 = 1.0/r2[j];
+            double ir6 = ir2*ir2*ir2;
+            double ir12 = ir6*ir6;
+            double gj = (_12C12 * ir12 - _6C6 * ir6) * ir2 - _2A2;
+            double ej = -_C6*ir6 + _C12*ir12 + _A0 + _A2*r2[j];
+            const bool inside = r2[j] < _rcut2;
+            gij[j] = inside ? gj : 0.;
+            e[j] = inside ? ej : 0.;
+        }
+    }
 };
 
 /**
@@ -153,11 +187,12 @@ public:
 template<size_t ndim>
 class LJCutPeriodicCellLists : public CellListPotential<lj_interaction_cut_smooth, periodic_distance<ndim> > {
 public:
-    LJCutPeriodicCellLists(double c6, double c12, double rcut, Array<double> const boxvec, double ncellx_scale)
+    LJCutPeriodicCellLists(double c6, double c12, double rcut, Array<double> const boxvec, double ncellx_scale,
+            double skin=0)
         : CellListPotential<lj_interaction_cut_smooth, periodic_distance<ndim> >(
             std::make_shared<lj_interaction_cut_smooth>(c6, c12, rcut),
             std::make_shared<periodic_distance<ndim> >(boxvec),
-            boxvec, rcut, ncellx_scale)
+            boxvec, rcut, ncellx_scale, skin)
     {}
 };
 
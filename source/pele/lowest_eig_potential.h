@@ -80,79 +80,60 @@ public:
 
 /*
  * Lowest Eigenvalue Potential:
- * gd = g(x+d)
- * _v: normal unit vector in arbitrary direction
- * _d: finite difference step
+ * the energy is the Rayleigh quotient mu = v.H.v of the normalized vector v
+ * with the Hessian H of _potential at _coords.
+ * hv = H(_coords) v is computed with get_hessian_vector_product, which is
+ * analytic for the pairwise potentials and a finite difference otherwise
  * */
 
 class LowestEigPotential : public BasePotential {
 protected:
     std::shared_ptr<pele::BasePotential> _potential;
-    pele::Array<double> _coords, _coordsd, _g, _gd;
+    pele::Array<double> _coords, _hv;
     size_t _bdim, _natoms;
-    double _d;
     OrthogonalizeTranslational _orthog;
 public:
 
-    //LowestEigPotential(std::shared_ptr<pele::BasePotential> potential, pele::Array<double>
-    //        coords, size_t bdim, double d=1e-6);
     /*constructor*/
     LowestEigPotential(std::shared_ptr<pele::BasePotential> potential, pele::Array<double>coords,
-            size_t bdim, double d=1e-6)
-        : _potential(potential), _coords(coords), _coordsd(coords.size()),
-          _g(_coords.size()), _gd(_coords.size()), _bdim(bdim),
-          _natoms(_coords.size()/_bdim), _d(d), _orthog(_natoms,_bdim)
-    {
-        _potential->get_energy_gradient(_coords,_g);
-    }
+            size_t bdim)
+        : _potential(potential), _coords(coords),
+          _hv(_coords.size()), _bdim(bdim),
+          _natoms(_coords.size()/_bdim), _orthog(_natoms,_bdim)
+    {}
 
 
     virtual ~LowestEigPotential(){}
 
 
-    //virtual double inline get_energy(pele::Array<double> x);
-    /* calculate energy from distance squared, r0 is the hard core distance, r is the distance between the centres */
+    /* return the curvature along x */
     virtual double inline get_energy(pele::Array<double> x)
     {
         _orthog.orthogonalize(_coords, x); //takes care of orthogonalizing and normalizing x
 
-        for (size_t i=0;i<x.size();++i) {
-            _coordsd[i] = _coords[i] + _d*x[i];
-        }
-
-        _potential->get_energy_gradient(_coordsd,_gd);
-        _gd -= _g;
-        double mu = dot(_gd,x)/_d;
+        _potential->get_hessian_vector_product(_coords, x, _hv);
+        double mu = dot(_hv,x);
 
         return mu;
     }
 
-    //virtual double inline get_energy_gradient(pele::Array<double> x,
-    //        pele::Array<double> grad);
-    /* calculate energy and gradient from distance squared, gradient is in g/|rij|, r0 is the hard core distance, r is the distance between the centres */
+    /* return the curvature along x and its gradient with respect to x */
     virtual double inline get_energy_gradient(pele::Array<double> x, pele::Array<double> grad)
     {
         _orthog.orthogonalize(_coords, x);  //takes care of orthogonalizing and normalizing x
 
+        _potential->get_hessian_vector_product(_coords, x, _hv);
+        double mu = dot(_hv,x);
         for (size_t i=0;i<x.size();++i) {
-            _coordsd[i] = _coords[i] + _d*x[i];
-        }
-
-        _potential->get_energy_gradient(_coordsd,_gd);
-        _gd -= _g;
-        double mu = dot(_gd,x)/_d;
-        for (size_t i=0;i<x.size();++i) {
-            grad[i] = 2*_gd[i]/_d - 2*mu*x[i];
+            grad[i] = 2*_hv[i] - 2*mu*x[i];
         }
 
         return mu;
     }
 
-    //void reset_coords(pele::Array<double> new_coords);
     void reset_coords(pele::Array<double> new_coords)
     {
         _coords.assign(new_coords);
-        _potential->get_energy_gradient(_coords,_g);
     }
 
 
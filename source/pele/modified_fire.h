@@ -39,16 +39,36 @@ namespace pele {
  * to true (default) then whenever P<=0 we undo the last step besides carrying out
  * the operations defined by the original FIRE algorithm.
  *
+ * With set_fire2(true) the FIRE 2.0 variant is used instead:
+ *
+ * Julien Guenole, Wolfram G. Noehring, Aviral Vaid, Frederic Houlle, Zhuocheng Xie,
+ * Aruna Prakash, and Erik Bitzek. Comput. Mater. Sci. 175, 109584 (2020)
+ * https://doi.org/10.1016/j.commatsci.2020.109584
+ *
+ * P is checked before the MD step and the semi-implicit Euler integrator mixes
+ * the velocity after the velocity update.  If P<=0 the positions go back half
+ * a time step instead of to the previous positions, and the time step and
+ * alpha are only reduced after the first Nmin iterations.  The time step is
+ * never reduced below dtstart / 50.
+ *
+ * Both variants write the velocity and the position update in a single pass
+ * over the coordinates.  The norms needed for the mixing and for maxstep are
+ * computed from v.v, v.g and g.g, which are accumulated in one pass after
+ * each potential call.
  */
 
 class MODIFIED_FIRE : public GradientOptimizer{
 private :
-    double _dtstart, _dt, _dtmax, _maxstep, _Nmin, _finc, _fdec, _fa, _astart, _a, _fold, _ifnorm, _vnorm;
-    pele::Array<double> _v, _dx, _xold, _gold;
+    double _dtstart, _dt, _dtmax, _dtmin, _maxstep, _Nmin, _finc, _fdec, _fa, _astart, _a, _fold, _ifnorm, _vnorm;
+    double _vv, _vg, _gg; /**< v.v, v.g and g.g for the current v and g */
+    double _dtstep; /**< the time step of the last position update, after the maxstep rescaling */
+    pele::Array<double> _v, _xold, _gold;
     size_t _fire_iter_number, _N;
     bool _stepback;
-    inline void _ForwardEuler_integration();
-    inline void _VelocityVerlet_integration();
+    bool _fire2;
+    inline void _modified_fire_iteration();
+    inline void _fire2_iteration();
+    inline void _update_dot_products();
 public :
 
       /**
@@ -79,6 +99,12 @@ public :
 
     inline void reset(Array<double> &x0);
 
+    /**
+     * use the FIRE 2.0 variant of the algorithm
+     */
+    inline void set_fire2(bool fire2) { _fire2 = fire2; }
+    inline bool get_fire2() const { return _fire2; }
+
   };
 
   inline void MODIFIED_FIRE::reset(Array<double> &x0)
@@ -95,6 +121,7 @@ public :
       //fire specific
       _fire_iter_number = 0;
       _dt = _dtstart;
+      _dtstep = _dtstart;
       _a = _astart;
       _fold = f_;
       _xold.assign(x_);
@@ -102,75 +129,97 @@ public :
       for(size_t k=0; k<x_.size();++k){
           _v[k] = -g_[k]*_dt;
       }
-      _ifnorm = 1./norm(g_);
-      _vnorm = norm(_v);
+      _update_dot_products();
+      _ifnorm = 1. / sqrt(_gg);
+      _vnorm = sqrt(_vv);
       rms_ = 1. / (_ifnorm*sqrt(_N));
   }
 
-  inline void MODIFIED_FIRE::_VelocityVerlet_integration()
+  /**
+   * compute v.v, v.g and g.g in one pass
+   */
+  inline void MODIFIED_FIRE::_update_dot_products()
   {
-      /* the minuses in the following expressions are due to the fact that
-       * the gradients rather than the forces appear in the expression
-       */
+      double vv = 0, vg = 0, gg = 0;
+      double const * const __restrict__ v = _v.data();
+      double const * const __restrict__ g = g_.data();
       for (size_t i = 0; i < _N; ++i) {
-          _v[i] -= 0.5 * _dt * (_gold[i] + g_[i]);         //update velocity assumes all masses 1
-          _dx[i] = _dt * (_v[i] - 0.5 * _dt * g_[i]);      //build displacement vector, assumes all masses 1
-      }
-      _gold.assign(g_);             //save gradient as old g
-      double normdx = norm(_dx);
-
-      if (normdx > _maxstep) {
-          _dx *= (_maxstep / normdx); //resize displacement vector is greater than _maxstep
+          vv += v[i] * v[i];
+          vg += v[i] * g[i];
+          gg += g[i] * g[i];
       }
-
-      x_ += _dx;
-
-      f_ = potential_->get_energy_gradient(x_, g_);    //update gradient
+      _vv = vv;
+      _vg = vg;
+      _gg = gg;
   }
 
-  inline void MODIFIED_FIRE::_ForwardEuler_integration()
+  inline void MODIFIED_FIRE::one_iteration()
   {
-      /* the minuses in the following expressions are due to the fact that
-       * the gradients rather than the forces appear in the expression
-       */
-      for (size_t i = 0; i < _N; ++i) { //this was after get_energy_gradient, moved for testing
-          _v[i] -= _dt * g_[i];     //update velocity, assumes all masses are 1
-          _dx[i] = _dt * _v[i];     //build displacement vector
-      }
-
-      _gold.assign(g_);             //save gradient as old g
-      double normdx = norm(_dx);
+      nfev_ += 1;
+      iter_number_ += 1;
 
-      if (normdx > _maxstep) {
-          _dx *= (_maxstep / normdx); //resize displacement vector is greater than _maxstep
+      if (_fire2) {
+          _fire2_iteration();
+      } else {
+          _modified_fire_iteration();
       }
 
-      x_ += _dx;
-
-      f_ = potential_->get_energy_gradient(x_, g_);    //update gradient
+      // print some status information
+      if ((iprint_ > 0) && (iter_number_ % iprint_ == 0)) {
+          std::cout << "fire: " << iter_number_
+              << " fire_iter_number " << _fire_iter_number
+              << " dt " << _dt
+              << " a " << _a
+              << " P " << -_vg
+              << " vnorm " << _vnorm
+              << " E " << f_
+              << " rms " << rms_
+              << " nfev " << nfev_ << "\n";
+      }
   }
 
-  inline void MODIFIED_FIRE::one_iteration()
+  inline void MODIFIED_FIRE::_modified_fire_iteration()
   {
-      nfev_ += 1;
-      iter_number_ += 1;
       _fire_iter_number += 1; //this is different from iter_number_ which does not get reset
 
       //save old configuration in case next step has P < 0
       _fold = f_; //set f_ old before integration step
-      _xold.assign(x_); //save x as xold, gold saved in integrator (because velocity verlet needs it, if vv is used)
+      const double gg_old = _gg;
 
-      /*equation written in this conditional statement _v = (1- _a)*_v + _a * funit * vnorm*/
+      /* the fire inertial velocity _v = (1- _a)*_v + _a * funit * vnorm followed
+       * by the forward Euler step _v -= _dt * g is _v = c1 * _v + c2 * g.  The
+       * minuses are due to the fact that the gradients rather than the forces
+       * appear in the expression, all masses are 1
+       */
+      const double c1 = 1. - _a;
+      const double c2 = -(_a * _ifnorm * _vnorm + _dt);
+      const double mix = _a * _ifnorm * _vnorm;
+      // |dx| = _dt * |c1 * _v + c2 * g|
+      const double normdx = _dt * sqrt(std::max(0., c1 * c1 * _vv + 2 * c1 * c2 * _vg + c2 * c2 * _gg));
+      double dt = _dt;
+      if (normdx > _maxstep) {
+          dt *= _maxstep / normdx; //resize displacement vector if greater than _maxstep
+      }
 
+      // save x and g as xold and gold, update the velocity and the position
+      double * const __restrict__ x = x_.data();
+      double * const __restrict__ v = _v.data();
+      double * const __restrict__ xold = _xold.data();
+      double * const __restrict__ gold = _gold.data();
+      double const * const __restrict__ g = g_.data();
       for (size_t i = 0; i < _N; ++i) {
-          _v[i] = (1. - _a) * _v[i] - _a * g_[i] * _ifnorm * _vnorm;
+          xold[i] = x[i];
+          gold[i] = g[i];
+          v[i] = c1 * v[i] - mix * g[i];
+          v[i] -= _dt * g[i];
+          x[i] += dt * v[i];
       }
+      _dtstep = dt;
 
-      /*run MD*/
-      this->_ForwardEuler_integration();
-      //this->_VelocityVerlet_integration();
+      f_ = PELE_TRACE_POTENTIAL(potential_->get_energy_gradient(x_, g_));    //update gradient
+      _update_dot_products();
 
-      double P = -1 * dot(_v, g_);
+      double P = -_vg;
 
       if (P > 0) {
           if (_fire_iter_number > _Nmin) {
@@ -178,8 +227,8 @@ public :
               _a *= _fa;
           }
 
-          _ifnorm = 1. / norm(g_);
-          _vnorm = norm(_v);
+          _ifnorm = 1. / sqrt(_gg);
+          _vnorm = sqrt(_vv);
           rms_ = 1. / (_ifnorm * sqrt(_N)); //update rms
       }
       else {
@@ -187,6 +236,8 @@ public :
           _a = _astart;
           _fire_iter_number = 0;
           _v.assign(0);
+          _vv = 0;
+          _vg = 0;
 
           //reset position and gradient to the one before the step (core of modified fire) reset velocity to initial (0)
           if (_stepback == true) {
@@ -194,24 +245,69 @@ public :
               //reset position and gradient to the one before the step (core of modified fire) reset velocity to initial (0)
               x_.assign(_xold);
               g_.assign(_gold);
+              _gg = gg_old;
           }
           if (verbosity_ > 1) {
               std::cout << "warning: step direction was uphill.  inverting\n";
           }
       }
+      PELE_TRACE_ITERATION((_stepback && P <= 0) ? 0. : std::min(normdx, _maxstep));
+  }
 
-      // print some status information
-      if ((iprint_ > 0) && (iter_number_ % iprint_ == 0)) {
-          std::cout << "fire: " << iter_number_
-              << " fire_iter_number " << _fire_iter_number
-              << " dt " << _dt
-              << " a " << _a
-              << " P " << P
-              << " vnorm " << _vnorm
-              << " E " << f_
-              << " rms " << rms_
-              << " nfev " << nfev_ << "\n";
+  inline void MODIFIED_FIRE::_fire2_iteration()
+  {
+      // the half step back is done with the old velocity
+      double halfstep = 0;
+      double c1, c2;
+      if (_vg < 0) {
+          // P = -v.g > 0
+          _fire_iter_number += 1;
+          if (_fire_iter_number > _Nmin) {
+              _dt = std::min(_dt * _finc, _dtmax);
+              _a *= _fa;
+          }
+          // _v -= _dt * g followed by the mixing _v = (1 - _a) * _v + _a * |_v| funit,
+          // where |_v|^2 = v.v - 2 dt v.g + dt^2 g.g is the norm after the update
+          c1 = 1. - _a;
+          const double vv_new = std::max(0., _vv - 2 * _dt * _vg + _dt * _dt * _gg);
+          c2 = -(c1 * _dt + ((_gg > 0) ? _a * sqrt(vv_new / _gg) : 0));
+      } else {
+          _fire_iter_number = 0;
+          // initial delay: no decrease during the first Nmin iterations
+          if (iter_number_ > _Nmin) {
+              _dt = std::max(_dt * _fdec, _dtmin);
+              _a = _astart;
+          }
+          halfstep = -0.5 * _dtstep;
+          c1 = 0;
+          c2 = -_dt;
+          if (verbosity_ > 1) {
+              std::cout << "warning: step direction was uphill.  going back half a step\n";
+          }
+      }
+      const double normdx = _dt * sqrt(std::max(0., c1 * c1 * _vv + 2 * c1 * c2 * _vg + c2 * c2 * _gg));
+      double dt = _dt;
+      if (normdx > _maxstep) {
+          dt *= _maxstep / normdx; //resize displacement vector if greater than _maxstep
+      }
+
+      double * const __restrict__ x = x_.data();
+      double * const __restrict__ v = _v.data();
+      double const * const __restrict__ g = g_.data();
+      for (size_t i = 0; i < _N; ++i) {
+          const double vi = c1 * v[i] + c2 * g[i];
+          x[i] += halfstep * v[i] + dt * vi;
+          v[i] = vi;
       }
+      _dtstep = dt;
+
+      _fold = f_;
+      f_ = PELE_TRACE_POTENTIAL(potential_->get_energy_gradient(x_, g_));    //update gradient
+      _update_dot_products();
+      _ifnorm = 1. / sqrt(_gg);
+      _vnorm = sqrt(_vv);
+      rms_ = 1. / (_ifnorm * sqrt(_N)); //update rms
+      PELE_TRACE_ITERATION(std::min(normdx, _maxstep));
   }
 
 } // namespace pele
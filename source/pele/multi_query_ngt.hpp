@@ -0,0 +1,212 @@
+#ifndef _PELE_MULTI_QUERY_NGT_HPP_
+#define _PELE_MULTI_QUERY_NGT_HPP_
+/*
+ * Rates from the New Graph Transformation method (NGT) between many pairs of
+ * groups of nodes of the same network.
+ *
+ * The reduced graph does not depend on the order in which nodes are removed.
+ * So all nodes that are not a candidate end point of any query (e.g. the
+ * minima of all funnels of interest) can be removed once.  Each query (A, B)
+ * then only removes the other candidates from a copy of this much smaller
+ * graph.
+ *
+ * The reduced graph is renumbered, so that its nodes are 0 ... k-1 for k
+ * candidates.  Then a query only costs as much as the candidates, however
+ * many nodes were removed.  The node ids are translated back in the
+ * results.
+ */
+
+#include <cstdlib>
+#include <list>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <assert.h>
+
+#include "graph.hpp"
+#include "ngt.hpp"
+
+namespace pele
+{
+
+/*
+ * the rates and committors of one query of MultiQueryNGT
+ */
+class MultiQueryResult {
+    std::shared_ptr<NGT> _ngt;
+    std::shared_ptr<std::vector<node_id> const> _candidates;
+
+public:
+    MultiQueryResult(std::shared_ptr<NGT> ngt, std::shared_ptr<std::vector<node_id> const> candidates) :
+        _ngt(ngt),
+        _candidates(candidates)
+    {}
+
+    double get_rate_AB(){ return _ngt->get_rate_AB(); }
+    double get_rate_BA(){ return _ngt->get_rate_BA(); }
+    double get_rate_AB_SS(){ return _ngt->get_rate_AB_SS(); }
+    double get_rate_BA_SS(){ return _ngt->get_rate_BA_SS(); }
+
+    /*
+     * the committor probabilities of the candidates if they were computed
+     */
+    std::map<node_id, double> get_committors() const
+    {
+        std::map<node_id, double> committors;
+        for (auto const & mapval : _ngt->get_committors()){
+            committors[(*_candidates)[mapval.first]] = mapval.second;
+        }
+        return committors;
+    }
+
+    /*
+     * the NGT that did the query.  Its node i is the candidate
+     * MultiQueryNGT::get_candidates()[i].
+     */
+    std::shared_ptr<NGT> get_ngt() const { return _ngt; }
+};
+
+class MultiQueryNGT {
+public:
+    typedef NGT::rate_map_t rate_map_t;
+
+private:
+    std::shared_ptr<NGT> _ngt; // removes all nodes except the candidates, released by reduce
+    std::shared_ptr<std::vector<node_id> > _candidates; // sorted
+    std::shared_ptr<Graph> _graph; // the reduced graph, node i is the candidate (*_candidates)[i]
+    std::vector<double> _initial_tau; // of each candidate
+    std::map<node_id, double> _weights; // of each candidate, by its position in _candidates
+    size_t _nr_threads;
+    NGT::elimination_order_t _order;
+
+public:
+    /*
+     * construct from the rate constants of the network and the nodes that
+     * can be in A or B of a query.
+     */
+    template<class Container>
+    MultiQueryNGT(rate_map_t &rate_constants, Container const &candidates) :
+        _ngt(std::make_shared<NGT>(rate_constants, candidates, std::list<node_id>())),
+        _candidates(std::make_shared<std::vector<node_id> >(_ngt->_A)),
+        _nr_threads(1),
+        _order(NGT::MIN_DEGREE)
+    {}
+
+    void set_node_occupation_probabilities(std::map<node_id, double> &Peq){
+        for (auto const & mapval : Peq){
+            size_t i = _position(mapval.first);
+            if (i < _candidates->size()){
+                _weights.insert(std::make_pair(i, mapval.second));
+            }
+        }
+    }
+    void set_nr_threads(size_t nr_threads){
+        if (nr_threads == 0){
+            throw std::invalid_argument("the number of threads must be positive");
+        }
+        _nr_threads = nr_threads;
+    }
+    void set_elimination_order(NGT::elimination_order_t order) { _order = order; }
+
+    /*
+     * the candidates in increasing order
+     */
+    std::vector<node_id> const & get_candidates() const { return *_candidates; }
+
+    /*
+     * remove all nodes except the candidates.  This is done by the first
+     * query if it was not called before.
+     */
+    void reduce(){
+        if (_graph) return;
+        _ngt->set_nr_threads(_nr_threads);
+        _ngt->set_elimination_order(_order);
+        _ngt->phase_one();
+        std::vector<node_id> ids;
+        _graph = std::make_shared<Graph>(_ngt->_graph->compacted(ids));
+        assert(ids == *_candidates);
+        _initial_tau.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i){
+            _initial_tau[i] = _ngt->initial_tau[ids[i]];
+        }
+        _ngt.reset();
+    }
+
+    /*
+     * the reduced graph.  Its node i is the candidate get_candidates()[i].
+     */
+    std::shared_ptr<Graph> get_reduced_graph(){
+        reduce();
+        return _graph;
+    }
+
+    /*
+     * Compute the rates between the groups of candidates A and B.
+     *
+     * If committors is true the committor probabilities are computed as well.
+     * They are only available for the candidates, because the other nodes
+     * were removed before the query.
+     */
+    template<class Acontainer, class Bcontainer>
+    std::shared_ptr<MultiQueryResult> query(Acontainer const &A, Bcontainer const &B, bool committors=false){
+        reduce();
+        std::vector<node_id> local_A = _checked_positions(A);
+        std::vector<node_id> local_B = _checked_positions(B);
+        std::vector<char> in_A(_candidates->size(), 0);
+        for (node_id a : local_A){
+            in_A[a] = 1;
+        }
+        for (node_id b : local_B){
+            if (in_A[b]){
+                throw std::invalid_argument("MultiQueryNGT: A and B must not overlap");
+            }
+        }
+
+        auto graph = std::make_shared<Graph>(*_graph);
+        auto result = std::make_shared<NGT>(graph, local_A, local_B);
+        result->set_nr_threads(_nr_threads);
+        result->set_elimination_order(_order);
+        if (! _weights.empty()){
+            result->set_node_occupation_probabilities(_weights);
+        }
+        result->initial_tau = _initial_tau;
+        if (committors){
+            result->compute_rates_and_committors();
+        } else {
+            result->compute_rates();
+        }
+        return std::make_shared<MultiQueryResult>(result, _candidates);
+    }
+
+private:
+    /*
+     * the position of u in _candidates, or the number of candidates if u is
+     * not a candidate
+     */
+    size_t _position(node_id u) const {
+        auto iter = std::lower_bound(_candidates->begin(), _candidates->end(), u);
+        if (iter == _candidates->end() || *iter != u){
+            return _candidates->size();
+        }
+        return iter - _candidates->begin();
+    }
+
+    template<class Container>
+    std::vector<node_id> _checked_positions(Container const & group) const {
+        std::vector<node_id> positions;
+        for (node_id u : group){
+            size_t i = _position(u);
+            if (i == _candidates->size()){
+                throw std::invalid_argument("MultiQueryNGT: the nodes of A and B must be candidates");
+            }
+            positions.push_back(i);
+        }
+        return positions;
+    }
+};
+
+}
+
+#endif
@@ -12,50 +12,88 @@
 
 
 #include <cstdlib>
+#include <functional>
 #include <iostream>
 #include <list>
-#include <queue>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cmath>
 #include <assert.h>
 #include <stdexcept>
 #include <memory>
 
 #include "graph.hpp"
+#include "indexed_heap.hpp"
+#include "parallel.h"
 
 using std::cout;
 
 namespace pele
 {
 
-bool compare_degree(node_ptr u, node_ptr v){
-    return u->in_out_degree() < v->in_out_degree();
-}
-
 class NGT {
 public:
     typedef std::map<std::pair<node_id, node_id>, double> rate_map_t;
 
     std::shared_ptr<Graph> _graph;
-    std::set<node_ptr> _A; // the source nodes
-    std::set<node_ptr> _B; // the sink nodes
-    std::list<node_ptr> intermediates; //this will an up to date list of nodes sorted by the node degree
+    std::vector<node_id> _A; // the source nodes
+    std::vector<node_id> _B; // the sink nodes
+    std::vector<node_id> intermediates; // the nodes that are removed in phase one
     bool debug;
 
+    /*
+     * The order in which the intermediates are removed.  Removing a node x
+     * connects all its in neighbors with all its out neighbors, so the order
+     * determines how many edges are created.
+     *
+     * MIN_DEGREE removes the node with the fewest edges first.
+     * MIN_UPDATES removes the node with the fewest edge updates first, i.e.
+     * the smallest product of the number of in and out neighbors.  This is an
+     * upper bound on the number of edges that are created.
+     */
+    enum elimination_order_t {
+        MIN_DEGREE,
+        MIN_UPDATES
+    };
+
+    /*
+     * The per node results are stored in vectors indexed by the node id.
+     * Entries that have not been computed are NaN.
+     */
     /**
      * the initial waiting time before any graph transformation.  Used to
      * compute steady state rates.
      */
-    std::map<node_id, double> initial_tau;
+    std::vector<double> initial_tau;
     /**
      * Final values of 1-Pxx for node x after the graph transformation.
      */
-    std::map<node_id, double> final_omPxx;
+    std::vector<double> final_omPxx;
     /**
      * Final values of tau for node x after the graph transformation.
      */
-    std::map<node_id, double> final_tau;
-    std::map<node_id, double> final_committors;
-    std::map<node_id, double> weights; // normally these are equilibrium occupation probabilities
+    std::vector<double> final_tau;
+    std::vector<double> final_committors;
+    std::vector<double> weights; // normally these are equilibrium occupation probabilities
+
+private:
+    elimination_order_t _order;
+    IndexedMinHeap _queue; // the intermediates that are not removed yet
+    std::vector<node_id> _touched; // the neighbors of the node that is being removed
+    size_t _nr_threads;
+    std::vector<node_id> _selected; // the nodes removed in a parallel round
+    std::vector<size_t> _marks; // marks the neighborhoods of the selected nodes
+    size_t _stamp;
+    // below these sizes a parallel round is not worth starting the threads
+    static const size_t _min_parallel_round = 256;
+    static const size_t _min_nodes_per_thread = 32;
+    // a larger delta gives larger rounds but a worse elimination order
+    static const size_t _max_key_delta = 2;
+    std::function<void(node_id)> _removal_callback;
 
+public:
 
     
     ~NGT()
@@ -71,146 +109,129 @@ public:
     template<class Acontainer, class Bcontainer>
     NGT(std::shared_ptr<Graph> graph, Acontainer const &A, Bcontainer const &B) :
         _graph(graph),
-        debug(false)
+        debug(false),
+        _order(MIN_DEGREE),
+        _nr_threads(1),
+        _stamp(0)
     {
-        for (auto u : A){
-            _A.insert(_graph->get_node(u));
-        }
-        for (auto u : B){
-            _B.insert(_graph->get_node(u));
-        }
+        _init_results();
+        _init_groups(A, B);
+    }
 
-        // make intermediates
-        for (auto const & mapval : _graph->node_map_){
-            node_ptr u = mapval.second;
-            if (_A.find(u) == _A.end() and _B.find(u) == _B.end()){
-                intermediates.push_back(u);
-            }
-        }
+    void set_debug() { debug=true; }
 
-//        std::cout << "number of nodes " << _graph->number_of_nodes() << "\n";
-//        std::cout << "A.size() " << _A.size() << "\n";
-//        std::cout << "B.size() " << _B.size() << "\n";
-//        std::cout << "intermediates.size() " << intermediates.size() << "\n";
-        assert(intermediates.size() + _A.size() + _B.size() == _graph->number_of_nodes());
+    /*
+     * f(x) is called just before node x is removed by remove_node or by a
+     * parallel round of phase one, while the edges of x are unchanged.
+     */
+    void set_removal_callback(std::function<void(node_id)> f) { _removal_callback = f; }
+    void set_elimination_order(elimination_order_t order) { _order = order; }
+    elimination_order_t get_elimination_order() const { return _order; }
 
+    /*
+     * return the committor probabilities of all nodes for which they have been computed
+     */
+    std::map<node_id, double> get_committors() const
+    {
+        std::map<node_id, double> committors;
+        for (node_id u = 0; u < final_committors.size(); ++u) {
+            if (! std::isnan(final_committors[u])) {
+                committors[u] = final_committors[u];
+            }
+        }
+        return committors;
     }
 
-    void set_debug() { debug=true; }
-    std::map<node_id, double> const & get_committors() { return final_committors; }
-
     /*
      * construct the NGT from a map of rate constants.
      */
     template<class Acontainer, class Bcontainer>
     NGT(rate_map_t &rate_constants, Acontainer const &A, Bcontainer const &B) :
         _graph(new Graph()),
-        debug(false)
+        debug(false),
+        _order(MIN_DEGREE),
+        _nr_threads(1),
+        _stamp(0)
     {
-        std::set<node_ptr> nodes;
-
         // add nodes to the graph and sum the rate constants for all out edges for each node.
-        std::map<node_ptr, double> sum_out_rates;
-        for (auto const & mapvals : rate_constants){
-            node_ptr u = _graph->add_node(mapvals.first.first);
-            node_ptr v = _graph->add_node(mapvals.first.second);
-            double k = mapvals.second;
-            nodes.insert(u);
-            nodes.insert(v);
-
-            try {
-                sum_out_rates.at(u) += k;
-            } catch (std::out_of_range & e) {
-                sum_out_rates[u] = k;
+        if (! rate_constants.empty()) {
+            node_id max_id = 0;
+            for (auto const & mapvals : rate_constants){
+                max_id = std::max(max_id, std::max(mapvals.first.first, mapvals.first.second));
             }
+            _graph->reserve_nodes(max_id + 1);
+        }
+        _graph->reserve_edges(rate_constants.size());
+        for (auto const & mapvals : rate_constants){
+            _graph->add_node(mapvals.first.first);
+            _graph->add_node(mapvals.first.second);
+        }
+        std::vector<double> sum_out_rates(_graph->node_id_bound(), 0.);
+        for (auto const & mapvals : rate_constants){
+            sum_out_rates[mapvals.first.first] += mapvals.second;
         }
+        _init_results();
 
         // set tau_x for each node
         // add edge Pxx for each node and initialize P to 0.
-        for (auto x : nodes){
+        std::vector<node_id> nodes = _graph->nodes();
+        for (node_id x : nodes){
             double tau_x = 1. / sum_out_rates[x];
             set_tau(x, tau_x);
-            initial_tau[x->id()] = tau_x;
-            edge_ptr xx = _graph->_add_edge(x, x);
-            set_P(xx, 0.);
+            initial_tau[x] = tau_x;
+            add_edge(x, x);
         }
 
         // set Puv for each edge
         for (auto const & mapval : rate_constants){
-            node_ptr u = _graph->get_node(mapval.first.first);
-            node_ptr v = _graph->get_node(mapval.first.second);
+            node_id u = mapval.first.first;
+            node_id v = mapval.first.second;
             double k = mapval.second;
 
-            edge_ptr uv = _graph->_add_edge(u, v);
+            edge_id uv = _graph->add_edge(u, v);
             double tau_u = get_tau(u);
             double Puv = k * tau_u;
             set_P(uv, Puv);
-
-            try {
-                sum_out_rates.at(u) += k;
-            } catch (std::out_of_range & e) {
-                sum_out_rates[u] = k;
-            }
         }
 
-
-        // make the set of A and B
-        for (auto a : A){
-            _A.insert(_graph->get_node(a));
-        }
-        for (auto b : B){
-            _B.insert(_graph->get_node(b));
-        }
-
-        // make a list of intermediates
-        for (auto a : _A){
-            nodes.erase(a);
-        }
-        for (auto b : _B){
-            nodes.erase(b);
-        }
-        intermediates.assign(nodes.begin(), nodes.end());
-
-
-//        std::cout << _graph->number_of_nodes() << "\n";
-//        std::cout << _A.size() << "\n";
-//        std::cout << _B.size() << "\n";
-//        std::cout << intermediates.size() << "\n";
-//        std::cout << nodes.size() << "\n";
-        assert(intermediates.size() + _A.size() + _B.size() == _graph->number_of_nodes());
+        _init_groups(A, B);
     }
 
     void set_node_occupation_probabilities(std::map<node_id, double> &Peq){
-        weights.insert(Peq.begin(), Peq.end());
+        if (weights.empty()) {
+            weights.assign(_graph->node_id_bound(), std::numeric_limits<double>::quiet_NaN());
+        }
+        for (auto const & mapval : Peq) {
+            if (mapval.first < weights.size() && std::isnan(weights[mapval.first])) {
+                weights[mapval.first] = mapval.second;
+            }
+        }
     }
 
     /*
-     * Sort the list of intermediates.
-     *
-     * This is done because it is faster to remove nodes with fewer connections first.
+     * the priority of node x in the elimination order.  Nodes with smaller
+     * values are removed first.
      */
-    void sort_intermediates(){
-        node_ptr x = *intermediates.begin();
-        if (debug){
-            std::cout << "smallest node degree " << x->in_out_degree() << "\n";
-        }
-        if (x->in_out_degree() > 4) {
-            intermediates.sort(compare_degree);
+    size_t elimination_key(node_id x){
+        if (_order == MIN_DEGREE){
+            return _graph->in_out_degree(x);
         }
+        size_t loop = (_graph->get_edge(x, x) != NO_EDGE) ? 1 : 0;
+        return (_graph->in_degree(x) - loop) * (_graph->out_degree(x) - loop);
     }
-    
+
     /*
      * accessors for graph properties P and tau attached to the edges and nodes.
      */
-    inline double get_tau(node_ptr u){ return u->tau; }
-    inline double get_P(edge_ptr edge){ return edge->P; }
-    inline void set_tau(node_ptr u, double tau){ u->tau = tau; }
-    inline void set_P(edge_ptr edge, double P){ edge->P = P; }
+    inline double get_tau(node_id u){ return _graph->get_tau(u); }
+    inline double get_P(edge_id edge){ return _graph->get_P(edge); }
+    inline void set_tau(node_id u, double tau){ _graph->set_tau(u, tau); }
+    inline void set_P(edge_id edge, double P){ _graph->set_P(edge, P); }
 
     /*
-     * This returns P for the edge u->u.  This is slow because the edge must first be found.
+     * This returns P for the edge u->u.
      */
-    double get_node_P(node_ptr u){ return get_P(u->get_successor_edge(u)); }
+    double get_node_P(node_id u){ return get_P(_graph->get_edge(u, u)); }
 
     /*
      * This returns 1.-P for the edge u->u.
@@ -219,18 +240,17 @@ public:
      * This is extremely important for numerical precision.  It is this ability to deal precisely
      * with both P and 1.-P that makes this method more stable then linear algebra methods.
      */
-    double get_node_one_minus_P(node_ptr u){
-        edge_ptr uu = u->get_successor_edge(u);
+    double get_node_one_minus_P(node_id u){
+        edge_id uu = _graph->get_edge(u, u);
         double Puu = get_P(uu);
         if (Puu < 0.99){
             return 1. - Puu;
         } else {
             // sum the contributions from all other edges
             double omPuu = 0.;
-            for (auto eiter = u->out_edge_begin(); eiter != u->out_edge_end(); ++eiter){
-                node_ptr v = (*eiter)->head();
-                if (v != u){
-                    omPuu += (*eiter)->P;
+            for (auto const & uv : _graph->out_edges(u)){
+                if (uv.head != u){
+                    omPuu += get_P(uv.edge);
                 }
             }
             return omPuu;
@@ -243,13 +263,13 @@ public:
      *
      * tau_u -> tau_u + Pux * tau_x / (1-Pxx)
      */
-    void update_node(edge_ptr ux, double omPxx, double tau_x){
-        node_ptr u = ux->tail();
+    void update_node(edge_id ux, double omPxx, double tau_x){
+        node_id u = _graph->tail(ux);
         double Pux = get_P(ux);
         double tau_u = get_tau(u);
         double new_tau_u = tau_u + Pux * tau_x / omPxx;
         if (debug){
-            std::cout << "updating node " << u->id() << " tau " << tau_u << " -> " << new_tau_u << "\n";
+            std::cout << "updating node " << u << " tau " << tau_u << " -> " << new_tau_u << "\n";
         }
         set_tau(u, new_tau_u);
     }
@@ -257,8 +277,8 @@ public:
     /*
      * add an edge to the graph and set P to 0
      */
-    edge_ptr add_edge(node_ptr u, node_ptr v){
-       edge_ptr edge = _graph->_add_edge(u, v);
+    edge_id add_edge(node_id u, node_id v){
+       edge_id edge = _graph->add_edge(u, v);
        set_P(edge, 0.);
        return edge;
     }
@@ -267,20 +287,16 @@ public:
      * Node x is being deleted, so update P for the edge u -> v
      *
      * Puv -> Puv + Pux * Pxv / (1-Pxx)
+     *
+     * If the edge doesn't exist yet it is created with P = 0.
      */
-    void update_edge(node_ptr u, node_ptr v, edge_ptr ux, edge_ptr xv, double omPxx){
-        edge_ptr uv = u->get_successor_edge(v);  // this is slow
-        if (uv == NULL){
-            uv = add_edge(u, v);
-        }
-
-        double Pux = get_P(ux);
-        double Pxv = get_P(xv);
+    void update_edge(node_id u, node_id v, double Pux, double Pxv, double omPxx){
+        edge_id uv = _graph->add_edge(u, v);
         double Puv = get_P(uv);
 
         double newPuv = Puv + Pux * Pxv / omPxx;
         if (debug) {
-            std::cout << "updating edge " << u->id() << " -> " << v->id() << " Puv " << Puv << " -> " << newPuv
+            std::cout << "updating edge " << u << " -> " << v << " Puv " << Puv << " -> " << newPuv
                     << " 1-Pxx " << omPxx
                     << " Pux " << Pux
                     << " Pxv " << Pxv
@@ -292,60 +308,85 @@ public:
     /*
      * remove node x from the graph and update its neighbors
      */
-    void remove_node(node_ptr x){
+    void remove_node(node_id x){
         if (debug){
-            std::cout << "removing node " << x->id() << "\n";
+            std::cout << "removing node " << x << "\n";
+        }
+        if (_removal_callback){
+            _removal_callback(x);
         }
         double taux = get_tau(x);
-//        double Pxx = get_node_P(x);
         double omPxx = get_node_one_minus_P(x);
 
         // update the node data for all the neighbors
-        for (auto eiter = x->in_edge_begin(); eiter != x->in_edge_end(); eiter++){
-            edge_ptr edge = *eiter;
-            if (edge->tail() != edge->head()){
-                update_node(edge, omPxx, taux);
+        Graph::in_edge_list const & in_edges = _graph->in_edges(x);
+        Graph::out_edge_list const & out_edges = _graph->out_edges(x);
+        for (edge_id ux : in_edges){
+            if (_graph->tail(ux) != x){
+                update_node(ux, omPxx, taux);
             }
         }
 
-        std::set<node_ptr> neibs = x->in_out_neighbors();
-        neibs.erase(x);
-
-        //
-        for (auto uxiter = x->in_edge_begin(); uxiter != x->in_edge_end(); ++uxiter){
-            edge_ptr ux = *uxiter;
-            node_ptr u = ux->tail();
+        /*
+         * Update the edges u->v between all in neighbors u and out neighbors v.
+         * This only adds edges to u and in edges to v, so the edge lists of x
+         * are not changed while we iterate over them.
+         */
+        for (edge_id ux : in_edges){
+            node_id u = _graph->tail(ux);
             if (u == x) continue;
-            for (auto xviter = x->out_edge_begin(); xviter != x->out_edge_end(); ++xviter){
-                edge_ptr xv = *xviter;
-                node_ptr v = xv->head();
+            double Pux = get_P(ux);
+            for (auto const & xv : out_edges){
+                node_id v = xv.head;
                 if (v == x) continue;
-//                if (u == v){
-//                    continue;
-//                }
-                update_edge(u, v, ux, xv, omPxx);
+                update_edge(u, v, Pux, get_P(xv.edge), omPxx);
             }
         }
 
-        // remove the node from the graph
-        _graph->_remove_node(x);
-
+        _remove_from_graph(x);
     }
 
     /*
      * remove all intermediates from the graph
      */
     void remove_intermediates(){
-        while (intermediates.size() > 0){
-            sort_intermediates();
-
-            node_ptr x = intermediates.front();
-            intermediates.pop_front();
+        // removing nodes with fewer connections first is much faster
+        _queue.reset(_graph->node_id_bound());
+        for (node_id u : intermediates){
+            _queue.push(u, elimination_key(u));
+        }
+        intermediates.clear();
 
+        while (! _queue.empty()){
+            if (_nr_threads > 1 && _queue.size() >= _min_parallel_round){
+                _remove_independent_set();
+                continue;
+            }
+            node_id x = _queue.pop();
+            if (debug){
+                std::cout << "elimination key of next node " << _queue.key(x) << "\n";
+            }
             remove_node(x);
         }
     }
 
+    /*
+     * the number of threads used to remove intermediates.
+     *
+     * With more than one thread, phase one removes the intermediates in rounds.
+     * Each round selects low degree nodes whose neighborhoods do not overlap.
+     * Removing one of them changes only its own neighbors, so they are removed
+     * at the same time.  The results agree with the serial calculation up to
+     * round off, because the order of elimination is different.
+     */
+    void set_nr_threads(size_t nr_threads){
+        if (nr_threads == 0){
+            throw std::invalid_argument("the number of threads must be positive");
+        }
+        _nr_threads = nr_threads;
+    }
+    size_t get_nr_threads() const { return _nr_threads; }
+
     /*
      * phase one of the rate calculation is to remove all intermediate nodes
      */
@@ -359,25 +400,25 @@ public:
      * For each node x in to_remove, this involves removing all other nodes in to_remove, and
      * getting the results from this reduced graph.
      */
-    void reduce_all_in_group(std::set<node_ptr> &to_remove, std::set<node_ptr> & to_keep){
-        std::list<node_id> Aids, Bids;
-        // copy the ids of the nodes in to_remove into Aids
-        for (auto u : to_remove){
-            Aids.push_back(u->id());
-        }
-        // copy the ids of the nodes in to_keep into Bids
-        for (auto u : to_keep){
-            Bids.push_back(u->id());
-        }
-
+    void reduce_all_in_group(std::vector<node_id> const &to_remove, std::vector<node_id> const & to_keep){
         // note: should we sort the minima in to_remove?
 
-        if (Aids.size() > 1){
-            // make a copy of _graph called working_graph
-            auto working_graph = std::make_shared<Graph> (*_graph);
-            std::list<node_id> empty_list;
+        if (to_remove.size() > 1){
+            /*
+             * make a compact copy of _graph called working_graph.  The nodes
+             * removed in phase one leave empty slots in _graph, so the copies
+             * of working_graph below only cost as much as the nodes that are
+             * left.  ids holds the id in _graph of each node of working_graph.
+             */
+            std::vector<node_id> ids;
+            auto working_graph = std::make_shared<Graph>(_graph->compacted(ids));
+            std::vector<node_id> local_to_remove = _local_ids(ids, to_remove);
+            std::list<node_id> Aids(local_to_remove.begin(), local_to_remove.end());
+            std::vector<node_id> Bids = _local_ids(ids, to_keep);
             // make an ngt object for working_graph
             NGT working_ngt(working_graph, std::list<node_id>(), Bids);
+            working_ngt.set_elimination_order(_order);
+            working_ngt.set_nr_threads(_nr_threads);
             while (Aids.size() > 1){
                 /*
                  * Create a new graph and a new NGT object new_ngt.  Pass x as A and Bids as B.  new_ngt will
@@ -395,31 +436,27 @@ public:
 
                 // remove all nodes from new_graph except x
                 NGT new_ngt(new_graph, newAids, Bids);
+                new_ngt.set_elimination_order(_order);
+                new_ngt.set_nr_threads(_nr_threads);
                 new_ngt.remove_intermediates();
-                node_ptr xptr = new_graph->get_node(x);
-                final_omPxx[x] = new_ngt.get_node_one_minus_P(xptr);
-                final_tau[x] = new_ngt.get_tau(xptr);
+                final_omPxx[ids[x]] = new_ngt.get_node_one_minus_P(x);
+                final_tau[ids[x]] = new_ngt.get_tau(x);
 
                 // delete node x from the old_graph
-                working_ngt.remove_node(working_graph->get_node(x));
+                working_ngt.remove_node(x);
             }
             // there is one node left. we can just read off the results
             assert(Aids.size() == 1);
             node_id x = Aids.back();
-            Aids.pop_back();
-            node_ptr xptr = working_graph->get_node(x);
-            final_omPxx[x] = working_ngt.get_node_one_minus_P(xptr);
-            final_tau[x] = working_ngt.get_tau(xptr);
+            final_omPxx[ids[x]] = working_ngt.get_node_one_minus_P(x);
+            final_tau[ids[x]] = working_ngt.get_tau(x);
 
-        } else if (Aids.size() == 1) {
+        } else if (to_remove.size() == 1) {
             // if there is only one node in A then we can just read off the results.
-            node_id x = Aids.back();
-            Aids.pop_back();
-            node_ptr xptr = _graph->get_node(x);
-            final_omPxx[x] = get_node_one_minus_P(xptr);
-            final_tau[x] = get_tau(xptr);
+            node_id x = to_remove.back();
+            final_omPxx[x] = get_node_one_minus_P(x);
+            final_tau[x] = get_tau(x);
         }
-        assert(Aids.size() == 0);
     }
 
     /*
@@ -438,19 +475,29 @@ public:
         phase_two();
     }
 
+    /*
+     * return the weight of node a
+     */
+    double get_weight(node_id a){
+        if (weights.empty()){
+            return 1.;
+        }
+        if (a >= weights.size() || std::isnan(weights[a])){
+            throw std::out_of_range("NGT: no occupation probability was given for a node in A or B");
+        }
+        return weights[a];
+    }
+
     /*
      * compute the final rate A->B or B->A from final_tau and final_omPxx
      */
-    double _get_rate_final(std::set<node_ptr> &A){
+    double _get_rate_final(std::vector<node_id> const &A){
         double rate_sum = 0.;
         double norm = 0.;
         for (auto a : A){
-            double omPxx = final_omPxx.at(a->id());
-            double tau_a = final_tau.at(a->id());
-            double weight = 1.;
-            if (weights.size() > 0){
-                weight = weights.at(a->id());
-            }
+            double omPxx = final_omPxx[a];
+            double tau_a = final_tau[a];
+            double weight = get_weight(a);
             rate_sum += weight * omPxx / tau_a;
             norm += weight;
         }
@@ -471,24 +518,20 @@ public:
         return _get_rate_final(_B);
     }
 
-    double _get_rate_SS(std::set<node_ptr> & A, std::set<node_ptr> & B){
+    double _get_rate_SS(std::vector<node_id> const & A, std::vector<node_id> const & B){
+        std::vector<char> in_B = _make_flags(B);
         double kAB = 0.;
         double norm = 0.;
         for (auto a : A){
             // compute PaB the probability that this node goes directly to B
             double PaB = 0.;
-            for (auto eiter = a->out_edge_begin(); eiter != a->out_edge_end(); ++eiter){
-                edge_ptr ab = *eiter;
-                node_ptr b = ab->head();
-                if (B.find(b) != B.end()){
-                    PaB += get_P(ab);
+            for (auto const & ab : _graph->out_edges(a)){
+                if (in_B[ab.head]){
+                    PaB += get_P(ab.edge);
                 }
             }
-            double weight = 1.;
-            if (weights.size() > 0){
-                weight = weights.at(a->id());
-            }
-            kAB += weight * PaB / initial_tau.at(a->id());
+            double weight = get_weight(a);
+            kAB += weight * PaB / initial_tau[a];
             norm += weight;
         }
         return kAB / norm;
@@ -514,21 +557,22 @@ public:
 
     /*
      * sum the probabilities of the out edges of x that end in B normalized by 1-Pxx
+     *
+     * in_B[b] is non zero if b is in B
      */
-    double get_PxB(node_ptr x, std::set<node_id> & B){
+    double get_PxB(node_id x, std::vector<char> const & in_B){
         double PxB = 0.;
         double Pxx = 0.;
         double omPxx = 0.;
-        for (auto eiter = x->out_edge_begin(); eiter != x->out_edge_end(); ++eiter){
-            edge_ptr xb = *eiter;
-            node_ptr b = xb->head();
-            double Pxb = get_P(xb);
+        for (auto const & xb : _graph->out_edges(x)){
+            node_id b = xb.head;
+            double Pxb = get_P(xb.edge);
             if (b == x){
                 Pxx = Pxb;
             } else {
                 omPxx += Pxb;
             }
-            if (B.find(b->id()) != B.end()){
+            if (in_B[b]){
                 PxB += Pxb;
             }
         }
@@ -550,61 +594,92 @@ public:
      * All nodes should be in one of the three passed groups of nodes.  Duplicates
      * between to_keep and committor_targets are OK.
      */
-    void _remove_nodes_and_compute_committors(std::list<node_ptr> &to_remove,
-            std::set<node_ptr> &to_keep, std::set<node_ptr> const &committor_targets)
+    void _remove_nodes_and_compute_committors(std::vector<node_id> const &to_remove,
+            std::vector<node_id> const &to_keep, std::vector<node_id> const &committor_targets)
     {
-        // make a copy of to_remove.  Store the id's
-        std::list<node_id> to_remove_cp;
-        for (auto u : to_remove){
-            to_remove_cp.push_back(u->id());
-        }
-
         // copy the nodes from to_keep and committor_target into a new set Bids;
-        // make a copy of committor_target
-        std::set<node_id> Bids;
-        std::set<node_id> targets;
-        // create a set of Bids
-        for (auto u : to_keep){
-            Bids.insert(u->id());
-        }
-        for (auto u : committor_targets){
-            Bids.insert(u->id());
-            targets.insert(u->id());
-        }
+        std::vector<node_id> Bids(to_keep.begin(), to_keep.end());
+        Bids.insert(Bids.end(), committor_targets.begin(), committor_targets.end());
+        std::sort(Bids.begin(), Bids.end());
+        Bids.erase(std::unique(Bids.begin(), Bids.end()), Bids.end());
 
         // ensure there are no unaccounted for nodes
-        assert(to_remove_cp.size() + Bids.size() == _graph->number_of_nodes());
+        assert(to_remove.size() + Bids.size() == _graph->number_of_nodes());
+        if (to_remove.empty()){
+            return;
+        }
+
+        /*
+         * The nodes are removed in the elimination order from working_graph,
+         * a compact copy of _graph.  It is compacted again whenever half of
+         * its nodes are removed, so the per node copies below only cost as
+         * much as the nodes that are left.  ids holds the id in _graph of
+         * each node of working_graph.
+         */
+        std::vector<node_id> ids;
+        auto working_graph = std::make_shared<Graph>(_graph->compacted(ids));
+        std::vector<node_id> remaining(to_remove.begin(), to_remove.end());
+        while (true){
+            std::vector<node_id> local_B = _local_ids(ids, Bids);
+            NGT working_ngt(working_graph, _local_ids(ids, remaining), local_B);
+            working_ngt.set_elimination_order(_order);
+            working_ngt.set_nr_threads(_nr_threads);
+            std::vector<char> is_target = working_ngt._make_flags(_local_ids(ids, committor_targets));
+            IndexedMinHeap & queue = working_ngt._queue;
+            queue.reset(working_graph->node_id_bound());
+            for (node_id u : working_ngt._A){
+                queue.push(u, working_ngt.elimination_key(u));
+            }
 
-        // note: should we sort the nodes in to_remove?
+            while (! queue.empty() && 2 * working_graph->number_of_nodes() > working_graph->node_id_bound()){
+                /*
+                 * Create a new graph and a new NGT object new_ngt.  Pass x as A and Bids as B.  new_ngt will
+                 * remove all `intermediates`, i.e. everything in to_remove except x.  Then save the final
+                 * value of 1-Pxx and tau_x.
+                 */
+                // choose the next element x and remove it from the queue
+                node_id x = queue.pop();
+                std::list<node_id> Aids;
+                Aids.push_back(x);
 
-        while (to_remove_cp.size() > 0){
-            /*
-             * Create a new graph and a new NGT object new_ngt.  Pass x as A and Bids as B.  new_ngt will
-             * remove all `intermediates`, i.e. everything in to_remove except x.  Then save the final
-             * value of 1-Pxx and tau_x.
-             */
-            // choose an element x and remove it from the list
-            node_id x = to_remove_cp.back();
-            to_remove_cp.pop_back();
-            std::list<node_id> Aids;
-            Aids.push_back(x);
-
-            // make a copy of _graph
-            auto new_graph = std::make_shared<Graph>(*_graph);
-
-            // remove all to_remove nodes from new_graph except x
-            NGT new_ngt(new_graph, Aids, Bids);
-            new_ngt.remove_intermediates();
-            node_ptr xptr = new_graph->get_node(x);
-            final_omPxx[x] = new_ngt.get_node_one_minus_P(xptr);
-            final_tau[x] = new_ngt.get_tau(xptr);
-            if (! targets.empty()){
-                final_committors[x] = new_ngt.get_PxB(xptr, targets);
+                // make a copy of working_graph
+                auto new_graph = std::make_shared<Graph>(*working_graph);
+
+                // remove all to_remove nodes from new_graph except x
+                NGT new_ngt(new_graph, Aids, local_B);
+                new_ngt.set_elimination_order(_order);
+                new_ngt.set_nr_threads(_nr_threads);
+                new_ngt.remove_intermediates();
+                final_omPxx[ids[x]] = new_ngt.get_node_one_minus_P(x);
+                final_tau[ids[x]] = new_ngt.get_tau(x);
+                if (! committor_targets.empty()){
+                    final_committors[ids[x]] = new_ngt.get_PxB(x, is_target);
+                }
+
+                // delete node x from working_graph
+                working_ngt.remove_node(x);
+            }
+            if (queue.empty()){
+                break;
             }
 
-            // delete node x from _graph
-            this->remove_node(_graph->get_node(x));
+            // compact working_graph again
+            remaining.clear();
+            for (node_id u : working_ngt._A){
+                if (queue.contains(u)){
+                    remaining.push_back(ids[u]);
+                }
+            }
+            std::vector<node_id> local_ids;
+            working_graph = std::make_shared<Graph>(working_graph->compacted(local_ids));
+            for (node_id & u : local_ids){
+                u = ids[u];
+            }
+            ids.swap(local_ids);
         }
+
+        // _graph is left with the nodes in Bids, as if they were removed from it directly
+        *_graph = working_graph->expanded(ids, _graph->node_id_bound());
     }
 
     /*
@@ -621,14 +696,241 @@ public:
 
         // set the committor for nodes in A to 0
         for (auto a : _A){
-            final_committors[a->id()] = 0.;
+            final_committors[a] = 0.;
         }
         // set the committor for nodes in B to 1
         for (auto b : _B){
-            final_committors[b->id()] = 1.;
+            final_committors[b] = 1.;
+        }
+    }
+
+private:
+    /*
+     * an edge u->v that is created by the removal of a node in a parallel round
+     */
+    struct NewEdge {
+        node_id u;
+        node_id v;
+        double P;
+    };
+
+    /*
+     * remove node x from the graph and update the position of its neighbors
+     * in the elimination order.  The properties of the neighbors must already
+     * be updated.
+     */
+    void _remove_from_graph(node_id x){
+        if (! _queue.empty()){
+            // remember the neighbors, their degrees change when x is removed
+            _touched.clear();
+            for (edge_id ux : _graph->in_edges(x)){
+                _touched.push_back(_graph->tail(ux));
+            }
+            for (auto const & xv : _graph->out_edges(x)){
+                _touched.push_back(xv.head);
+            }
+        }
+
+        // remove the node from the graph
+        _graph->remove_node(x);
+
+        // update the position of the neighbors in the elimination order
+        if (! _queue.empty()){
+            for (node_id u : _touched){
+                if (_queue.contains(u)){
+                    _queue.update(u, elimination_key(u));
+                }
+            }
         }
     }
 
+    /*
+     * Update tau and P of the neighbors of x for the removal of x, like
+     * remove_node, but without changing the structure of the graph.  Edges
+     * u->v that don't exist yet are appended to new_edges.
+     *
+     * This is called concurrently for nodes whose neighborhoods don't overlap.
+     * It only writes tau of the in neighbors of x and P of the edges between
+     * the neighbors of x, so the calls don't touch the same memory.
+     */
+    void _update_neighbors(node_id x, std::vector<NewEdge> & new_edges){
+        double taux = get_tau(x);
+        double omPxx = get_node_one_minus_P(x);
+        Graph::in_edge_list const & in_edges = _graph->in_edges(x);
+        Graph::out_edge_list const & out_edges = _graph->out_edges(x);
+        for (edge_id ux : in_edges){
+            node_id u = _graph->tail(ux);
+            if (u == x) continue;
+            double Pux = get_P(ux);
+            set_tau(u, get_tau(u) + Pux * taux / omPxx);
+            for (auto const & xv : out_edges){
+                node_id v = xv.head;
+                if (v == x) continue;
+                double dP = Pux * get_P(xv.edge) / omPxx;
+                edge_id uv = _graph->get_edge(u, v);
+                if (uv == NO_EDGE){
+                    NewEdge e = {u, v, dP};
+                    new_edges.push_back(e);
+                } else {
+                    set_P(uv, get_P(uv) + dP);
+                }
+            }
+        }
+    }
+
+    /*
+     * mark x and its neighbors with the current stamp.  Return false, and mark
+     * nothing, if any of them is marked already.
+     */
+    bool _mark_neighborhood(node_id x){
+        if (_marks[x] == _stamp) return false;
+        for (edge_id ux : _graph->in_edges(x)){
+            if (_marks[_graph->tail(ux)] == _stamp) return false;
+        }
+        for (auto const & xv : _graph->out_edges(x)){
+            if (_marks[xv.head] == _stamp) return false;
+        }
+        _marks[x] = _stamp;
+        for (edge_id ux : _graph->in_edges(x)){
+            _marks[_graph->tail(ux)] = _stamp;
+        }
+        for (auto const & xv : _graph->out_edges(x)){
+            _marks[xv.head] = _stamp;
+        }
+        return true;
+    }
+
+    /*
+     * One parallel round of phase one.
+     *
+     * Greedily select the nodes whose key is at most the smallest key plus
+     * _max_key_delta and whose neighborhoods don't overlap, as in the multiple
+     * minimum degree algorithm.  Their neighbors are updated concurrently,
+     * then the new edges are added and the nodes are removed.
+     */
+    void _remove_independent_set(){
+        if (_marks.size() != _graph->node_id_bound()){
+            _marks.assign(_graph->node_id_bound(), 0);
+            _stamp = 0;
+        }
+        ++_stamp;
+        size_t max_key = _queue.key(_queue.top()) + _max_key_delta;
+        _selected.clear();
+        _touched.clear();
+        while (! _queue.empty() && _queue.key(_queue.top()) <= max_key){
+            node_id x = _queue.pop();
+            if (_mark_neighborhood(x)){
+                _selected.push_back(x);
+            } else {
+                _touched.push_back(x);
+            }
+        }
+        for (node_id x : _touched){
+            _queue.push(x, elimination_key(x));
+        }
+        if (debug){
+            std::cout << "removing " << _selected.size() << " independent nodes\n";
+        }
+        if (_removal_callback){
+            for (node_id x : _selected){
+                _removal_callback(x);
+            }
+        }
+
+        const size_t nthreads = std::min(_nr_threads, _selected.size() / _min_nodes_per_thread + 1);
+        std::vector<std::vector<NewEdge> > new_edges(nthreads);
+        parallel_for_chunks(nthreads, _selected.size(),
+                [&](size_t ithread, size_t ibegin, size_t iend){
+                    for (size_t i = ibegin; i < iend; ++i){
+                        _update_neighbors(_selected[i], new_edges[ithread]);
+                    }
+                });
+
+        for (auto const & edges : new_edges){
+            for (auto const & e : edges){
+                set_P(_graph->add_edge(e.u, e.v), e.P);
+            }
+        }
+        for (node_id x : _selected){
+            _remove_from_graph(x);
+        }
+    }
+
+    /*
+     * size the per node result vectors and mark all entries as not computed
+     */
+    void _init_results(){
+        size_t n = _graph->node_id_bound();
+        double nan = std::numeric_limits<double>::quiet_NaN();
+        initial_tau.assign(n, nan);
+        final_omPxx.assign(n, nan);
+        final_tau.assign(n, nan);
+        final_committors.assign(n, nan);
+    }
+
+    /*
+     * copy A and B into _A and _B and make the list of intermediates
+     */
+    template<class Acontainer, class Bcontainer>
+    void _init_groups(Acontainer const &A, Bcontainer const &B){
+        for (auto a : A){
+            _A.push_back(_checked_node(a));
+        }
+        for (auto b : B){
+            _B.push_back(_checked_node(b));
+        }
+        std::sort(_A.begin(), _A.end());
+        _A.erase(std::unique(_A.begin(), _A.end()), _A.end());
+        std::sort(_B.begin(), _B.end());
+        _B.erase(std::unique(_B.begin(), _B.end()), _B.end());
+
+        // make a list of intermediates
+        std::vector<char> in_AB = _make_flags(_A);
+        for (auto b : _B){
+            in_AB[b] = 1;
+        }
+        for (node_id u : _graph->nodes()){
+            if (! in_AB[u]){
+                intermediates.push_back(u);
+            }
+        }
+
+        assert(intermediates.size() + _A.size() + _B.size() == _graph->number_of_nodes());
+    }
+
+    /*
+     * return the positions in ids, which is sorted, of the nodes in group
+     */
+    static std::vector<node_id> _local_ids(std::vector<node_id> const & ids,
+            std::vector<node_id> const & group)
+    {
+        std::vector<node_id> local;
+        local.reserve(group.size());
+        for (node_id u : group){
+            auto iter = std::lower_bound(ids.begin(), ids.end(), u);
+            assert(iter != ids.end() && *iter == u);
+            local.push_back(iter - ids.begin());
+        }
+        return local;
+    }
+
+    node_id _checked_node(node_id u){
+        if (! _graph->has_node(u)){
+            throw std::invalid_argument("NGT: a node in A or B is not in the graph");
+        }
+        return u;
+    }
+
+    /*
+     * return a vector of flags indexed by node id that are 1 for the nodes in group
+     */
+    std::vector<char> _make_flags(std::vector<node_id> const & group){
+        std::vector<char> flags(_graph->node_id_bound(), 0);
+        for (auto u : group){
+            flags[u] = 1;
+        }
+        return flags;
+    }
 
 };
 
@@ -3,6 +3,8 @@
 
 #include "base_potential.h"
 #include "array.h"
+#include "optimizer_trace.h"
+#include "preconditioner.h"
 #include <vector>
 #include <math.h>
 #include <algorithm>
@@ -77,6 +79,18 @@ protected :
     Array<double> g_; /**< The current gradient */
     double rms_; /**< The root mean square of the gradient */
 
+    /**
+     * An approximation of the Hessian which optimizers that support it use
+     * to rescale the degrees of freedom.  May be null.
+     */
+    std::shared_ptr<Preconditioner> preconditioner_;
+
+    /**
+     * per iteration records, filled if enable_trace() was called.  This is
+     * an empty class if pele is compiled without PELE_OPTIMIZER_TRACE
+     */
+    OptimizerTrace trace_;
+
     /**
      * This flag keeps track of whether the function and gradient have been
      * initialized.  This allows the initial function and gradient to be computed
@@ -172,6 +186,24 @@ public :
     inline void set_max_iter(int max_iter) { maxiter_ = max_iter; }
     inline void set_iprint(int iprint) { iprint_ = iprint; }
     inline void set_verbosity(int verbosity) { verbosity_ = verbosity; }
+    /**
+     * set the preconditioner.  Pass a null pointer to remove it.  Currently
+     * it is used by LBFGS.
+     */
+    inline void set_preconditioner(std::shared_ptr<Preconditioner> preconditioner)
+    {
+        preconditioner_ = preconditioner;
+    }
+    /**
+     * record the following iterations in a ring buffer with space for
+     * capacity iterations.  This throws if pele was compiled without
+     * PELE_OPTIMIZER_TRACE
+     */
+    void enable_trace(size_t capacity)
+    {
+        trace_.enable(capacity, nfev_);
+    }
+    inline void disable_trace() { trace_.disable(); }
 
 
     // functions for accessing the status of the optimizer
@@ -184,6 +216,8 @@ public :
     inline int get_maxiter() const { return maxiter_; }
     inline double get_maxstep() { return maxstep_; }
     inline double get_tol() const {return tol_;}
+    inline std::shared_ptr<Preconditioner> get_preconditioner() const { return preconditioner_; }
+    inline OptimizerTrace const & get_trace() const { return trace_; }
     inline bool success() { return stop_criterion_satisfied(); }
 
     /**
@@ -206,7 +240,16 @@ protected :
         nfev_ += 1;
 
         // pass the arrays to the potential
-        func = potential_->get_energy_gradient(x, gradient);
+        func = PELE_TRACE_POTENTIAL(potential_->get_energy_gradient(x, gradient));
+    }
+
+    /**
+     * Compute only the func of the objective function
+     */
+    void compute_func(Array<double> x, double & func)
+    {
+        nfev_ += 1;
+        func = PELE_TRACE_POTENTIAL(potential_->get_energy(x));
     }
 
     /**
@@ -0,0 +1,199 @@
+#ifndef _PELE_OPTIMIZER_TRACE_H_
+#define _PELE_OPTIMIZER_TRACE_H_
+
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Optional instrumentation of the optimizers.
+ *
+ * If pele is compiled with -DPELE_OPTIMIZER_TRACE, GradientOptimizer can
+ * record one OptimizerTraceRecord per iteration in a ring buffer, see
+ * GradientOptimizer::enable_trace.  Without the flag the macros below
+ * expand to nothing or to the bare potential call, so the optimizers have
+ * no overhead.
+ *
+ * Without the flag OptimizerTrace is an empty class that never records
+ * anything.
+ *
+ * PELE_TRACE_POTENTIAL(expr) evaluates expr, a call of the potential, and
+ * adds the time it took to the current iteration.
+ * PELE_TRACE_ITERATION(stepsize) finishes the record of an iteration.  It is
+ * used at the end of one_iteration().
+ */
+#ifdef PELE_OPTIMIZER_TRACE
+#define PELE_TRACE_POTENTIAL(expr) \
+    (trace_.is_enabled() ? trace_.time_potential([&]() { return (expr); }) : (expr))
+#define PELE_TRACE_ITERATION(stepsize) \
+    do { if (trace_.is_enabled()) trace_.record(iter_number_, f_, rms_, (stepsize), nfev_); } while (0)
+#else
+#define PELE_TRACE_POTENTIAL(expr) (expr)
+#define PELE_TRACE_ITERATION(stepsize) do {} while (0)
+#endif
+
+namespace pele {
+
+/**
+ * The state of an optimizer after one iteration
+ */
+struct OptimizerTraceRecord {
+    int iteration;
+    double energy;
+    double rms;
+    double stepsize; /**< the length of the step */
+    int nfev; /**< the number of function evaluations in this iteration */
+    double potential_time; /**< seconds spent in the potential in this iteration */
+    double wall_time; /**< seconds spent in this iteration */
+};
+
+#ifdef PELE_OPTIMIZER_TRACE
+
+/**
+ * A ring buffer of OptimizerTraceRecord with a fixed capacity.
+ *
+ * The memory is allocated by enable(), so recording an iteration does not
+ * allocate.  When the buffer is full the oldest records are overwritten.
+ */
+class OptimizerTrace {
+    typedef std::chrono::steady_clock clock;
+    std::vector<OptimizerTraceRecord> m_records;
+    size_t m_start;
+    size_t m_size;
+    int m_last_nfev;
+    double m_potential_time;
+    clock::time_point m_last_time;
+public:
+    OptimizerTrace()
+        : m_start(0),
+          m_size(0),
+          m_last_nfev(0),
+          m_potential_time(0)
+    {}
+
+    /**
+     * allocate space for capacity records and clear the buffer
+     */
+    void enable(size_t capacity, int nfev=0)
+    {
+        if (capacity == 0) {
+            throw std::invalid_argument("OptimizerTrace: the capacity must be positive");
+        }
+        m_records.assign(capacity, OptimizerTraceRecord());
+        clear(nfev);
+    }
+
+    void disable()
+    {
+        m_records.clear();
+        clear();
+    }
+
+    inline bool is_enabled() const { return ! m_records.empty(); }
+    inline size_t capacity() const { return m_records.size(); }
+    /**
+     * the number of records in the buffer
+     */
+    inline size_t size() const { return m_size; }
+
+    /**
+     * forget the recorded iterations.  nfev is the current number of
+     * function evaluations of the optimizer
+     */
+    void clear(int nfev=0)
+    {
+        m_start = 0;
+        m_size = 0;
+        m_last_nfev = nfev;
+        m_potential_time = 0;
+        m_last_time = clock::now();
+    }
+
+    /**
+     * return record i, counted from the oldest record in the buffer
+     */
+    OptimizerTraceRecord const & get(size_t i) const
+    {
+        if (i >= m_size) {
+            throw std::out_of_range("OptimizerTrace: index out of range");
+        }
+        return m_records[(m_start + i) % m_records.size()];
+    }
+
+    /**
+     * call f and add the time it took to the potential time of the current
+     * iteration
+     */
+    template <class F>
+    auto time_potential(F f) -> decltype(f())
+    {
+        struct Timer {
+            double & total;
+            clock::time_point start;
+            ~Timer() { total += std::chrono::duration<double>(clock::now() - start).count(); }
+        } timer = {m_potential_time, clock::now()};
+        return f();
+    }
+
+    /**
+     * finish the record of the current iteration
+     */
+    void record(int iteration, double energy, double rms, double stepsize, int nfev)
+    {
+        const clock::time_point now = clock::now();
+        if (nfev < m_last_nfev) {
+            // the optimizer was reset
+            m_last_nfev = 0;
+        }
+        size_t i;
+        if (m_size < m_records.size()) {
+            i = (m_start + m_size) % m_records.size();
+            ++m_size;
+        } else {
+            i = m_start;
+            m_start = (m_start + 1) % m_records.size();
+        }
+        OptimizerTraceRecord & r = m_records[i];
+        r.iteration = iteration;
+        r.energy = energy;
+        r.rms = rms;
+        r.stepsize = stepsize;
+        r.nfev = nfev - m_last_nfev;
+        r.potential_time = m_potential_time;
+        r.wall_time = std::chrono::duration<double>(now - m_last_time).count();
+        m_last_nfev = nfev;
+        m_potential_time = 0;
+        m_last_time = now;
+    }
+};
+
+#else
+
+/**
+ * The stand-in for the ring buffer when pele is compiled without
+ * PELE_OPTIMIZER_TRACE.  It holds no data and is always empty.
+ */
+class OptimizerTrace {
+public:
+    void enable(size_t, int=0)
+    {
+        throw std::runtime_error("OptimizerTrace: pele was compiled without PELE_OPTIMIZER_TRACE");
+    }
+    void disable() {}
+    inline bool is_enabled() const { return false; }
+    inline size_t capacity() const { return 0; }
+    inline size_t size() const { return 0; }
+    void clear(int=0) {}
+    template <class F>
+    auto time_potential(F f) -> decltype(f()) { return f(); }
+    OptimizerTraceRecord const & get(size_t) const
+    {
+        throw std::out_of_range("OptimizerTrace: index out of range");
+    }
+};
+
+#endif // #ifdef PELE_OPTIMIZER_TRACE
+
+} // namespace pele
+
+#endif // #ifndef _PELE_OPTIMIZER_TRACE_H_
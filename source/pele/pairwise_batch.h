@@ -0,0 +1,273 @@
+#ifndef _PELE_PAIRWISE_BATCH_H_
+#define _PELE_PAIRWISE_BATCH_H_
+
+#include <atomic>
+#include <type_traits>
+#include <vector>
+
+#include "distance.h"
+
+/*
+ * Batched loops over all atom pairs for SimplePairwisePotential.
+ *
+ * The coordinates are copied into a structure of arrays so that, for each atom
+ * i, the distances to all atoms j < i can be computed in one contiguous,
+ * branch free loop.  The interaction is then evaluated for the whole row at
+ * once through its energy_batch / energy_gradient_batch member functions,
+ * which are written such that the compiler can vectorize them.
+ *
+ * The loops are compiled for several instruction sets (see PELE_TARGET_CLONES)
+ * and the best one supported by the cpu is picked at load time.  This avoids
+ * compiling everything with -march=native.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && (__GNUC__ >= 6) \
+    && defined(__x86_64__) && defined(__linux__) && !defined(PELE_NO_TARGET_CLONES)
+#define PELE_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define PELE_TARGET_CLONES
+#endif
+
+namespace pele {
+
+/**
+ * has_batch_kernel<interaction>::value is true if the pairwise interaction
+ * provides the member functions
+ *
+ *     void energy_batch(double const * r2, double * e, size_t n,
+ *             size_t atom_i, size_t atom_j0) const
+ *     void energy_gradient_batch(double const * r2, double * e, double * gij,
+ *             size_t n, size_t atom_i, size_t atom_j0) const
+ *
+ * which compute e[j] and gij[j] for the pairs (atom_i, atom_j0 + j), j < n.
+ */
+template <class interaction>
+class has_batch_kernel {
+    template <class T>
+    static auto test(T const * p) -> decltype(
+            p->energy_gradient_batch((double const *)0, (double *)0, (double *)0, size_t(0), size_t(0), size_t(0)),
+            p->energy_batch((double const *)0, (double *)0, size_t(0), size_t(0), size_t(0)),
+            std::true_type());
+    template <class T>
+    static std::false_type test(...);
+public:
+    static const bool value = decltype(test<interaction>(0))::value;
+};
+
+/**
+ * the batched loops are only used for cartesian distances
+ */
+template <class interaction, class distance_policy>
+struct use_batch_kernel : std::false_type {};
+
+template <class interaction, size_t ndim>
+struct use_batch_kernel<interaction, cartesian_distance<ndim> >
+    : std::integral_constant<bool, has_batch_kernel<interaction>::value> {};
+
+namespace batch_detail {
+
+/**
+ * sum of v[0..n) using several independent partial sums so that the loop
+ * can be vectorized without reassociating floating point additions
+ */
+inline double sum(double const * const v, const size_t n)
+{
+    const size_t nlanes = 8;
+    double partial[nlanes] = {0, 0, 0, 0, 0, 0, 0, 0};
+    size_t j = 0;
+    for (; j + nlanes <= n; j += nlanes) {
+        for (size_t l = 0; l < nlanes; ++l) {
+            partial[l] += v[j + l];
+        }
+    }
+    double result = 0;
+    for (; j < n; ++j) {
+        result += v[j];
+    }
+    for (size_t l = 0; l < nlanes; ++l) {
+        result += partial[l];
+    }
+    return result;
+}
+
+/**
+ * copy interleaved coordinates x[ndim * i + k] into xsoa[k * natoms + i]
+ */
+template <size_t ndim>
+inline void to_soa(double const * const x, double * const xsoa, const size_t natoms)
+{
+    for (size_t i = 0; i < natoms; ++i) {
+        for (size_t k = 0; k < ndim; ++k) {
+            xsoa[k * natoms + i] = x[ndim * i + k];
+        }
+    }
+}
+
+/**
+ * compute dr[k][j] = x_i[k] - x_j[k] and r2[j] for all j < n
+ */
+template <size_t ndim>
+inline void row_distances(double const * const xsoa, const size_t natoms,
+        const size_t atom_i, const size_t n, double * const dr, double * const r2)
+{
+    for (size_t j = 0; j < n; ++j) {
+        r2[j] = 0;
+    }
+    for (size_t k = 0; k < ndim; ++k) {
+        double const * const __restrict__ xk = xsoa + k * natoms;
+        double * const __restrict__ drk = dr + k * natoms;
+        double * const __restrict__ r2_ = r2;
+        const double xik = xk[atom_i];
+        for (size_t j = 0; j < n; ++j) {
+            drk[j] = xik - xk[j];
+            r2_[j] += drk[j] * drk[j];
+        }
+    }
+}
+
+} // namespace batch_detail
+
+/**
+ * the number of doubles of scratch memory needed by batch_pairwise_energy
+ */
+template <size_t ndim>
+inline size_t batch_energy_work_size(const size_t natoms)
+{
+    return (2 * ndim + 2) * natoms;
+}
+
+/**
+ * the number of doubles of scratch memory needed by
+ * batch_pairwise_add_energy_gradient
+ */
+template <size_t ndim>
+inline size_t batch_gradient_work_size(const size_t natoms)
+{
+    return (3 * ndim + 3) * natoms;
+}
+
+/**
+ * Scratch memory for the batched loops which is kept by the potential, so
+ * that computing the energy doesn't allocate memory each time.  The memory
+ * is only reallocated when the number of atoms changes.
+ *
+ * The potentials can be called from several threads at once.  Only one
+ * thread at a time uses the shared memory, the others fall back to memory
+ * of their own.  A copy of a workspace is empty.
+ */
+class BatchWorkspace {
+    std::vector<double> m_work;
+    std::atomic<bool> m_in_use;
+public:
+    BatchWorkspace() : m_in_use(false) {}
+    BatchWorkspace(BatchWorkspace const &) : m_in_use(false) {}
+    BatchWorkspace & operator=(BatchWorkspace const &) { return *this; }
+
+    /**
+     * n doubles of scratch memory for the lifetime of this object
+     */
+    class Buffer {
+        BatchWorkspace & m_workspace;
+        std::vector<double> m_own_work;
+        double * m_data;
+        bool m_shared;
+    public:
+        Buffer(BatchWorkspace & workspace, const size_t n)
+            : m_workspace(workspace),
+              m_shared(! workspace.m_in_use.exchange(true, std::memory_order_acquire))
+        {
+            if (m_shared) {
+                if (m_workspace.m_work.size() != n) {
+                    m_workspace.m_work.resize(n);
+                }
+                m_data = m_workspace.m_work.data();
+            } else {
+                m_own_work.resize(n);
+                m_data = m_own_work.data();
+            }
+        }
+        ~Buffer()
+        {
+            if (m_shared) {
+                m_workspace.m_in_use.store(false, std::memory_order_release);
+            }
+        }
+        double * data() { return m_data; }
+    private:
+        Buffer(Buffer const &);
+        Buffer & operator=(Buffer const &);
+    };
+};
+
+/**
+ * return the total energy of all atom pairs.  work must hold
+ * batch_energy_work_size<ndim>(natoms) doubles.
+ */
+template <size_t ndim, class interaction>
+PELE_TARGET_CLONES
+double batch_pairwise_energy(interaction const & pot, double const * const x,
+        const size_t natoms, double * const work)
+{
+    double * const xsoa = work;
+    double * const dr = xsoa + ndim * natoms;
+    double * const r2 = dr + ndim * natoms;
+    double * const e = r2 + natoms;
+    batch_detail::to_soa<ndim>(x, xsoa, natoms);
+    double energy = 0;
+    for (size_t atom_i = 1; atom_i < natoms; ++atom_i) {
+        const size_t n = atom_i;
+        batch_detail::row_distances<ndim>(xsoa, natoms, atom_i, n, dr, r2);
+        pot.energy_batch(r2, e, n, atom_i, 0);
+        energy += batch_detail::sum(e, n);
+    }
+    return energy;
+}
+
+/**
+ * return the total energy of all atom pairs and add the gradient to grad.
+ * work must hold batch_gradient_work_size<ndim>(natoms) doubles.
+ */
+template <size_t ndim, class interaction>
+PELE_TARGET_CLONES
+double batch_pairwise_add_energy_gradient(interaction const & pot,
+        double const * const x, double * const grad, const size_t natoms,
+        double * const work)
+{
+    double * const xsoa = work;
+    double * const gsoa = xsoa + ndim * natoms;
+    double * const dr = gsoa + ndim * natoms;
+    double * const r2 = dr + ndim * natoms;
+    double * const e = r2 + natoms;
+    double * const gij = e + natoms;
+    batch_detail::to_soa<ndim>(x, xsoa, natoms);
+    for (size_t i = 0; i < ndim * natoms; ++i) {
+        gsoa[i] = 0;
+    }
+    double energy = 0;
+    for (size_t atom_i = 1; atom_i < natoms; ++atom_i) {
+        const size_t n = atom_i;
+        batch_detail::row_distances<ndim>(xsoa, natoms, atom_i, n, dr, r2);
+        pot.energy_gradient_batch(r2, e, gij, n, atom_i, 0);
+        energy += batch_detail::sum(e, n);
+        for (size_t k = 0; k < ndim; ++k) {
+            double * const __restrict__ gk = gsoa + k * natoms;
+            double * const __restrict__ drk = dr + k * natoms;
+            double const * const __restrict__ gij_ = gij;
+            // drk is overwritten with gij * dr, the gradient on atom j from this pair
+            for (size_t j = 0; j < n; ++j) {
+                drk[j] *= gij_[j];
+                gk[j] += drk[j];
+            }
+            gk[atom_i] -= batch_detail::sum(drk, n);
+        }
+    }
+    for (size_t i = 0; i < natoms; ++i) {
+        for (size_t k = 0; k < ndim; ++k) {
+            grad[ndim * i + k] += gsoa[k * natoms + i];
+        }
+    }
+    return energy;
+}
+
+} // namespace pele
+
+#endif // #ifndef _PELE_PAIRWISE_BATCH_H_
@@ -0,0 +1,56 @@
+#ifndef _PELE_PARALLEL_H_
+#define _PELE_PARALLEL_H_
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace pele {
+
+/**
+ * split the range [0, n) into nthreads contiguous chunks and call
+ *
+ *     func(ithread, ibegin, iend)
+ *
+ * for each chunk on a separate thread.  Chunk 0 is done by the calling thread.
+ * The function returns when all chunks are done.  If any of the calls throws,
+ * the first exception is rethrown in the calling thread.
+ */
+template <class function_t>
+void parallel_for_chunks(const size_t nthreads, const size_t n, function_t func)
+{
+    if (nthreads == 0) {
+        throw std::invalid_argument("parallel_for_chunks: nthreads must be positive");
+    }
+    const size_t chunk = (n + nthreads - 1) / nthreads;
+    std::vector<std::exception_ptr> errors(nthreads);
+    auto run_chunk = [&](size_t ithread) {
+        const size_t ibegin = std::min(n, ithread * chunk);
+        const size_t iend = std::min(n, ibegin + chunk);
+        try {
+            func(ithread, ibegin, iend);
+        } catch (...) {
+            errors[ithread] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(nthreads - 1);
+    for (size_t ithread = 1; ithread < nthreads; ++ithread) {
+        threads.push_back(std::thread(run_chunk, ithread));
+    }
+    run_chunk(0);
+    for (auto & t : threads) {
+        t.join();
+    }
+    for (auto const & e : errors) {
+        if (e) {
+            std::rethrow_exception(e);
+        }
+    }
+}
+
+} // namespace pele
+
+#endif // #ifndef _PELE_PARALLEL_H_
@@ -0,0 +1,137 @@
+#ifndef _PELE_PRECONDITIONER_H_
+#define _PELE_PRECONDITIONER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+
+#include "array.h"
+#include "base_potential.h"
+
+namespace pele {
+
+/**
+ * Approximation M of the Hessian used by the optimizers to rescale the
+ * degrees of freedom.
+ *
+ * LBFGS uses H0 * M^-1 instead of the scalar H0 as the initial estimate of
+ * the inverse Hessian, so M only needs to get the relative stiffness of the
+ * degrees of freedom right.  The overall scale is still adapted by H0.
+ */
+class Preconditioner {
+public:
+    virtual ~Preconditioner() {}
+
+    /**
+     * called by the optimizer with the current coordinates and gradient before
+     * M is used in an iteration.  Preconditioners which depend on the
+     * coordinates recompute M here.
+     */
+    virtual void update(Array<double> const &, Array<double> const &) {}
+
+    /**
+     * replace v by M^-1 v
+     */
+    virtual void apply(Array<double> v) const = 0;
+};
+
+/**
+ * Preconditioner with a diagonal M
+ */
+class DiagonalPreconditioner : public Preconditioner {
+protected:
+    Array<double> m_inverse_diagonal;
+public:
+    DiagonalPreconditioner() {}
+
+    DiagonalPreconditioner(Array<double> const & diagonal)
+    {
+        set_diagonal(diagonal);
+    }
+
+    /**
+     * set the diagonal of M.  All elements must be positive
+     */
+    void set_diagonal(Array<double> const & diagonal)
+    {
+        if (m_inverse_diagonal.size() != diagonal.size()) {
+            m_inverse_diagonal = Array<double>(diagonal.size());
+        }
+        for (size_t i = 0; i < diagonal.size(); ++i) {
+            if (! (diagonal[i] > 0)) {
+                throw std::invalid_argument("DiagonalPreconditioner: the diagonal must be positive");
+            }
+            m_inverse_diagonal[i] = 1. / diagonal[i];
+        }
+    }
+
+    Array<double> get_inverse_diagonal() const { return m_inverse_diagonal.copy(); }
+
+    virtual void apply(Array<double> v) const
+    {
+        if (v.size() != m_inverse_diagonal.size()) {
+            throw std::invalid_argument("DiagonalPreconditioner: v has the wrong size");
+        }
+        for (size_t i = 0; i < v.size(); ++i) {
+            v[i] *= m_inverse_diagonal[i];
+        }
+    }
+};
+
+/**
+ * Diagonal preconditioner from the diagonal of the Hessian of a potential
+ *
+ * The diagonal is recomputed with get_hessian_diagonal every
+ * update_interval calls of update().  Elements which are negative or very
+ * small, e.g. for atoms without neighbours or near saddles, are raised to
+ * min_fraction times the mean of the absolute values of the diagonal.
+ */
+class HessianDiagonalPreconditioner : public DiagonalPreconditioner {
+protected:
+    std::shared_ptr<BasePotential> m_potential;
+    size_t m_update_interval;
+    double m_min_fraction;
+    size_t m_nr_calls;
+    Array<double> m_diagonal;
+public:
+    HessianDiagonalPreconditioner(std::shared_ptr<BasePotential> potential,
+            size_t update_interval=20, double min_fraction=0.1)
+        : m_potential(potential),
+          m_update_interval(update_interval),
+          m_min_fraction(min_fraction),
+          m_nr_calls(0)
+    {
+        if (m_update_interval == 0) {
+            throw std::invalid_argument("HessianDiagonalPreconditioner: update_interval must be positive");
+        }
+        if (m_min_fraction <= 0) {
+            throw std::invalid_argument("HessianDiagonalPreconditioner: min_fraction must be positive");
+        }
+    }
+
+    virtual void update(Array<double> const & x, Array<double> const &)
+    {
+        if (m_nr_calls++ % m_update_interval != 0 && m_diagonal.size() == x.size()) {
+            return;
+        }
+        if (m_diagonal.size() != x.size()) {
+            m_diagonal = Array<double>(x.size());
+        }
+        m_potential->get_hessian_diagonal(x, m_diagonal);
+        double mean = 0;
+        for (double const d : m_diagonal) {
+            mean += std::fabs(d);
+        }
+        mean /= m_diagonal.size();
+        const double dmin = (mean > 0) ? m_min_fraction * mean : 1.;
+        for (double & d : m_diagonal) {
+            d = std::max(d, dmin);
+        }
+        set_diagonal(m_diagonal);
+    }
+};
+
+} // namespace pele
+
+#endif // #ifndef _PELE_PRECONDITIONER_H_
@@ -4,7 +4,12 @@
 #include "base_potential.h"
 #include "array.h"
 #include "distance.h"
+#include "energy_change.h"
+#include "pairwise_batch.h"
+#include "sparse_hessian.h"
 #include <memory>
+#include <type_traits>
+#include <vector>
 
 namespace pele {
 
@@ -54,6 +59,7 @@ protected:
     static const size_t m_ndim = distance_policy::_ndim;
     std::shared_ptr<pairwise_interaction> _interaction;
     std::shared_ptr<distance_policy> _dist;
+    BatchWorkspace _batch_workspace; // scratch memory of the batched loops
 
     SimplePairwisePotential( std::shared_ptr<pairwise_interaction> interaction,
             std::shared_ptr<distance_policy> dist=NULL) 
@@ -66,6 +72,10 @@ public:
     virtual ~SimplePairwisePotential() 
     {}
     virtual inline size_t get_ndim() const { return m_ndim; }
+    /**
+     * the energy functions only read the interaction and distance policy
+     */
+    virtual bool can_run_concurrently() const { return true; }
 
     virtual double get_energy(Array<double> x);
     virtual double get_energy_gradient(Array<double> x, Array<double> grad)
@@ -81,6 +91,45 @@ public:
     }
     virtual double add_energy_gradient(Array<double> x, Array<double> grad);
     virtual double add_energy_gradient_hessian(Array<double> x, Array<double> grad, Array<double> hess);
+    /**
+     * compute the energy, gradient and the Hessian as a block sparse matrix
+     * with ndim x ndim blocks.  Pairs with zero interaction are not stored.
+     */
+    virtual double get_energy_gradient_sparse_hessian(Array<double> x, Array<double> grad,
+            BlockSparseMatrix & hess);
+    /**
+     * compute the product of the Hessian with v analytically, one pair at a time
+     */
+    virtual void get_hessian_vector_product(Array<double> x, Array<double> v, Array<double> out)
+    {
+        out.assign(0.);
+        add_hessian_vector_product(x, v, out);
+    }
+    virtual void add_hessian_vector_product(Array<double> x, Array<double> v, Array<double> out);
+    /**
+     * compute the diagonal of the Hessian analytically
+     */
+    virtual void get_hessian_diagonal(Array<double> x, Array<double> diag);
+
+    /**
+     * return the energy change when the atoms in changed_atoms move.
+     *
+     * Only the pairs involving a moved atom are computed, i.e. this is
+     * O(natoms) per moved atom.
+     */
+    virtual double get_energy_change(Array<double> x_old, Array<double> x_new,
+            Array<size_t> changed_atoms)
+    {
+        return energy_change<false>(x_old, x_new, changed_atoms, NULL);
+    }
+    virtual double get_energy_gradient_change(Array<double> x_old, Array<double> x_new,
+            Array<size_t> changed_atoms, Array<double> grad)
+    {
+        if (grad.size() != x_old.size()) {
+            throw std::invalid_argument("the gradient has the wrong size");
+        }
+        return energy_change<true>(x_old, x_new, changed_atoms, grad.data());
+    }
     virtual inline void get_rij(double * const r_ij, double const * const r1, double const * const r2) const
     {
         return _dist->get_rij(r_ij, r1, r2);
@@ -89,8 +138,68 @@ public:
     {
         return _interaction->energy_gradient(r2, gij, atom_i, atom_j);
     }
+
+protected:
+    /**
+     * The energy and gradient are computed with the batched loops in
+     * pairwise_batch.h if the interaction supports them, otherwise one pair
+     * at a time.  The choice is made at compile time with the tag
+     * use_batch_kernel<pairwise_interaction, distance_policy>.
+     */
+    typedef use_batch_kernel<pairwise_interaction, distance_policy> batch_tag;
+    double get_energy_impl(Array<double> x, std::true_type)
+    {
+        const size_t natoms = x.size() / m_ndim;
+        BatchWorkspace::Buffer work(_batch_workspace, batch_energy_work_size<m_ndim>(natoms));
+        return batch_pairwise_energy<m_ndim>(*_interaction, x.data(), natoms, work.data());
+    }
+    double get_energy_impl(Array<double> x, std::false_type);
+    double add_energy_gradient_impl(Array<double> x, Array<double> grad, std::true_type)
+    {
+        const size_t natoms = x.size() / m_ndim;
+        BatchWorkspace::Buffer work(_batch_workspace, batch_gradient_work_size<m_ndim>(natoms));
+        return batch_pairwise_add_energy_gradient<m_ndim>(*_interaction, x.data(),
+                grad.data(), natoms, work.data());
+    }
+    double add_energy_gradient_impl(Array<double> x, Array<double> grad, std::false_type);
+
+    template <bool with_gradient>
+    double energy_change(Array<double> x_old, Array<double> x_new,
+            Array<size_t> changed_atoms, double * grad);
 };
 
+/**
+ * subtract the old and add the new contribution of every pair with at least
+ * one moved atom.  A pair of two moved atoms is done only when the outer
+ * loop is at the atom with the smaller index.
+ */
+template<typename pairwise_interaction, typename distance_policy>
+template<bool with_gradient>
+inline double
+SimplePairwisePotential<pairwise_interaction, distance_policy>::energy_change(
+        Array<double> x_old, Array<double> x_new, Array<size_t> changed_atoms,
+        double * grad)
+{
+    const size_t natoms = x_old.size() / m_ndim;
+    std::vector<char> moved(natoms, 0);
+    mark_changed_atoms(x_old, x_new, changed_atoms, m_ndim, moved);
+    double const * const xo = x_old.data();
+    double const * const xn = x_new.data();
+    double de = 0;
+    for (size_t const atomi : changed_atoms) {
+        for (size_t atomj = 0; atomj < natoms; ++atomj) {
+            if (atomj == atomi || (moved[atomj] && atomj < atomi)) {
+                continue;
+            }
+            de -= pair_energy_change<with_gradient>(*_interaction, *_dist,
+                    xo + m_ndim * atomi, xo + m_ndim * atomj, atomi, atomj, grad, -1.);
+            de += pair_energy_change<with_gradient>(*_interaction, *_dist,
+                    xn + m_ndim * atomi, xn + m_ndim * atomj, atomi, atomj, grad, 1.);
+        }
+    }
+    return de;
+}
+
 template<typename pairwise_interaction, typename distance_policy>
 inline double
 SimplePairwisePotential<pairwise_interaction,distance_policy>::add_energy_gradient(
@@ -103,7 +212,15 @@ SimplePairwisePotential<pairwise_interaction,distance_policy>::add_energy_gradie
     if (grad.size() != x.size()) {
         throw std::runtime_error("grad must have the same size as x");
     }
+    return add_energy_gradient_impl(x, grad, batch_tag());
+}
 
+template<typename pairwise_interaction, typename distance_policy>
+inline double
+SimplePairwisePotential<pairwise_interaction,distance_policy>::add_energy_gradient_impl(
+        Array<double> x, Array<double> grad, std::false_type)
+{
+    const size_t natoms = x.size() / m_ndim;
     double e = 0.;
     double gij;
     double dr[m_ndim];
@@ -198,6 +315,111 @@ inline double SimplePairwisePotential<pairwise_interaction, distance_policy>::ad
     return e;
 }
 
+template<typename pairwise_interaction, typename distance_policy>
+inline double SimplePairwisePotential<pairwise_interaction, distance_policy>::get_energy_gradient_sparse_hessian(
+        Array<double> x, Array<double> grad, BlockSparseMatrix & hess)
+{
+    double hij, gij;
+    double dr[m_ndim];
+    double block[m_ndim * m_ndim];
+    const size_t natoms = x.size()/m_ndim;
+    if (m_ndim * natoms != x.size()) {
+        throw std::runtime_error("x is not divisible by the number of dimensions");
+    }
+    if (x.size() != grad.size()) {
+        throw std::invalid_argument("the gradient has the wrong size");
+    }
+    grad.assign(0.);
+    SparseHessianBuilder<m_ndim> builder(natoms);
+
+    double e = 0.;
+    for (size_t atomi=0; atomi<natoms; ++atomi) {
+        const size_t i1 = m_ndim*atomi;
+        for (size_t atomj=0;atomj<atomi;++atomj){
+            const size_t j1 = m_ndim*atomj;
+            _dist->get_rij(dr, &x[i1], &x[j1]);
+            double r2 = 0;
+            for (size_t k=0;k<m_ndim;++k){r2 += dr[k]*dr[k];}
+
+            e += _interaction->energy_gradient_hessian(r2, &gij, &hij, atomi, atomj);
+            if (gij == 0 && hij == 0) {
+                continue;
+            }
+
+            for (size_t k=0; k<m_ndim; ++k)
+                grad[i1+k] -= gij * dr[k];
+            for (size_t k=0; k<m_ndim; ++k)
+                grad[j1+k] += gij * dr[k];
+
+            pair_hessian_block<m_ndim>(gij, hij, dr, r2, block);
+            builder.add_pair(atomi, atomj, block);
+        }
+    }
+    hess = builder.assemble();
+    return e;
+}
+
+template<typename pairwise_interaction, typename distance_policy>
+inline void SimplePairwisePotential<pairwise_interaction, distance_policy>::add_hessian_vector_product(
+        Array<double> x, Array<double> v, Array<double> out)
+{
+    double hij, gij;
+    double dr[m_ndim];
+    const size_t natoms = x.size()/m_ndim;
+    if (m_ndim * natoms != x.size()) {
+        throw std::runtime_error("x is not divisible by the number of dimensions");
+    }
+    if (x.size() != v.size() || x.size() != out.size()) {
+        throw std::invalid_argument("v and out must have the same size as x");
+    }
+
+    for (size_t atomi=0; atomi<natoms; ++atomi) {
+        const size_t i1 = m_ndim*atomi;
+        for (size_t atomj=0;atomj<atomi;++atomj){
+            const size_t j1 = m_ndim*atomj;
+            _dist->get_rij(dr, &x[i1], &x[j1]);
+            double r2 = 0;
+            for (size_t k=0;k<m_ndim;++k){r2 += dr[k]*dr[k];}
+
+            _interaction->energy_gradient_hessian(r2, &gij, &hij, atomi, atomj);
+            pair_hessian_vector_product<m_ndim>(gij, hij, dr, r2, &v[i1], &v[j1], &out[i1], &out[j1]);
+        }
+    }
+}
+
+template<typename pairwise_interaction, typename distance_policy>
+inline void SimplePairwisePotential<pairwise_interaction, distance_policy>::get_hessian_diagonal(
+        Array<double> x, Array<double> diag)
+{
+    double hij, gij;
+    double dr[m_ndim];
+    const size_t natoms = x.size()/m_ndim;
+    if (m_ndim * natoms != x.size()) {
+        throw std::runtime_error("x is not divisible by the number of dimensions");
+    }
+    if (x.size() != diag.size()) {
+        throw std::invalid_argument("diag must have the same size as x");
+    }
+
+    diag.assign(0.);
+    for (size_t atomi=0; atomi<natoms; ++atomi) {
+        const size_t i1 = m_ndim*atomi;
+        for (size_t atomj=0;atomj<atomi;++atomj){
+            const size_t j1 = m_ndim*atomj;
+            _dist->get_rij(dr, &x[i1], &x[j1]);
+            double r2 = 0;
+            for (size_t k=0;k<m_ndim;++k){r2 += dr[k]*dr[k];}
+
+            _interaction->energy_gradient_hessian(r2, &gij, &hij, atomi, atomj);
+            for (size_t k=0;k<m_ndim;++k){
+                const double d = (hij + gij) * dr[k] * dr[k] / r2 - gij;
+                diag[i1+k] += d;
+                diag[j1+k] += d;
+            }
+        }
+    }
+}
+
 template<typename pairwise_interaction, typename distance_policy>
 inline double SimplePairwisePotential<pairwise_interaction, distance_policy>::get_energy(Array<double> x)
 {
@@ -205,6 +427,14 @@ inline double SimplePairwisePotential<pairwise_interaction, distance_policy>::ge
     if (m_ndim * natoms != x.size()) {
         throw std::runtime_error("x is not divisible by the number of dimensions");
     }
+    return get_energy_impl(x, batch_tag());
+}
+
+template<typename pairwise_interaction, typename distance_policy>
+inline double SimplePairwisePotential<pairwise_interaction, distance_policy>::get_energy_impl(
+        Array<double> x, std::false_type)
+{
+    size_t const natoms = x.size()/m_ndim;
     double e=0.;
     double dr[m_ndim];
 
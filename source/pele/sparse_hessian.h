@@ -0,0 +1,300 @@
+#ifndef _PELE_SPARSE_HESSIAN_H_
+#define _PELE_SPARSE_HESSIAN_H_
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "array.h"
+
+namespace pele {
+
+/**
+ * block compressed sparse row matrix with square blocks
+ *
+ * The layout is the same as the one of scipy.sparse.bsr_matrix: the blocks of
+ * block row i are m_data[indptr[i]] ... m_data[indptr[i+1]-1], their block
+ * columns are indices[indptr[i]] ... and each block is stored row major.
+ * Within a block row the blocks are sorted by column.
+ */
+class BlockSparseMatrix {
+protected:
+    size_t m_block_size;
+    size_t m_nr_block_rows;
+    pele::Array<size_t> m_indptr;
+    pele::Array<size_t> m_indices;
+    pele::Array<double> m_data;
+public:
+    BlockSparseMatrix()
+        : m_block_size(1),
+          m_nr_block_rows(0),
+          m_indptr(1, 0)
+    {}
+
+    BlockSparseMatrix(size_t block_size, size_t nr_block_rows,
+            pele::Array<size_t> indptr, pele::Array<size_t> indices,
+            pele::Array<double> data)
+        : m_block_size(block_size),
+          m_nr_block_rows(nr_block_rows),
+          m_indptr(indptr),
+          m_indices(indices),
+          m_data(data)
+    {
+        if (m_indptr.size() != m_nr_block_rows + 1) {
+            throw std::invalid_argument("BlockSparseMatrix: indptr has the wrong size");
+        }
+        if (m_indices.size() != m_indptr[m_nr_block_rows]
+                || m_data.size() != m_indices.size() * m_block_size * m_block_size) {
+            throw std::invalid_argument("BlockSparseMatrix: indices or data have the wrong size");
+        }
+    }
+
+    /**
+     * convert a dense matrix, dropping the blocks which are zero
+     */
+    static BlockSparseMatrix from_dense(pele::Array<double> const & dense,
+            size_t const nrows, size_t const block_size)
+    {
+        if (dense.size() != nrows * nrows || nrows % block_size != 0) {
+            throw std::invalid_argument("BlockSparseMatrix::from_dense: illegal input");
+        }
+        const size_t nb = nrows / block_size;
+        const size_t b2 = block_size * block_size;
+        std::vector<size_t> indptr(1, 0), indices;
+        std::vector<double> data;
+        for (size_t ib = 0; ib < nb; ++ib) {
+            for (size_t jb = 0; jb < nb; ++jb) {
+                bool nonzero = false;
+                for (size_t k = 0; k < block_size && ! nonzero; ++k) {
+                    for (size_t l = 0; l < block_size; ++l) {
+                        if (dense[nrows * (ib * block_size + k) + jb * block_size + l] != 0) {
+                            nonzero = true;
+                            break;
+                        }
+                    }
+                }
+                if (! nonzero) {
+                    continue;
+                }
+                indices.push_back(jb);
+                for (size_t k = 0; k < block_size; ++k) {
+                    for (size_t l = 0; l < block_size; ++l) {
+                        data.push_back(dense[nrows * (ib * block_size + k) + jb * block_size + l]);
+                    }
+                }
+            }
+            indptr.push_back(indices.size());
+        }
+        pele::Array<size_t> indptr_array(indptr.size());
+        pele::Array<size_t> indices_array(indices.size());
+        pele::Array<double> data_array(indices.size() * b2);
+        std::copy(indptr.begin(), indptr.end(), indptr_array.begin());
+        std::copy(indices.begin(), indices.end(), indices_array.begin());
+        std::copy(data.begin(), data.end(), data_array.begin());
+        return BlockSparseMatrix(block_size, nb, indptr_array, indices_array, data_array);
+    }
+
+    size_t block_size() const { return m_block_size; }
+    size_t nr_block_rows() const { return m_nr_block_rows; }
+    size_t nr_rows() const { return m_block_size * m_nr_block_rows; }
+    /** return the number of stored blocks */
+    size_t nr_blocks() const { return m_indices.size(); }
+
+    pele::Array<size_t> indptr() const { return m_indptr; }
+    pele::Array<size_t> indices() const { return m_indices; }
+    pele::Array<double> data() const { return m_data; }
+
+    /**
+     * return element (i, j) of the matrix
+     */
+    double get(size_t const i, size_t const j) const
+    {
+        const size_t ib = i / m_block_size;
+        const size_t jb = j / m_block_size;
+        size_t const * const begin = m_indices.data() + m_indptr[ib];
+        size_t const * const end = m_indices.data() + m_indptr[ib + 1];
+        size_t const * const iter = std::lower_bound(begin, end, jb);
+        if (iter == end || *iter != jb) {
+            return 0;
+        }
+        const size_t iblock = iter - m_indices.data();
+        return m_data[m_block_size * (m_block_size * iblock + i % m_block_size) + j % m_block_size];
+    }
+
+    /**
+     * compute out = M * v
+     */
+    void multiply(pele::Array<double> const & v, pele::Array<double> out) const
+    {
+        if (v.size() != nr_rows() || out.size() != nr_rows()) {
+            throw std::invalid_argument("BlockSparseMatrix::multiply: illegal input");
+        }
+        const size_t b = m_block_size;
+        for (size_t ib = 0; ib < m_nr_block_rows; ++ib) {
+            double * const out_i = out.data() + b * ib;
+            for (size_t k = 0; k < b; ++k) {
+                out_i[k] = 0;
+            }
+            for (size_t iblock = m_indptr[ib]; iblock < m_indptr[ib + 1]; ++iblock) {
+                double const * const block = m_data.data() + b * b * iblock;
+                double const * const v_j = v.data() + b * m_indices[iblock];
+                for (size_t k = 0; k < b; ++k) {
+                    for (size_t l = 0; l < b; ++l) {
+                        out_i[k] += block[b * k + l] * v_j[l];
+                    }
+                }
+            }
+        }
+    }
+};
+
+/**
+ * collect the Hessian of a pairwise potential and assemble it into a
+ * BlockSparseMatrix with ndim x ndim blocks.
+ *
+ * A pair of atoms i, j with Hessian block B (the second derivative of the
+ * pair energy with respect to x_i twice) contributes B to the diagonal
+ * blocks (i, i) and (j, j) and -B to the blocks (i, j) and (j, i).  Each
+ * pair may only be added once.
+ */
+template <size_t ndim>
+class SparseHessianBuilder {
+    static const size_t m_block_size2 = ndim * ndim;
+    size_t m_natoms;
+    std::vector<double> m_diagonal_blocks;
+    std::vector<std::pair<size_t, size_t> > m_pairs;
+    std::vector<double> m_pair_blocks;
+public:
+    SparseHessianBuilder(size_t natoms)
+        : m_natoms(natoms),
+          m_diagonal_blocks(natoms * m_block_size2, 0.)
+    {}
+
+    size_t get_natoms() const { return m_natoms; }
+
+    /**
+     * add the Hessian block of the pair of atoms i, j
+     */
+    void add_pair(size_t const i, size_t const j, double const * const block)
+    {
+        for (size_t k = 0; k < m_block_size2; ++k) {
+            m_diagonal_blocks[m_block_size2 * i + k] += block[k];
+            m_diagonal_blocks[m_block_size2 * j + k] += block[k];
+        }
+        m_pairs.push_back(std::make_pair(i, j));
+        m_pair_blocks.insert(m_pair_blocks.end(), block, block + m_block_size2);
+    }
+
+    /**
+     * add the pairs collected by another builder, e.g. from another thread
+     */
+    void merge(SparseHessianBuilder<ndim> const & other)
+    {
+        for (size_t k = 0; k < m_diagonal_blocks.size(); ++k) {
+            m_diagonal_blocks[k] += other.m_diagonal_blocks[k];
+        }
+        m_pairs.insert(m_pairs.end(), other.m_pairs.begin(), other.m_pairs.end());
+        m_pair_blocks.insert(m_pair_blocks.end(), other.m_pair_blocks.begin(),
+                other.m_pair_blocks.end());
+    }
+
+    /**
+     * build the block sparse matrix
+     */
+    BlockSparseMatrix assemble() const
+    {
+        // count the blocks in each block row: the diagonal plus one per pair
+        pele::Array<size_t> indptr(m_natoms + 1, 0);
+        for (size_t i = 0; i < m_natoms; ++i) {
+            indptr[i + 1] = 1;
+        }
+        for (auto const & ijpair : m_pairs) {
+            ++indptr[ijpair.first + 1];
+            ++indptr[ijpair.second + 1];
+        }
+        for (size_t i = 0; i < m_natoms; ++i) {
+            indptr[i + 1] += indptr[i];
+        }
+        // for each stored block the column and where its values come from.
+        // source m_pairs.size() + i is the diagonal block of atom i
+        const size_t nblocks = indptr[m_natoms];
+        std::vector<std::pair<size_t, size_t> > column_source(nblocks);
+        std::vector<size_t> next(indptr.begin(), indptr.end() - 1);
+        for (size_t i = 0; i < m_natoms; ++i) {
+            column_source[next[i]++] = std::make_pair(i, m_pairs.size() + i);
+        }
+        for (size_t ipair = 0; ipair < m_pairs.size(); ++ipair) {
+            const size_t i = m_pairs[ipair].first;
+            const size_t j = m_pairs[ipair].second;
+            column_source[next[i]++] = std::make_pair(j, ipair);
+            column_source[next[j]++] = std::make_pair(i, ipair);
+        }
+        pele::Array<size_t> indices(nblocks);
+        pele::Array<double> data(nblocks * m_block_size2);
+        for (size_t i = 0; i < m_natoms; ++i) {
+            std::sort(column_source.begin() + indptr[i], column_source.begin() + indptr[i + 1]);
+            for (size_t iblock = indptr[i]; iblock < indptr[i + 1]; ++iblock) {
+                const size_t source = column_source[iblock].second;
+                indices[iblock] = column_source[iblock].first;
+                double * const out = data.data() + m_block_size2 * iblock;
+                if (source >= m_pairs.size()) {
+                    std::copy(m_diagonal_blocks.begin() + m_block_size2 * i,
+                            m_diagonal_blocks.begin() + m_block_size2 * (i + 1), out);
+                } else {
+                    for (size_t k = 0; k < m_block_size2; ++k) {
+                        out[k] = -m_pair_blocks[m_block_size2 * source + k];
+                    }
+                }
+            }
+        }
+        return BlockSparseMatrix(ndim, m_natoms, indptr, indices, data);
+    }
+};
+
+/**
+ * compute the ndim x ndim Hessian block of a pair interaction
+ *
+ * gij and hij are as returned by the interaction's energy_gradient_hessian,
+ * dr is the separation vector and r2 its square.
+ */
+template <size_t ndim>
+inline void pair_hessian_block(const double gij, const double hij, double const * const dr,
+        const double r2, double * const block)
+{
+    for (size_t k = 0; k < ndim; ++k) {
+        for (size_t l = 0; l < ndim; ++l) {
+            block[ndim * k + l] = (hij + gij) * dr[k] * dr[l] / r2;
+        }
+        block[ndim * k + k] -= gij;
+    }
+}
+
+/**
+ * add the product of the Hessian of a pair interaction with v to out
+ *
+ * With B the Hessian block of the pair (see pair_hessian_block) this adds
+ * B (v_i - v_j) to out_i and subtracts it from out_j.
+ */
+template <size_t ndim>
+inline void pair_hessian_vector_product(const double gij, const double hij,
+        double const * const dr, const double r2, double const * const v_i,
+        double const * const v_j, double * const out_i, double * const out_j)
+{
+    double w[ndim];
+    double drw = 0;
+    for (size_t k = 0; k < ndim; ++k) {
+        w[k] = v_i[k] - v_j[k];
+        drw += dr[k] * w[k];
+    }
+    const double c = (hij + gij) * drw / r2;
+    for (size_t k = 0; k < ndim; ++k) {
+        const double bw = c * dr[k] - gij * w[k];
+        out_i[k] += bw;
+        out_j[k] -= bw;
+    }
+}
+
+} // namespace pele
+
+#endif // #ifndef _PELE_SPARSE_HESSIAN_H_
@@ -0,0 +1,103 @@
+#ifndef _PELE_SPATIAL_SORT_H_
+#define _PELE_SPATIAL_SORT_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "array.h"
+
+namespace pele {
+
+/**
+ * return the order of the atoms along a Morton (z-order) curve
+ *
+ * The coordinates are scaled to their bounding box and quantized to nbits
+ * bits per dimension.  The bits of the dimensions are interleaved to form the
+ * key the atoms are sorted by, so atoms which are close in space are mostly
+ * close in the returned order.  order[i] is the index of the i'th atom along
+ * the curve.
+ */
+template <size_t ndim>
+inline std::vector<size_t> morton_order(pele::Array<double> const & x)
+{
+    const size_t natoms = x.size() / ndim;
+    const size_t nbits = std::min<size_t>(21, 63 / ndim);
+    double xmin[ndim];
+    double scale[ndim];
+    for (size_t k = 0; k < ndim; ++k) {
+        double lo = 0, hi = 0;
+        if (natoms > 0) {
+            lo = hi = x[k];
+        }
+        for (size_t i = 0; i < natoms; ++i) {
+            lo = std::min(lo, x[ndim * i + k]);
+            hi = std::max(hi, x[ndim * i + k]);
+        }
+        xmin[k] = lo;
+        scale[k] = (hi > lo) ? ((uint64_t(1) << nbits) - 1) / (hi - lo) : 0;
+    }
+    std::vector<std::pair<uint64_t, size_t> > keys(natoms);
+    for (size_t i = 0; i < natoms; ++i) {
+        uint64_t q[ndim];
+        for (size_t k = 0; k < ndim; ++k) {
+            q[k] = uint64_t((x[ndim * i + k] - xmin[k]) * scale[k]);
+        }
+        uint64_t key = 0;
+        for (size_t bit = nbits; bit-- > 0;) {
+            for (size_t k = 0; k < ndim; ++k) {
+                key = (key << 1) | ((q[k] >> bit) & 1);
+            }
+        }
+        keys[i] = std::make_pair(key, i);
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<size_t> order(natoms);
+    for (size_t i = 0; i < natoms; ++i) {
+        order[i] = keys[i].second;
+    }
+    return order;
+}
+
+/**
+ * wrap a pairwise interaction for atoms which have been renumbered
+ *
+ * The interaction is called with the original atom indices order[i] and
+ * order[j], so interactions which depend on the atom index, e.g. through the
+ * radii, keep working.  order is shared, not copied, so it can be updated in
+ * place.
+ */
+template <class pairwise_interaction>
+class IndexMappedInteraction {
+    std::shared_ptr<pairwise_interaction> m_interaction;
+    pele::Array<size_t> m_order;
+public:
+    IndexMappedInteraction(std::shared_ptr<pairwise_interaction> interaction,
+            pele::Array<size_t> order)
+        : m_interaction(interaction),
+          m_order(order)
+    {}
+
+    double energy(double r2, size_t atomi, size_t atomj) const
+    {
+        return m_interaction->energy(r2, m_order[atomi], m_order[atomj]);
+    }
+
+    double energy_gradient(double r2, double *gij, size_t atomi, size_t atomj) const
+    {
+        return m_interaction->energy_gradient(r2, gij, m_order[atomi], m_order[atomj]);
+    }
+
+    double energy_gradient_hessian(double r2, double *gij, double *hij, size_t atomi,
+            size_t atomj) const
+    {
+        return m_interaction->energy_gradient_hessian(r2, gij, hij, m_order[atomi],
+                m_order[atomj]);
+    }
+};
+
+} // namespace pele
+
+#endif // #ifndef _PELE_SPATIAL_SORT_H_
@@ -0,0 +1,242 @@
+#ifndef _PELE_TABULATED_INTERACTION_H_
+#define _PELE_TABULATED_INTERACTION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "array.h"
+
+namespace pele {
+
+/**
+ * Pairwise interaction which interpolates another pairwise interaction from
+ * tables.
+ *
+ * The energy E and gij = -(dE/dr)/r of base_interaction are sampled on a
+ * uniform grid in s = r^2 between rmin^2 and rcut^2 and interpolated with
+ * cubic Hermite splines, using dE/ds = -gij/2 and dgij/ds = -(hij+gij)/(2s)
+ * from energy_gradient_hessian as the slopes.  hij follows from the slope of
+ * the gij spline.  The grid is refined until the interpolation error at
+ * points between the nodes is below tol * (1 + |exact value|) for both E and
+ * gij.  Outside [rmin, rcut) base_interaction is called directly.
+ *
+ * This replaces expensive functions like std::pow or exp in the innermost
+ * loop by a table lookup, and can be used with any of the pairwise
+ * potentials in place of base_interaction.
+ *
+ * The base interaction is sampled for one representative atom of each atom
+ * type, so it may depend on the atom indices only through the types given in
+ * atom_types, e.g. the radii of a bidisperse system.  Without atom_types all
+ * pairs are assumed to be equal and the pair (0, 0) is sampled.
+ */
+template <class base_interaction>
+class TabulatedInteraction {
+protected:
+    std::shared_ptr<base_interaction> m_base;
+    double m_r2min;
+    double m_r2max;
+    double m_h; /**< grid spacing in r^2 */
+    double m_inv_h;
+    size_t m_npoints;
+    size_t m_ntypes;
+    pele::Array<size_t> m_atom_types;
+    std::vector<size_t> m_type_atom; /**< a representative atom for each type */
+    /**
+     * for each pair of types and each node: E, h dE/ds, gij, h dgij/ds.
+     * The slopes are stored multiplied by the grid spacing h.
+     */
+    std::vector<double> m_table;
+
+    static const size_t m_stride = 4;
+
+public:
+    TabulatedInteraction(std::shared_ptr<base_interaction> base, double rmin,
+            double rcut, double tol=1e-8)
+        : m_base(base),
+          m_ntypes(1),
+          m_type_atom(1, 0)
+    {
+        build(rmin, rcut, tol);
+    }
+
+    TabulatedInteraction(std::shared_ptr<base_interaction> base, double rmin,
+            double rcut, double tol, pele::Array<size_t> const atom_types)
+        : m_base(base),
+          m_ntypes(0),
+          m_atom_types(atom_types.copy())
+    {
+        for (size_t const t : m_atom_types) {
+            m_ntypes = std::max(m_ntypes, t + 1);
+        }
+        m_type_atom.assign(m_ntypes, m_atom_types.size());
+        for (size_t i = m_atom_types.size(); i-- > 0;) {
+            m_type_atom[m_atom_types[i]] = i;
+        }
+        for (size_t const iatom : m_type_atom) {
+            if (iatom == m_atom_types.size()) {
+                throw std::invalid_argument("TabulatedInteraction: the atom types must be 0, 1, ..., ntypes-1");
+            }
+        }
+        build(rmin, rcut, tol);
+    }
+
+    /**
+     * return the number of grid points of each table
+     */
+    size_t get_nr_points() const { return m_npoints; }
+
+    double energy(double r2, size_t atomi, size_t atomj) const
+    {
+        if (r2 < m_r2min || r2 >= m_r2max) {
+            return m_base->energy(r2, atomi, atomj);
+        }
+        double u;
+        double const * const p = lookup(r2, atomi, atomj, u);
+        return hermite(p[0], p[1], p[m_stride], p[m_stride + 1], u);
+    }
+
+    double energy_gradient(double r2, double *gij, size_t atomi, size_t atomj) const
+    {
+        if (r2 < m_r2min || r2 >= m_r2max) {
+            return m_base->energy_gradient(r2, gij, atomi, atomj);
+        }
+        double u;
+        double const * const p = lookup(r2, atomi, atomj, u);
+        *gij = hermite(p[2], p[3], p[m_stride + 2], p[m_stride + 3], u);
+        return hermite(p[0], p[1], p[m_stride], p[m_stride + 1], u);
+    }
+
+    double energy_gradient_hessian(double r2, double *gij, double *hij, size_t atomi,
+            size_t atomj) const
+    {
+        if (r2 < m_r2min || r2 >= m_r2max) {
+            return m_base->energy_gradient_hessian(r2, gij, hij, atomi, atomj);
+        }
+        double u;
+        double const * const p = lookup(r2, atomi, atomj, u);
+        *gij = hermite(p[2], p[3], p[m_stride + 2], p[m_stride + 3], u);
+        const double dgds = hermite_derivative(p[2], p[3], p[m_stride + 2], p[m_stride + 3], u) * m_inv_h;
+        *hij = -*gij - 2 * r2 * dgds;
+        return hermite(p[0], p[1], p[m_stride], p[m_stride + 1], u);
+    }
+
+protected:
+    /**
+     * return a pointer to the left node of the interval containing r2 and the
+     * position u in [0, 1) within the interval
+     */
+    double const * lookup(double r2, size_t atomi, size_t atomj, double & u) const
+    {
+        const double t = (r2 - m_r2min) * m_inv_h;
+        const size_t inode = std::min(size_t(t), m_npoints - 2);
+        u = t - inode;
+        size_t itable = 0;
+        if (m_ntypes > 1) {
+            itable = pair_index(m_atom_types[atomi], m_atom_types[atomj]);
+        }
+        return m_table.data() + m_stride * (m_npoints * itable + inode);
+    }
+
+    size_t pair_index(size_t ti, size_t tj) const
+    {
+        if (ti > tj) {
+            std::swap(ti, tj);
+        }
+        return ti * m_ntypes + tj;
+    }
+
+    static double hermite(double p0, double m0, double p1, double m1, double u)
+    {
+        const double u2 = u * u;
+        const double u3 = u2 * u;
+        return (2 * u3 - 3 * u2 + 1) * p0 + (u3 - 2 * u2 + u) * m0
+                + (-2 * u3 + 3 * u2) * p1 + (u3 - u2) * m1;
+    }
+
+    /**
+     * derivative with respect to u
+     */
+    static double hermite_derivative(double p0, double m0, double p1, double m1, double u)
+    {
+        const double u2 = u * u;
+        return (6 * u2 - 6 * u) * (p0 - p1) + (3 * u2 - 4 * u + 1) * m0 + (3 * u2 - 2 * u) * m1;
+    }
+
+    void build(double rmin, double rcut, double tol)
+    {
+        if (rmin <= 0 || rcut <= rmin) {
+            throw std::invalid_argument("TabulatedInteraction: 0 < rmin < rcut is required");
+        }
+        if (tol <= 0) {
+            throw std::invalid_argument("TabulatedInteraction: tol must be positive");
+        }
+        m_r2min = rmin * rmin;
+        m_r2max = rcut * rcut;
+        const size_t max_points = size_t(1) << 22;
+        for (m_npoints = 65; ; m_npoints = 2 * m_npoints - 1) {
+            fill_tables();
+            if (max_error() <= tol) {
+                return;
+            }
+            if (m_npoints > max_points) {
+                throw std::runtime_error("TabulatedInteraction: the tolerance can not be reached");
+            }
+        }
+    }
+
+    void fill_tables()
+    {
+        m_h = (m_r2max - m_r2min) / (m_npoints - 1);
+        m_inv_h = 1. / m_h;
+        m_table.assign(m_stride * m_npoints * m_ntypes * m_ntypes, 0.);
+        for (size_t ti = 0; ti < m_ntypes; ++ti) {
+            for (size_t tj = ti; tj < m_ntypes; ++tj) {
+                double * const table = m_table.data() + m_stride * m_npoints * pair_index(ti, tj);
+                for (size_t inode = 0; inode < m_npoints; ++inode) {
+                    const double s = m_r2min + inode * m_h;
+                    double gij, hij;
+                    const double e = m_base->energy_gradient_hessian(s, &gij, &hij,
+                            m_type_atom[ti], m_type_atom[tj]);
+                    double * const p = table + m_stride * inode;
+                    p[0] = e;
+                    p[1] = -0.5 * gij * m_h;
+                    p[2] = gij;
+                    p[3] = -(hij + gij) / (2 * s) * m_h;
+                }
+            }
+        }
+    }
+
+    /**
+     * return the largest error of the interpolation at points between the
+     * nodes, relative to 1 + |exact value|
+     */
+    double max_error() const
+    {
+        double max_err = 0;
+        for (size_t ti = 0; ti < m_ntypes; ++ti) {
+            for (size_t tj = ti; tj < m_ntypes; ++tj) {
+                const size_t atomi = m_type_atom[ti];
+                const size_t atomj = m_type_atom[tj];
+                for (size_t inode = 0; inode + 1 < m_npoints; ++inode) {
+                    for (double const u : {0.25, 0.5, 0.75}) {
+                        const double s = m_r2min + (inode + u) * m_h;
+                        double gij, gij_exact;
+                        const double e_exact = m_base->energy_gradient(s, &gij_exact, atomi, atomj);
+                        const double e = energy_gradient(s, &gij, atomi, atomj);
+                        max_err = std::max(max_err, std::fabs(e - e_exact) / (1 + std::fabs(e_exact)));
+                        max_err = std::max(max_err, std::fabs(gij - gij_exact) / (1 + std::fabs(gij_exact)));
+                    }
+                }
+            }
+        }
+        return max_err;
+    }
+};
+
+} // namespace pele
+
+#endif // #ifndef _PELE_TABULATED_INTERACTION_H_
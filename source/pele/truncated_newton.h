@@ -0,0 +1,90 @@
+#ifndef _PELE_TRUNCATED_NEWTON_H__
+#define _PELE_TRUNCATED_NEWTON_H__
+
+#include <memory>
+#include "base_potential.h"
+#include "array.h"
+#include "optimizer.h"
+
+namespace pele{
+
+/**
+ * A matrix free truncated Newton optimizer with a trust region.
+ *
+ * Each iteration approximately solves the Newton equations H p = -g with
+ * the Steihaug conjugate gradient method, using only Hessian vector
+ * products from BasePotential::get_hessian_vector_product.  The inner
+ * iterations stop when the residual is below min(0.5, sqrt(|g|)) |g|, when
+ * the step leaves the trust region or when a direction of negative
+ * curvature is found.  The trust radius is adapted from the ratio of the
+ * actual to the predicted decrease of the energy, and is never larger than
+ * maxstep.  See J. Nocedal and S. J. Wright, Numerical Optimization,
+ * chapter 7.1.
+ *
+ * Close to a minimum the convergence is superlinear, so this is a good
+ * choice to converge a structure to a very small rms gradient, e.g. after
+ * a minimization with LBFGS to a loose tolerance.  Once the energy change
+ * of a step is below the round off error of the energy, steps are instead
+ * accepted if they reduce the norm of the gradient.
+ */
+class TruncatedNewton : public GradientOptimizer{
+private:
+    double radius_; /**< The trust radius */
+    int max_cg_iter_; /**< The maximum number of inner iterations per step */
+    int nhev_; /**< The number of Hessian vector products */
+    Array<double> p_; /**< The step */
+    Array<double> hp_; /**< H p */
+    Array<double> r_; /**< The residual H p + g */
+    Array<double> d_; /**< The conjugate gradient search direction */
+    Array<double> hd_; /**< H d */
+    Array<double> xnew_; /**< The trial position */
+    Array<double> gnew_; /**< The gradient at the trial position */
+
+public:
+    /**
+     * Constructor
+     */
+    TruncatedNewton(std::shared_ptr<pele::BasePotential> potential,
+            const pele::Array<double> x0, double tol=1e-4);
+
+    /**
+     * Destructor
+     */
+    virtual ~TruncatedNewton() {}
+
+    /**
+     * Do one iteration iteration of the optimization algorithm
+     */
+    void one_iteration();
+
+    /**
+     * reset the optimizer to start a new minimization from x0
+     */
+    virtual void reset(pele::Array<double> &x0);
+
+    /**
+     * set the maximum number of conjugate gradient iterations per step.  The
+     * default is the number of degrees of freedom.
+     */
+    void set_max_cg_iter(int max_cg_iter);
+
+    inline int get_max_cg_iter() const { return max_cg_iter_; }
+    inline int get_nhev() const { return nhev_; }
+    inline double get_trust_radius() const { return radius_; }
+
+private:
+    /**
+     * approximately minimize the quadratic model g.p + p.H.p / 2 inside the
+     * trust region.  The step is returned in p_ and H p in hp_.  Return true
+     * if the step is on the boundary of the trust region.
+     */
+    bool steihaug_cg(double tol);
+
+    /**
+     * set p_ to the point where p_ + tau d_ leaves the trust region
+     */
+    void step_to_boundary();
+};
+}
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef _PELE_VERLET_LISTS_H_
+#define _PELE_VERLET_LISTS_H_
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "array.h"
+#include "distance.h"
+#include "cell_lists.h"
+
+namespace pele {
+
+/**
+ * this does the looping over the atom pairs stored in a Verlet list.
+ *
+ * It follows the same visitor pattern as CellListsLoop, so the same
+ * accumulators can be used with both.  The positions passed to the visitor
+ * are read from the current coordinates, not from the coordinates at the time
+ * the list was built.
+ */
+template <class visitor_t, size_t ndim>
+class VerletListsLoop {
+protected:
+    visitor_t & m_visitor;
+    std::vector<std::pair<size_t, size_t> > const & m_pairs;
+    pele::Array<double> m_coords;
+
+public:
+    VerletListsLoop(visitor_t & visitor,
+            std::vector<std::pair<size_t, size_t> > const & pairs,
+            pele::Array<double> coords)
+        : m_visitor(visitor),
+          m_pairs(pairs),
+          m_coords(coords)
+    {}
+
+    void loop_through_atom_pairs()
+    {
+        loop_through_atom_pairs(0, get_nr_work_items());
+    }
+
+    /**
+     * return the number of pairs in the list
+     */
+    size_t get_nr_work_items() const { return m_pairs.size(); }
+
+    /**
+     * loop through the pairs [ibegin, iend) of the list
+     */
+    void loop_through_atom_pairs(const size_t ibegin, const size_t iend)
+    {
+        double const * const x = m_coords.data();
+        for (size_t ipair = ibegin; ipair < iend; ++ipair) {
+            auto const & ijpair = m_pairs[ipair];
+            const size_t i = ijpair.first;
+            const size_t j = ijpair.second;
+            m_visitor.insert_atom_pair(AtomPosition<ndim>(i, x + ndim * i),
+                    AtomPosition<ndim>(j, x + ndim * j));
+        }
+    }
+};
+
+/**
+ * Verlet neighbor lists built on top of the cell lists.
+ *
+ * The list contains all atom pairs which are closer than rcut + skin.  It is
+ * built from cell lists which use rcut + skin as the cutoff, and it is reused
+ * until the largest displacement of any atom since the last build exceeds
+ * skin / 2.  Until then no pair which is closer than rcut can be missing from
+ * the list.
+ *
+ * The cell lists are owned by the caller and must have been constructed with
+ * rcut + skin.
+ */
+template<typename distance_policy>
+class VerletLists {
+public:
+    static const size_t m_ndim = distance_policy::_ndim;
+protected:
+    CellLists<distance_policy> & m_cell_lists;
+    std::shared_ptr<distance_policy> m_dist;
+    double m_rlist2; /**< (rcut + skin)^2 */
+    double m_max_displacement2; /**< (skin / 2)^2 */
+    pele::Array<double> m_coords_at_build; /**< the coordinates when the list was last built */
+    std::vector<std::pair<size_t, size_t> > m_pairs;
+    size_t m_nr_rebuilds;
+
+    /**
+     * visitor which collects the pairs of atoms which are closer than rlist
+     */
+    class PairCollector {
+        std::shared_ptr<distance_policy> m_dist;
+        double m_rlist2;
+        std::vector<std::pair<size_t, size_t> > & m_pairs;
+    public:
+        PairCollector(std::shared_ptr<distance_policy> dist, double rlist2,
+                std::vector<std::pair<size_t, size_t> > & pairs)
+            : m_dist(dist),
+              m_rlist2(rlist2),
+              m_pairs(pairs)
+        {}
+
+        void insert_atom_pair(AtomPosition<m_ndim> const & atom_i,
+                AtomPosition<m_ndim> const & atom_j)
+        {
+            double dr[m_ndim];
+            m_dist->get_rij(dr, atom_i.x.data(), atom_j.x.data());
+            double r2 = 0;
+            for (size_t k = 0; k < m_ndim; ++k) {
+                r2 += dr[k] * dr[k];
+            }
+            if (r2 <= m_rlist2) {
+                m_pairs.push_back(std::pair<size_t, size_t>(atom_i.atom_index, atom_j.atom_index));
+            }
+        }
+    };
+
+public:
+    VerletLists(CellLists<distance_policy> & cell_lists,
+            std::shared_ptr<distance_policy> dist,
+            const double rcut, const double skin)
+        : m_cell_lists(cell_lists),
+          m_dist(dist),
+          m_rlist2((rcut + skin) * (rcut + skin)),
+          m_max_displacement2(0.25 * skin * skin),
+          m_nr_rebuilds(0)
+    {
+        if (skin <= 0) {
+            throw std::invalid_argument("VerletLists: skin must be positive");
+        }
+    }
+
+    /**
+     * return the class which loops over the atom pairs in the Verlet list
+     */
+    template <class callback_class>
+    inline VerletListsLoop<callback_class, m_ndim> get_atom_pair_looper(
+            callback_class & callback, pele::Array<double> coords) const
+    {
+        return VerletListsLoop<callback_class, m_ndim>(callback, m_pairs, coords);
+    }
+
+    /**
+     * update the list for new coordinates.
+     *
+     * The list is only rebuilt if an atom moved further than skin / 2 since
+     * the last build.  Return true if the list was rebuilt.
+     */
+    bool reset(pele::Array<double> coords)
+    {
+        if (needs_rebuild(coords)) {
+            rebuild(coords);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * return the number of times the list has been rebuilt
+     */
+    size_t get_nr_rebuilds() const { return m_nr_rebuilds; }
+
+    /**
+     * return the number of pairs in the list
+     */
+    size_t get_nr_pairs() const { return m_pairs.size(); }
+
+protected:
+    bool needs_rebuild(pele::Array<double> const & coords) const
+    {
+        if (coords.size() != m_coords_at_build.size()) {
+            return true;
+        }
+        double dr[m_ndim];
+        for (size_t i = 0; i < coords.size(); i += m_ndim) {
+            m_dist->get_rij(dr, coords.data() + i, m_coords_at_build.data() + i);
+            double r2 = 0;
+            for (size_t k = 0; k < m_ndim; ++k) {
+                r2 += dr[k] * dr[k];
+            }
+            if (r2 > m_max_displacement2) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void rebuild(pele::Array<double> coords)
+    {
+        if (coords.size() != m_coords_at_build.size()) {
+            m_coords_at_build = coords.copy();
+        } else {
+            m_coords_at_build.assign(coords);
+        }
+        m_cell_lists.reset(coords);
+        m_pairs.clear();
+        PairCollector collector(m_dist, m_rlist2, m_pairs);
+        auto looper = m_cell_lists.get_atom_pair_looper(collector);
+        looper.loop_through_atom_pairs();
+        ++m_nr_rebuilds;
+    }
+};
+
+} // namespace pele
+
+#endif // #ifndef _PELE_VERLET_LISTS_H_
@@ -0,0 +1,195 @@
+#include "pele/truncated_newton.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+using std::cout;
+
+namespace pele {
+
+TruncatedNewton::TruncatedNewton(std::shared_ptr<pele::BasePotential> potential,
+        const pele::Array<double> x0, double tol)
+    : GradientOptimizer(potential, x0, tol),
+      radius_(0),
+      max_cg_iter_(x_.size()),
+      nhev_(0),
+      p_(x_.size()),
+      hp_(x_.size()),
+      r_(x_.size()),
+      d_(x_.size()),
+      hd_(x_.size()),
+      xnew_(x_.size()),
+      gnew_(x_.size())
+{}
+
+void TruncatedNewton::set_max_cg_iter(int max_cg_iter)
+{
+    if (max_cg_iter <= 0) {
+        throw std::invalid_argument("the maximum number of cg iterations must be positive");
+    }
+    max_cg_iter_ = max_cg_iter;
+}
+
+/**
+* Do one iteration iteration of the optimization algorithm
+*/
+void TruncatedNewton::one_iteration()
+{
+    if (!func_initialized_)
+        initialize_func_gradient();
+
+    const size_t N = x_.size();
+    const double gnorm = norm(g_);
+    if (gnorm == 0) {
+        // the gradient vanishes, there is nothing left to do
+        iter_number_ += 1;
+        PELE_TRACE_ITERATION(0.);
+        return;
+    }
+    if (radius_ <= 0) {
+        radius_ = maxstep_;
+    }
+
+    // the forcing term min(0.5, sqrt(|g|)) gives superlinear convergence
+    const bool on_boundary = steihaug_cg(std::min(0.5, std::sqrt(gnorm)) * gnorm);
+
+    // the decrease of the energy predicted by the quadratic model
+    double gp = 0, php = 0;
+    for (size_t j2 = 0; j2 < N; ++j2){
+        gp += g_[j2] * p_[j2];
+        php += p_[j2] * hp_[j2];
+        xnew_[j2] = x_[j2] + p_[j2];
+    }
+    const double pred = -(gp + 0.5 * php);
+    const double pnorm = norm(p_);
+
+    double fnew;
+    compute_func_gradient(xnew_, fnew, gnew_);
+
+    double rho;
+    const double roundoff = 10 * std::numeric_limits<double>::epsilon()
+            * std::max(1., std::fabs(f_));
+    if (pred <= roundoff) {
+        // the change of the energy is lost in the round off error, so use
+        // the norm of the gradient instead
+        rho = (norm(gnew_) < gnorm) ? 1 : -1;
+    } else {
+        rho = (f_ - fnew) / pred;
+    }
+
+    // update the trust radius
+    if (rho < 0.25) {
+        radius_ = 0.25 * pnorm;
+    } else if (rho > 0.75 && on_boundary) {
+        radius_ = std::min(2 * radius_, maxstep_);
+    }
+
+    // accept the step
+    if (rho > 1e-4) {
+        x_.assign(xnew_);
+        g_.assign(gnew_);
+        f_ = fnew;
+        rms_ = norm(g_) / sqrt(g_.size());
+    }
+
+    // print some status information
+    if ((iprint_ > 0) && (iter_number_ % iprint_ == 0)){
+        cout << "truncated newton: " << iter_number_
+            << " E " << f_
+            << " rms " << rms_
+            << " nfev " << nfev_
+            << " nhev " << nhev_
+            << " stepsize " << pnorm
+            << " rho " << rho << "\n";
+    }
+    iter_number_ += 1;
+    PELE_TRACE_ITERATION((rho > 1e-4) ? pnorm : 0.);
+}
+
+bool TruncatedNewton::steihaug_cg(double tol)
+{
+    const size_t N = x_.size();
+    double rr = 0;
+    for (size_t j2 = 0; j2 < N; ++j2){
+        p_[j2] = 0;
+        hp_[j2] = 0;
+        r_[j2] = g_[j2];
+        d_[j2] = -g_[j2];
+        rr += r_[j2] * r_[j2];
+    }
+
+    for (int i = 0; i < max_cg_iter_; ++i) {
+        PELE_TRACE_POTENTIAL(potential_->get_hessian_vector_product(x_, d_, hd_));
+        ++nhev_;
+        const double dhd = dot(d_, hd_);
+        if (dhd <= 0) {
+            // negative curvature: follow d to the boundary
+            step_to_boundary();
+            return true;
+        }
+        const double alpha = rr / dhd;
+
+        double pp = 0, pd = 0, dd = 0;
+        for (size_t j2 = 0; j2 < N; ++j2){
+            pp += p_[j2] * p_[j2];
+            pd += p_[j2] * d_[j2];
+            dd += d_[j2] * d_[j2];
+        }
+        if (pp + alpha * (2 * pd + alpha * dd) >= radius_ * radius_) {
+            step_to_boundary();
+            return true;
+        }
+
+        double rrnew = 0;
+        for (size_t j2 = 0; j2 < N; ++j2){
+            p_[j2] += alpha * d_[j2];
+            hp_[j2] += alpha * hd_[j2];
+            r_[j2] += alpha * hd_[j2];
+            rrnew += r_[j2] * r_[j2];
+        }
+        if (std::sqrt(rrnew) <= tol) {
+            break;
+        }
+        const double beta = rrnew / rr;
+        for (size_t j2 = 0; j2 < N; ++j2){
+            d_[j2] = -r_[j2] + beta * d_[j2];
+        }
+        rr = rrnew;
+    }
+    return false;
+}
+
+void TruncatedNewton::step_to_boundary()
+{
+    // solve |p + tau d| = radius for tau >= 0
+    double pp = 0, pd = 0, dd = 0;
+    for (size_t j2 = 0; j2 < x_.size(); ++j2){
+        pp += p_[j2] * p_[j2];
+        pd += p_[j2] * d_[j2];
+        dd += d_[j2] * d_[j2];
+    }
+    const double disc = pd * pd + dd * std::max(0., radius_ * radius_ - pp);
+    const double tau = (std::sqrt(disc) - pd) / dd;
+    for (size_t j2 = 0; j2 < x_.size(); ++j2){
+        p_[j2] += tau * d_[j2];
+        hp_[j2] += tau * hd_[j2];
+    }
+}
+
+void TruncatedNewton::reset(pele::Array<double> &x0)
+{
+    if (x0.size() != x_.size()){
+        throw std::invalid_argument("The number of degrees of freedom (x0.size()) cannot change when calling reset()");
+    }
+    iter_number_ = 0;
+    nfev_ = 0;
+    nhev_ = 0;
+    radius_ = 0;
+    x_.assign(x0);
+    initialize_func_gradient();
+}
+
+}